@@ -0,0 +1,225 @@
+/*
+ * The source of the MQTT daemon interacting with Paradox EVO control panel
+ * via their's PRT3 module.
+ *
+ * bench_mqtt.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Darau, blė
+ *
+ *  Benchmark of the MQTT publish path. Feeds area and zone reports to
+ *  mqtt_area_report() and mqtt_zone_report() of the MQTT manager, built in
+ *  here, with the MQTT client calls replaced by counters.
+ *
+ *  This file is a part of personal use utilities developed to be used
+ *  on various Linux devices.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+#include <getopt.h>
+
+// The manager talks to these instead of the MQTT client.
+#define MQTTAsync_isConnected bench_is_connected
+#define MQTTAsync_sendMessage bench_send_message
+#define MQTTAsync_subscribe bench_subscribe
+
+#include "../mqtt_mgr.c"
+
+#define BENCH_DEFAULT_PASSES 2000
+#define BENCH_ZONES_PER_AREA (MAX_ZONES / MAX_AREAS)
+
+para_evo_config_t config = {
+    .verbose = 0,
+    .mqtt_topic = "darauble/paraevo",
+    .mqtt_retain = 0,
+    .publish = {
+        PUBLISH_DEFAULT,
+        PUBLISH_DEFAULT,
+        PUBLISH_DEFAULT,
+        PUBLISH_DEFAULT,
+        PUBLISH_DEFAULT,
+        PUBLISH_DEFAULT,
+    },
+    .panel_count = 1,
+    .panels = {
+        { .index = 0, .topic = "darauble/paraevo" },
+    },
+};
+
+static struct {
+    long long messages;
+    long long bytes;
+} sent;
+
+int bench_is_connected(MQTTAsync handle)
+{
+    return 1;
+}
+
+int bench_send_message(MQTTAsync handle, const char *destinationName, const MQTTAsync_message *msg,
+    MQTTAsync_responseOptions *response)
+{
+    sent.messages++;
+    sent.bytes += msg->payloadlen;
+
+    return MQTTASYNC_SUCCESS;
+}
+
+int bench_subscribe(MQTTAsync handle, const char *topic, int qos, MQTTAsync_responseOptions *response)
+{
+    return MQTTASYNC_SUCCESS;
+}
+
+static void print_usage();
+
+/*
+ * Encodes and decodes a report the way the managers do, so the time includes them.
+ */
+static void bench_report(para_report_kind_t kind, int num, int area, unsigned mask,
+    const char *fields, int field_count, const char *label)
+{
+    uint8_t buf[PARA_REPORT_MAX_LEN];
+    para_report_t report;
+
+    size_t len = para_report_encode(buf, kind, 0, num, area, mask, fields, field_count, label);
+
+    if (para_report_decode(buf, len, &report) != 0) {
+        log_error("BENCH: report of %d does not decode\n", num);
+        return;
+    }
+
+    if (kind == PR_AREA) {
+        mqtt_area_report(&report);
+    } else {
+        mqtt_zone_report(&report);
+    }
+}
+
+/*
+ * Every zone opens and closes in turn, the area of it follows with
+ * its ready status. Every other pass repeats the last one, so half
+ * of the payloads are the same as published and are suppressed.
+ */
+static long bench_pass(int pass, int first)
+{
+    long reports = 0;
+    unsigned all_areas = ((1U << AF_COUNT) - 1) | FIELD_LABEL_BIT;
+    unsigned all_zones = ((1U << ZF_COUNT) - 1) | FIELD_LABEL_BIT;
+    int open = (pass / 2) % 2;
+
+    for (int z = 1; z <= MAX_ZONES; z++) {
+        int a = (z - 1) / BENCH_ZONES_PER_AREA + 1;
+        para_zone_state_t zone = { .area = a };
+        char label[LABEL_LENGTH];
+
+        zone.status = open ? RS_ZONE_OPEN : RS_ZONE_CLOSED;
+        zone.alarm = RS_OK;
+        zone.fire = RS_OK;
+        zone.supervision = RS_OK;
+        zone.battery = RS_OK;
+        zone.bypassed = RS_OK;
+        zone.mqtt_state = open ? MQZ_ON : MQZ_OFF;
+
+        snprintf(label, sizeof(label), "Zone %d", z);
+        bench_report(PR_ZONE, z, a, first ? all_zones : (1U << ZF_STATUS) | (1U << ZF_MQTT_STATE),
+            zone.fields, ZF_COUNT, label);
+        reports++;
+
+        if (z % BENCH_ZONES_PER_AREA == 0) {
+            para_area_state_t area = {
+                .status = RS_AREA_DISARMED,
+                .memory = RS_OK,
+                .trouble = RS_OK,
+                .ready = open ? RS_AREA_NOT_READY : RS_OK,
+                .programming = RS_OK,
+                .alarm = RS_OK,
+                .strobe = RS_OK,
+                .mqtt_state = MQP_DISARMED,
+            };
+
+            snprintf(label, sizeof(label), "Area %d", a);
+            bench_report(PR_AREA, a, 0, first ? all_areas : 1U << AF_READY, area.fields, AF_COUNT, label);
+            reports++;
+        }
+    }
+
+    return reports;
+}
+
+int main(int argc, char **argv)
+{
+    long passes = BENCH_DEFAULT_PASSES;
+
+    static struct option long_options[] = {
+        {"passes",       required_argument, 0, 'n'},
+        {"help",         no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int c;
+
+    while ((c = getopt_long(argc, argv, "n:h", long_options, NULL)) >= 0) {
+        switch (c) {
+            case 'n':
+                passes = strtol(optarg, NULL, 10);
+            break;
+
+            case 'h':
+            default:
+                print_usage();
+                return c == 'h' ? 0 : -1;
+        }
+    }
+
+    if (passes < 1) {
+        log_error("BENCH: invalid arguments\n");
+        print_usage();
+        return -1;
+    }
+
+    // Topics of the first reports are built on the way, like in the daemon
+    bench_pass(0, 1);
+    sent.messages = 0;
+    sent.bytes = 0;
+    mqtt_suppressed = 0;
+
+    long reports = 0;
+    long long start = t_now_us();
+
+    for (long p = 1; p <= passes; p++) {
+        reports += bench_pass(p, 0);
+    }
+
+    long long elapsed = t_now_us() - start;
+
+    printf("BENCH: %ld reports in %lld us, %.1f ns per report\n",
+        reports, elapsed, elapsed * 1000.0 / reports);
+    printf("BENCH: %lld messages of %lld bytes sent, %lu suppressed, %.0f messages/s\n",
+        sent.messages, sent.bytes, mqtt_suppressed, elapsed > 0 ? sent.messages * 1000000.0 / elapsed : 0);
+
+    mqtt_topics_free();
+
+    return 0;
+}
+
+static void print_usage()
+{
+    printf(
+        "Usage: paraevo-bench-mqtt [options]\n"
+        "\n"
+        "Measures the MQTT manager turning area and zone reports into messages, with\n"
+        "the MQTT client replaced by a counter.\n"
+        "\n"
+        "  -n <count>    --passes=<count>           Passes over all the areas and zones. Default 2000.\n"
+        "  -h,           --help                     Print this usage message and exit.\n"
+        "\n"
+    );
+}
@@ -0,0 +1,289 @@
+/*
+ * The source of the MQTT daemon interacting with Paradox EVO control panel
+ * via their's PRT3 module.
+ *
+ * bench_parse.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Darau, blė
+ *
+ *  Benchmark of the PRT3 line parser. Parses a mix of event and status
+ *  lines over and over, either a built-in one or the lines from the panel
+ *  in a capture recorded with --record. The same lines are decoded the way
+ *  the manager did before para_parse as the baseline.
+ *
+ *  This file is a part of personal use utilities developed to be used
+ *  on various Linux devices.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "log.h"
+#include "para_capture.h"
+#include "para_parse.h"
+#include "paratypes.h"
+#include "time_helpers.h"
+
+#define BENCH_MAX_LINES 65536
+#define BENCH_DEFAULT_PASSES 100000
+
+typedef struct {
+    char str[CAP_MAX_LINE + 1]; // NUL terminated for the baseline
+    size_t len;
+} bench_line_t;
+
+para_evo_config_t config = {
+    .verbose = 0,
+};
+
+// Zone open/close events dominate, polling brings area and zone statuses
+static const char *builtin_mix[] = {
+    "G001N005A001", "G000N005A001", "G001N017A001", "G000N017A001",
+    "G001N031A002", "G000N031A002", "G001N102A005", "G000N102A005",
+    "G001N188A008", "G000N188A008", "G064N000A001", "G065N001A001",
+    "G065N000A001", "G024N017A001", "G026N017A001", "G014N001A001",
+    "RA001DOOOOOO", "RA002AOOOOOO", "RA005DOMOOOO", "RA008SOOOOAO",
+    "RZ005COOOO", "RZ017OOOOO", "RZ031CAOOO", "RZ102COOOL",
+    "RZ188OOOOO", "RZ192COOOO",
+    "AL001Ground floor    ", "ZL017Front door      ",
+    "AA001&ok", "AD001&ok",
+};
+
+static bench_line_t lines[BENCH_MAX_LINES];
+static int line_count = 0;
+
+static int bench_load_builtin();
+static int bench_load_capture(const char *path);
+static unsigned long long baseline_parse(char *str);
+static void print_rate(const char *name, double parsed, long long elapsed, unsigned long long sum);
+static void print_usage();
+
+int main(int argc, char **argv)
+{
+    const char *capture = NULL;
+    long passes = BENCH_DEFAULT_PASSES;
+
+    static struct option long_options[] = {
+        {"capture",      required_argument, 0, 'c'},
+        {"passes",       required_argument, 0, 'n'},
+        {"help",         no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int c;
+
+    while ((c = getopt_long(argc, argv, "c:n:h", long_options, NULL)) >= 0) {
+        switch (c) {
+            case 'c':
+                capture = optarg;
+            break;
+
+            case 'n':
+                passes = strtol(optarg, NULL, 10);
+            break;
+
+            case 'h':
+            default:
+                print_usage();
+                return c == 'h' ? 0 : -1;
+        }
+    }
+
+    if (passes < 1) {
+        log_error("BENCH: invalid arguments\n");
+        print_usage();
+        return -1;
+    }
+
+    if ((capture ? bench_load_capture(capture) : bench_load_builtin()) < 0) {
+        return -2;
+    }
+
+    int events = 0;
+    int statuses = 0;
+    int malformed = 0;
+
+    for (int i = 0; i < line_count; i++) {
+        para_line_t line;
+
+        if (para_parse_line(lines[i].str, lines[i].len, &line) < 0) {
+            malformed++;
+        } else if (line.type == PL_EVENT) {
+            events++;
+        } else if (line.type == PL_AREA_STATUS || line.type == PL_ZONE_STATUS) {
+            statuses++;
+        }
+    }
+
+    printf("BENCH: %d lines: %d events, %d statuses, %d other, %d malformed\n",
+        line_count, events, statuses, line_count - events - statuses - malformed, malformed);
+
+    // The sum of the decoded fields keeps the loops from being optimized away
+    unsigned long long sum = 0;
+    double parsed = (double) passes * line_count;
+    long long start = t_now_us();
+
+    for (long p = 0; p < passes; p++) {
+        for (int i = 0; i < line_count; i++) {
+            sum += baseline_parse(lines[i].str);
+        }
+    }
+
+    long long baseline_us = t_now_us() - start;
+
+    print_rate("baseline", parsed, baseline_us, sum);
+
+    sum = 0;
+    start = t_now_us();
+
+    for (long p = 0; p < passes; p++) {
+        for (int i = 0; i < line_count; i++) {
+            para_line_t line;
+
+            if (para_parse_line(lines[i].str, lines[i].len, &line) == 0) {
+                sum += line.type + line.num + line.group + line.area + line.data_len;
+            }
+        }
+    }
+
+    long long elapsed = t_now_us() - start;
+
+    print_rate("para_parse", parsed, elapsed, sum);
+
+    if (elapsed > 0) {
+        printf("BENCH: para_parse is %.1fx the baseline\n", (double) baseline_us / elapsed);
+    }
+
+    return 0;
+}
+
+static int bench_load_builtin()
+{
+    for (size_t i = 0; i < sizeof(builtin_mix) / sizeof(builtin_mix[0]); i++) {
+        lines[line_count].len = strlen(builtin_mix[i]);
+        memcpy(lines[line_count].str, builtin_mix[i], lines[line_count].len);
+        line_count++;
+    }
+
+    return 0;
+}
+
+/*
+ * Takes the lines from the panel, requests sent to it are skipped.
+ */
+static int bench_load_capture(const char *path)
+{
+    para_capture_t cap;
+    long long delta_us;
+    cap_direction_t dir;
+    int rc = 0;
+
+    if (cap_open_replay(&cap, path) < 0) {
+        return -1;
+    }
+
+    while (line_count < BENCH_MAX_LINES
+        && (rc = cap_read(&cap, &delta_us, &dir, lines[line_count].str, &lines[line_count].len)) > 0
+    ) {
+        if (dir == CAP_FROM_PANEL) {
+            line_count++;
+        }
+    }
+
+    cap_close(&cap);
+
+    if (rc < 0) {
+        log_error("BENCH: %s is broken after %d lines\n", path, line_count);
+    }
+
+    if (line_count == 0) {
+        log_error("BENCH: no lines from the panel in %s\n", path);
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * Copy of the number decoding the manager used before para_parse: every
+ * number is copied to a heap buffer and converted with strtol.
+ */
+static int get_number_at_substring(char *str, size_t length)
+{
+    char *buff = malloc(length + 1);
+    strncpy(buff, str, length);
+    buff[length] = 0;
+    int ret = strtol(buff, NULL, 10);
+    free(buff);
+    return ret;
+}
+
+/*
+ * The old dispatch of an event or a response, down to the decoded numbers.
+ */
+static unsigned long long baseline_parse(char *str)
+{
+    if (str[0] == PRT3_EVENT) {
+        int event_group = get_number_at_substring(str + 1, 3);
+        int event_num = get_number_at_substring(str + 5, 3);
+        int area_num = get_number_at_substring(str + 9, 3);
+
+        return event_group + event_num + area_num;
+    }
+
+    switch (str[0]) {
+        case PRT3_AREA:
+            if (str[1] == PRT3_LABEL || str[1] == PRT3_DISARM) {
+                return get_number_at_substring(str + 2, 3);
+            }
+        break;
+
+        case PRT3_REQ_RESP:
+            if (str[1] == PRT3_AREA || str[1] == PRT3_ZONE) {
+                return get_number_at_substring(str + 2, 3);
+            }
+        break;
+
+        case PRT3_ZONE:
+            if (str[1] == PRT3_LABEL) {
+                return get_number_at_substring(str + 2, 3);
+            }
+        break;
+    }
+
+    return 0;
+}
+
+static void print_rate(const char *name, double parsed, long long elapsed, unsigned long long sum)
+{
+    printf("BENCH: %s: %.0f lines in %lld us, %.1f ns per line, %.2f M lines/s (sum %llu)\n",
+        name, parsed, elapsed, elapsed * 1000.0 / parsed, elapsed > 0 ? parsed / elapsed : 0, sum);
+}
+
+static void print_usage()
+{
+    printf(
+        "Usage: paraevo-bench-parse [options]\n"
+        "\n"
+        "Measures the PRT3 line parser on a mix of event and status lines, against\n"
+        "the number decoding used before it.\n"
+        "\n"
+        "  -c <path>     --capture=<path>           Parse the lines from the panel in a capture\n"
+        "                                           recorded with --record instead of the built-in mix.\n"
+        "  -n <count>    --passes=<count>           Passes over the lines. Default 100000.\n"
+        "  -h,           --help                     Print this usage message and exit.\n"
+        "\n"
+    );
+}
@@ -23,6 +23,39 @@
 #ifndef PARA_EVO_CONFIG_H
 #define PARA_EVO_CONFIG_H
 
+#define MAX_PANELS 8
+#define PANEL_TOPIC_SIZE 128
+
+// Classes of published topics with their own QoS, retain and enable settings.
+typedef enum {
+    PUB_AREA_STATE = 0, // area/N
+    PUB_AREA_JSON, // area/N/state
+    PUB_ZONE_STATE, // area/N/zone/M
+    PUB_ZONE_ALARM, // area/N/zone/M/alarm
+    PUB_ZONE_JSON, // area/N/zone/M/state
+    PUB_HEARTBEAT, // daemon, online every 60 s and the LWT
+    PUB_COUNT,
+} para_publish_class_t;
+
+typedef struct {
+    int enabled;
+    int qos;
+    int retain; // -1 - as given by -r
+} para_publish_profile_t;
+
+#define PUBLISH_DEFAULT { .enabled = 1, .qos = 1, .retain = -1 }
+
+// Everything specific to one PRT3/panel served by the daemon.
+typedef struct {
+    int index; // 0-based, also part of the panel's endpoint names
+    char *device;
+    char *replay_file;
+    char *record_file;
+    char *snapshot_file; // Labels and last known state for a warm start
+    char *topic; // MQTT topic prefix of the panel
+    char default_topic[PANEL_TOPIC_SIZE];
+} para_panel_config_t;
+
 typedef struct {
     int verbose;
     char *mqtt_server;
@@ -32,8 +65,19 @@ typedef struct {
     char *mqtt_login;
     char *mqtt_password;
     int mqtt_retain;
+    int mqtt_republish; // Publish everything again on every heartbeat, not only the changes
+    int mqtt_queue_count; // Messages kept while the broker is unreachable, 0 - none
+    int mqtt_queue_bytes;
+    int mqtt_drain_rate; // Queued messages sent per second after a reconnect
+    para_publish_profile_t publish[PUB_COUNT];
     char *user_code;
     int area_status_period;
+    int prt3_window;
+    int prt3_timeout;
+    int coalesce; // ms to gather state changes into one report, 0 - report at once
+    int history; // Events kept per panel, 0 - none
+    int panel_count;
+    para_panel_config_t panels[MAX_PANELS];
 } para_evo_config_t;
 
 #endif /* PARA_EVO_CONFIG_H */
\ No newline at end of file
@@ -23,13 +23,22 @@
 #ifndef ENDPOINTS_H
 #define ENDPOINTS_H
 
+#define EPT_NAME_LEN 64
+
 #define EPT_KILL "inproc://kill"
-#define EPT_SERIAL_READ "inproc://serialread"
-#define EPT_SERIAL_WRITE "inproc://serialwrite"
 
-#define EPT_MQTT_AREA_COMMAND "inproc://mqtt.area.command"
+// Per panel endpoints, formatted with the panel index by z_panel_endpoint().
+#define EPT_SERIAL_READ "inproc://serialread.%d"
+#define EPT_SERIAL_WRITE "inproc://serialwrite.%d"
+#define EPT_SERIAL_STATUS "inproc://serialstatus.%d"
+#define EPT_MQTT_AREA_COMMAND "inproc://mqtt.area.command.%d"
+
+// Shared by all panels, reports carry the panel index.
 #define EPT_MQTT_AREA_REPORT "inproc://mqtt.area.report"
 #define EPT_MQTT_ZONE_REPORT "inproc://mqtt.zone.report"
 
+// Commands received by Paho callbacks, handed over to the MQTT manager thread.
+#define EPT_MQTT_CONTROL "inproc://mqtt.control"
+
 
 #endif /* ENDPOINTS_H */
\ No newline at end of file
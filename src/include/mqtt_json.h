@@ -0,0 +1,49 @@
+/*
+ * The source of the MQTT daemon interacting with Paradox EVO control panel
+ * via their's PRT3 module.
+ *
+ * mqtt_json.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Darau, blė
+ *
+ *  This file is a part of personal use utilities developed to be used
+ *  on various Linux devices.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+#ifndef MQTT_JSON_H
+#define MQTT_JSON_H
+
+#include <stddef.h>
+
+#define MQTT_JSON_SIZE 256
+#define MQTT_JSON_SLOTS 8
+
+/*
+ * A JSON object of a label and single character fields, rendered once.
+ * Field changes are written straight into their slots, the label and the
+ * keys only when they change.
+ */
+typedef struct {
+    char str[MQTT_JSON_SIZE];
+    size_t len; // 0 - not rendered yet
+    unsigned short slots[MQTT_JSON_SLOTS]; // Offsets of the field values
+    int slot_count;
+} mqtt_json_t;
+
+size_t mqtt_json_escape(char *out, size_t size, const char *label);
+
+int mqtt_json_render(mqtt_json_t *json, const char *head, const char **keys, int key_count, const char *fields);
+
+void mqtt_json_patch(mqtt_json_t *json, const char *fields, unsigned mask);
+
+#endif /* MQTT_JSON_H */
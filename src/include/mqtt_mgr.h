@@ -25,6 +25,12 @@
 
 #include <pthread.h>
 
+void mqtt_mgr_set_area(int, int);
+
+void mqtt_mgr_set_zone(int, int, int);
+
+int mqtt_mgr_set_publish(const char*);
+
 pthread_t mqtt_mgr_start(void*);
 
 #endif /* MQTT_MGR_H */
\ No newline at end of file
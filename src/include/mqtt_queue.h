@@ -0,0 +1,72 @@
+/*
+ * The source of the MQTT daemon interacting with Paradox EVO control panel
+ * via their's PRT3 module.
+ *
+ * mqtt_queue.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Darau, blė
+ *
+ *  This file is a part of personal use utilities developed to be used
+ *  on various Linux devices.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+#ifndef MQTT_QUEUE_H
+#define MQTT_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MQTT_QUEUE_DEFAULT_COUNT 1024
+#define MQTT_QUEUE_DEFAULT_BYTES (256 * 1024)
+#define MQTT_QUEUE_MAX_COUNT 65536
+#define MQTT_QUEUE_DEFAULT_DRAIN 100 // Messages per second after a reconnect
+
+typedef struct {
+    char *topic;
+    char *payload;
+    int len;
+    int qos;
+    int retained;
+    uint64_t hash; // Of the topic, to find it quicker
+    void *owner; // Passed to the drop callback
+} mqtt_queue_entry_t;
+
+/*
+ * Messages waiting for the broker, oldest first. A topic is queued once,
+ * a newer payload replaces the waiting one. When the count or bytes limit
+ * is reached, the oldest messages are dropped.
+ */
+typedef struct {
+    mqtt_queue_entry_t *entries;
+    int size;
+    int head;
+    int count;
+    size_t bytes; // Topics and payloads
+    size_t max_bytes;
+    void (*dropped)(void *owner);
+    unsigned long queued;
+    unsigned long replaced;
+    unsigned long overflows;
+} mqtt_queue_t;
+
+int mqtt_queue_init(mqtt_queue_t *queue, int size, size_t max_bytes, void (*dropped)(void *owner));
+
+void mqtt_queue_free(mqtt_queue_t *queue);
+
+int mqtt_queue_put(mqtt_queue_t *queue, const char *topic, const char *payload, int len, int qos, int retained, void *owner);
+
+mqtt_queue_entry_t *mqtt_queue_head(mqtt_queue_t *queue);
+
+void mqtt_queue_pop(mqtt_queue_t *queue);
+
+#endif /* MQTT_QUEUE_H */
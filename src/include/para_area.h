@@ -0,0 +1,72 @@
+/*
+ * The source of the MQTT daemon interacting with Paradox EVO control panel
+ * via their's PRT3 module.
+ *
+ * para_area.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Darau, blė
+ *
+ *  This file is a part of personal use utilities developed to be used
+ *  on various Linux devices.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+#ifndef PARA_AREA_H
+#define PARA_AREA_H
+
+#include "para_state.h"
+#include "paratypes.h"
+
+#define AS(state) (1U << (state)) // A bit of mqtt_panel_state_t in the from mask
+#define AS_ANY 0xFFFFU
+#define AS_ARMED (AS(MQP_ARMED_HOME) | AS(MQP_ARMED_AWAY) | AS(MQP_ARMED_NIGHT) \
+    | AS(MQP_ARMED_VACATION) | AS(MQP_ARMED_CUSTOM_BYPASS))
+#define AS_KEEP -1 // The transition leaves the MQTT state as it is
+
+/*
+ * Side effects of a transition on the rest of the area record.
+ */
+typedef enum {
+    AT_CLEAR_BYPASS = 1 << 0, // The panel drops the bypasses on disarm
+    AT_MEMORY = 1 << 1, // An alarm is left in memory
+    AT_TROUBLE = 1 << 2,
+    AT_FLUSH = 1 << 3, // Report at once, past the coalescing window
+} para_area_effect_t;
+
+/*
+ * A row of the area state machine: an event of groups group_min..group_max
+ * with a number num_min..num_max moves an area in one of the from states
+ * to the to state. Status and alarm are the new AF_STATUS and AF_ALARM
+ * values, 0 keeps them. Armed away and home targets become armed custom
+ * bypass while the area has bypassed zones.
+ */
+typedef struct {
+    unsigned from;
+    uint8_t group_min;
+    uint8_t group_max;
+    uint8_t num_min;
+    uint8_t num_max;
+    char status;
+    char alarm;
+    int to; // mqtt_panel_state_t or AS_KEEP
+    unsigned effects; // para_area_effect_t bits
+} para_area_transition_t;
+
+const para_area_transition_t *para_area_transition(int mqtt_state, int group, int num);
+
+mqtt_panel_state_t para_area_armed(mqtt_panel_state_t armed, int bypassed);
+
+mqtt_panel_state_t para_area_derive(const para_area_state_t *area, int bypassed);
+
+const para_area_transition_t *para_area_apply(para_state_t *state, int area_num, int group, int num, int hold);
+
+#endif /* PARA_AREA_H */
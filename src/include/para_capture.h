@@ -0,0 +1,63 @@
+/*
+ * The source of the MQTT daemon interacting with Paradox EVO control panel
+ * via their's PRT3 module.
+ *
+ * para_capture.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Darau, blė
+ *
+ *  This file is a part of personal use utilities developed to be used
+ *  on various Linux devices.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+#ifndef PARA_CAPTURE_H
+#define PARA_CAPTURE_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/*
+ * Capture file format: 8 byte magic, then records of
+ *   LEB128 varint - microseconds since the previous record (monotonic clock)
+ *   1 byte        - direction in the highest bit, line length in the rest
+ *   line          - PRT3 line without EOL
+ * Appending to an existing capture continues it with zero gap.
+ */
+#define CAP_MAGIC "PEVOCAP1"
+#define CAP_MAGIC_LEN 8
+#define CAP_MAX_LINE 127
+#define CAP_DIR_BIT 0x80
+
+typedef enum {
+    CAP_FROM_PANEL = 0,
+    CAP_TO_PANEL,
+} cap_direction_t;
+
+typedef struct {
+    FILE *file;
+    long long last_us;
+} para_capture_t;
+
+int cap_open_record(para_capture_t *cap, const char *path);
+
+void cap_write(para_capture_t *cap, cap_direction_t dir, const char *line, size_t len);
+
+void cap_flush(para_capture_t *cap);
+
+int cap_open_replay(para_capture_t *cap, const char *path);
+
+int cap_read(para_capture_t *cap, long long *delta_us, cap_direction_t *dir, char *line, size_t *len);
+
+void cap_close(para_capture_t *cap);
+
+#endif /* PARA_CAPTURE_H */
@@ -0,0 +1,54 @@
+/*
+ * The source of the MQTT daemon interacting with Paradox EVO control panel
+ * via their's PRT3 module.
+ *
+ * para_frame.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Darau, blė
+ *
+ *  This file is a part of personal use utilities developed to be used
+ *  on various Linux devices.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+#ifndef PARA_FRAME_H
+#define PARA_FRAME_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#define PARA_FRAME_LEN 4096 // Several alarm storm reads fit before wrapping
+
+/*
+ * Splits serial input into PRT3 lines. Reads go straight into the
+ * buffer, complete lines are handed out as slices of it. Lines never
+ * straddle the end of the buffer: before wrapping around, only the
+ * unfinished line (shorter than PARA_SERIAL_INPUT_LEN) is moved to
+ * the front.
+ */
+typedef struct {
+    char buffer[PARA_FRAME_LEN];
+    size_t start; // First byte of the unfinished line
+    size_t scan; // Where to continue looking for EOL
+    size_t end; // End of data read
+    int discarding; // Skipping the rest of an over-long line
+    unsigned long lines;
+    unsigned long resyncs;
+} para_frame_t;
+
+void para_frame_init(para_frame_t *frame);
+
+ssize_t para_frame_read(para_frame_t *frame, int fd);
+
+int para_frame_next(para_frame_t *frame, const char **line, size_t *len);
+
+#endif /* PARA_FRAME_H */
@@ -0,0 +1,60 @@
+/*
+ * The source of the MQTT daemon interacting with Paradox EVO control panel
+ * via their's PRT3 module.
+ *
+ * para_history.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Darau, blė
+ *
+ *  This file is a part of personal use utilities developed to be used
+ *  on various Linux devices.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+#ifndef PARA_HISTORY_H
+#define PARA_HISTORY_H
+
+#include <stdint.h>
+
+#define PARA_HISTORY_DEFAULT 256 // Events kept per panel
+#define PARA_HISTORY_MAX 65536
+#define PARA_HISTORY_QUERY_DEFAULT 100 // Events returned if the query does not say
+#define PARA_HISTORY_QUERY_MAX 1000
+
+typedef struct {
+    long long time; // Monotonic ms
+    uint8_t group;
+    uint8_t area;
+    uint16_t num;
+    char status; // Status byte of the zone or area after the event
+    char mqtt_state;
+} para_history_entry_t;
+
+/*
+ * The last events of a panel, oldest overwritten. Only the panel manager
+ * thread touches it, queries come to it as commands, so there are no locks.
+ */
+typedef struct {
+    para_history_entry_t *entries;
+    unsigned size;
+    unsigned long long count; // Ever added, the newest is at (count - 1) % size
+} para_history_t;
+
+int para_history_init(para_history_t *hist, int size);
+
+void para_history_free(para_history_t *hist);
+
+void para_history_add(para_history_t *hist, int group, int num, int area, char status, char mqtt_state);
+
+int para_history_query(const para_history_t *hist, int area, int count, para_history_entry_t *out);
+
+#endif /* PARA_HISTORY_H */
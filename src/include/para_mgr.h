@@ -23,11 +23,16 @@
 #ifndef PARA_MGR_H
 #define PARA_MGR_H
 
-// Comment out for EVO48, but only to save some memory
-// Otherwise works in the same manner.
+// Panel profile fixes the table sizes, set PROFILE in Config to
+// EVO48 or EVO96 to save some memory. Otherwise works in the same manner.
+#if !defined(EVO48) && !defined(EVO96) && !defined(EVO192)
 #define EVO192
+#endif
 
-#ifdef EVO192
+#if defined(EVO192)
+#define MAX_AREAS 8
+#define MAX_ZONES 192
+#elif defined(EVO96)
 #define MAX_AREAS 8
 #define MAX_ZONES 96
 #else
@@ -37,16 +42,25 @@
 
 #define PARA_SERIAL_SPACE 0x20
 
+#define PARA_MGR_MAX_COALESCE 1000 // ms
+#define PARA_MGR_SNAPSHOT_INTERVAL 1000 // ms between snapshot saves of a changing state
+
+// On-demand refreshes over MQTT: a burst is allowed, then one per interval.
+#define PARA_MGR_REFRESH_BURST 8
+#define PARA_MGR_REFRESH_INTERVAL 250 // ms
+#define PARA_MGR_DUMP_INTERVAL 5000 // ms
+#define PARA_MGR_COMMAND_TIMEOUT 5000 // ms for an arm/disarm command to be echoed and take effect
+
 #include <pthread.h>
 
 // Call this first!
 void para_mgr_init();
 
-int para_mgr_set_area(int);
+int para_mgr_set_area(int, int);
 
-int para_mgr_set_zone(int, int);
+int para_mgr_set_zone(int, int, int);
 
-pthread_t para_mgr_start(void*);
+pthread_t para_mgr_start(int, void*);
 
 void para_mgr_clean();
 
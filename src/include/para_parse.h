@@ -0,0 +1,57 @@
+/*
+ * The source of the MQTT daemon interacting with Paradox EVO control panel
+ * via their's PRT3 module.
+ *
+ * para_parse.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Darau, blė
+ *
+ *  This file is a part of personal use utilities developed to be used
+ *  on various Linux devices.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+#ifndef PARA_PARSE_H
+#define PARA_PARSE_H
+
+#include <stddef.h>
+
+#define PARA_NUM_LEN 3 // Every number in PRT3 lines is 3 digits
+
+typedef enum {
+    PL_EVENT = 0,     // G###N###A###
+    PL_AREA_STATUS,   // RA###SMTRPAS
+    PL_ZONE_STATUS,   // RZ###SAFSL
+    PL_AREA_LABEL,    // AL###<16 characters>
+    PL_ZONE_LABEL,    // ZL###<16 characters>
+    PL_AREA_DISARM,   // AD###&ok
+    PL_AREA_ARM,      // AA###&ok
+    PL_AREA_QUICK_ARM, // AQ###&ok
+    PL_OTHER,         // Echo of other commands, number is decoded only
+} para_line_type_t;
+
+/*
+ * A PRT3 line split into its fields. Data points into the line itself.
+ */
+typedef struct {
+    para_line_type_t type;
+    const char *str; // The whole line, status bytes are at RA_* and RZ_* offsets
+    int num;   // Area or zone of a response, event number of an event
+    int group; // Event group
+    int area;  // Area of an event
+    const char *data; // Whatever follows the number: statuses, label, &ok
+    size_t data_len;
+} para_line_t;
+
+int para_parse_line(const char *str, size_t len, para_line_t *line);
+
+#endif /* PARA_PARSE_H */
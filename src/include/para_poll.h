@@ -0,0 +1,54 @@
+/*
+ * The source of the MQTT daemon interacting with Paradox EVO control panel
+ * via their's PRT3 module.
+ *
+ * para_poll.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Darau, blė
+ *
+ *  This file is a part of personal use utilities developed to be used
+ *  on various Linux devices.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+#ifndef PARA_POLL_H
+#define PARA_POLL_H
+
+#include <stdint.h>
+
+#include "para_mgr.h"
+
+#define PARA_POLL_MIN_PERIOD 15000 // ms, the tightest period when events drift
+#define PARA_POLL_TIGHTEN 4 // The period can shrink to a quarter of the configured one
+
+/*
+ * Area status polling deadlines. Each area is due when its status has not
+ * been confirmed by a RA response for its own period. The period shrinks
+ * while polled statuses disagree with what events made of them and grows
+ * back to the configured one while they agree.
+ */
+typedef struct {
+    long long deadline[MAX_AREAS];
+    int period[MAX_AREAS]; // ms
+    int max_period;
+    int min_period;
+} para_poll_t;
+
+void para_poll_init(para_poll_t *poll, const uint64_t *areas, int period_ms);
+
+void para_poll_confirm(para_poll_t *poll, int area_num, int drifted);
+
+int para_poll_next_due(para_poll_t *poll, const uint64_t *areas, int after);
+
+int para_poll_next_timeout(const para_poll_t *poll, const uint64_t *areas);
+
+#endif /* PARA_POLL_H */
@@ -0,0 +1,124 @@
+/*
+ * The source of the MQTT daemon interacting with Paradox EVO control panel
+ * via their's PRT3 module.
+ *
+ * para_report.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Darau, blė
+ *
+ *  This file is a part of personal use utilities developed to be used
+ *  on various Linux devices.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+#ifndef PARA_REPORT_H
+#define PARA_REPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "para_history.h"
+#include "paratypes.h"
+
+/*
+ * Reports from panel managers to MQTT manager carry only what changed:
+ *
+ *   byte 0     version
+ *   byte 1     kind, para_report_kind_t
+ *   byte 2     panel index
+ *   byte 3     area or zone number
+ *   byte 4     area of the zone, 0 for an area
+ *   byte 5, 6  changed field mask, little endian
+ *   a byte per field bit set, in field order
+ *   label length and characters, if FIELD_LABEL_BIT is set
+ *
+ * Labels are sent once, the receiver keeps them by panel and number.
+ *
+ * PR_READY tells which areas have their status and the status of all their
+ * zones received from the panel: the mask holds the monitored areas (bit 0
+ * is area 1) and two bytes of values hold the ready ones.
+ *
+ * PR_TROUBLE carries the system troubles of the panel: the mask holds
+ * a bit per para_trouble_t code present, there are no values.
+ *
+ * PR_COMMAND tells how an area command ended: the number is the area,
+ * the mask is 0 and PARA_REPORT_COMMAND_LEN bytes follow:
+ *
+ *   byte 0     command, para_arm_cmd_e_t
+ *   byte 1     result, para_cmd_result_t
+ *   byte 2-5   ms from the command to its result, little endian
+ *   byte 6-9   ms from the command to the PRT3 echo, little endian, all ones if none
+ *
+ * PR_HISTORY answers a history query: the number is the area asked for
+ * (0 - all), the mask holds the count of events following, each of
+ * PARA_REPORT_EVENT_LEN bytes:
+ *
+ *   byte 0-3   age in ms at the time of the answer, little endian
+ *   byte 4     group
+ *   byte 5, 6  event number, little endian
+ *   byte 7     area
+ *   byte 8     status of the zone or area after the event
+ *   byte 9     MQTT state of the zone or area after the event
+ */
+#define PARA_REPORT_VERSION 1
+#define PARA_REPORT_HEADER_LEN 7
+#define PARA_REPORT_MAX_LEN (PARA_REPORT_HEADER_LEN + 16 + 1 + LABEL_LENGTH)
+#define PARA_REPORT_EVENT_LEN 10
+#define PARA_REPORT_COMMAND_LEN 10
+#define PARA_REPORT_NO_ECHO 0xFFFFFFFFU
+#define PARA_REPORT_HISTORY_LEN(count) (PARA_REPORT_HEADER_LEN + (count) * PARA_REPORT_EVENT_LEN)
+
+typedef enum {
+    PR_AREA = 0,
+    PR_ZONE,
+    PR_READY,
+    PR_HISTORY,
+    PR_TROUBLE,
+    PR_COMMAND,
+} para_report_kind_t;
+
+typedef struct {
+    para_report_kind_t kind;
+    int panel;
+    int num;
+    int area;
+    unsigned mask;
+    const char *values; // A byte per field bit set in the mask, points into the message
+    const char *label;
+    size_t label_len;
+    unsigned ready; // Areas ready, PR_READY only
+    int events; // PR_HISTORY only, the events are in values
+} para_report_t;
+
+size_t para_report_encode(uint8_t *buf, para_report_kind_t kind, int panel, int num, int area,
+    unsigned mask, const char *fields, int field_count, const char *label);
+
+size_t para_report_encode_ready(uint8_t *buf, int panel, unsigned areas, unsigned ready);
+
+size_t para_report_encode_trouble(uint8_t *buf, int panel, unsigned troubles);
+
+size_t para_report_encode_command(uint8_t *buf, int panel, int area, int command, int result,
+    unsigned latency, unsigned echo);
+
+void para_report_command(const para_report_t *report, int *command, int *result,
+    unsigned *latency, unsigned *echo);
+
+size_t para_report_encode_history(uint8_t *buf, int panel, int area,
+    const para_history_entry_t *events, int count, long long now);
+
+void para_report_event(const para_report_t *report, int idx, para_history_entry_t *event, unsigned *age);
+
+int para_report_decode(const uint8_t *buf, size_t len, para_report_t *report);
+
+void para_report_apply(const para_report_t *report, char *fields, int field_count, char *label);
+
+#endif /* PARA_REPORT_H */
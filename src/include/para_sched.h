@@ -0,0 +1,114 @@
+/*
+ * The source of the MQTT daemon interacting with Paradox EVO control panel
+ * via their's PRT3 module.
+ *
+ * para_sched.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Darau, blė
+ *
+ *  This file is a part of personal use utilities developed to be used
+ *  on various Linux devices.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+#ifndef PARA_SCHED_H
+#define PARA_SCHED_H
+
+#define PARA_SCHED_QUEUE_LEN 512 // Fits labels and statuses of all areas and zones plus commands
+#define PARA_SCHED_MAX_WINDOW 16 // Upper limit of requests awaiting response at once
+#define PARA_SCHED_RETRIES 2 // Resend attempts before a query is given up, commands are not resent
+#define PARA_SCHED_MAX_NUM 256 // Area, zone and utility key numbers all fit below
+#define PARA_REQUEST_LEN 16 // Longest is AA with a 6 digit user code: 12 characters
+
+#define PARA_SCHED_DEFAULT_WINDOW 4
+#define PARA_SCHED_DEFAULT_TIMEOUT 500 // ms
+
+/*
+ * Every request PRT3 understands is echoed back with the same
+ * 5 character prefix: two letter command and 3 digit number.
+ * The order must match the command codes in para_sched.c.
+ */
+typedef enum {
+    RQ_AREA_STATUS = 0, // RA
+    RQ_ZONE_STATUS,     // RZ
+    RQ_AREA_LABEL,      // AL
+    RQ_ZONE_LABEL,      // ZL
+    RQ_AREA_ARM,        // AA
+    RQ_AREA_DISARM,     // AD
+    RQ_AREA_QUICK_ARM,  // AQ
+    RQ_UTILITY_KEY,     // UK
+    RQ_TYPES_COUNT,
+} para_request_type_t;
+
+// Queries can be collapsed, commands are always sent and go first.
+#define RQ_IS_QUERY(type) ((type) <= RQ_ZONE_LABEL)
+
+typedef enum {
+    RQR_UNSOLICITED = -1, // Not a response to any request in flight (e.g. an event)
+    RQR_OK = 0,
+    RQR_FAIL, // PRT3 responded with &fail
+} para_request_result_t;
+
+typedef struct {
+    para_request_type_t type;
+    int num;
+    int retries;
+    long long deadline; // Monotonic ms when in flight
+    int len;
+    char line[PARA_REQUEST_LEN];
+} para_request_t;
+
+typedef struct {
+    int head;
+    int count;
+    short idx[PARA_SCHED_QUEUE_LEN];
+} para_request_queue_t;
+
+typedef struct {
+    para_request_t slots[PARA_SCHED_QUEUE_LEN];
+    short free_slots[PARA_SCHED_QUEUE_LEN];
+    int free_count;
+
+    para_request_queue_t commands;
+    para_request_queue_t queries;
+
+    short inflight[PARA_SCHED_MAX_WINDOW];
+    int inflight_count;
+
+    // Slot index + 1 of a pending query, 0 if none. Used to collapse duplicates.
+    short pending[RQ_ZONE_LABEL + 1][PARA_SCHED_MAX_NUM];
+
+    int window;
+    int timeout;
+    long long sent;
+    long long retried;
+    long long collapsed;
+    long long dropped;
+} para_sched_t;
+
+void para_sched_init(para_sched_t *sched, int window, int timeout);
+
+int para_sched_request(para_sched_t *sched, para_request_type_t type, int num, const char *arg);
+
+void para_sched_dispatch(para_sched_t *sched, void *serial_sender);
+
+para_request_result_t para_sched_response(para_sched_t *sched, const char *line);
+
+int para_sched_next_timeout(para_sched_t *sched);
+
+void para_sched_resend_inflight(para_sched_t *sched);
+
+int para_sched_idle(para_sched_t *sched);
+
+int para_sched_pending(const para_sched_t *sched, para_request_type_t type, int num);
+
+#endif /* PARA_SCHED_H */
@@ -26,11 +26,22 @@
 #include <termios.h>
 #include <pthread.h>
 
+#include "config.h"
+
 #define PARA_SERIAL_SPEED B57600 // Default value
-#define PARA_SERIAL_BUFF_LEN 512 // Buffer for reading serial in batches
+#define PARA_SERIAL_BUFF_LEN 512 // Least free space for reading serial in batches
 #define PARA_SERIAL_INPUT_LEN 32 // Should be actually enough of 22, but just in case
 #define PARA_SERIAL_EOL 0x0D
+#define PARA_SERIAL_OUT_LEN 1024 // Output queue, holds the whole scheduler window many times over
+#define PARA_SERIAL_RETRY_MIN 20 // ms to retry opening after the device node appears
+#define PARA_SERIAL_RETRY_MAX 1000 // ms between retries when nothing happens
+
+// Sent to the panel manager when serial device is lost and back.
+typedef enum {
+    SERIAL_ONLINE = 0,
+    SERIAL_OFFLINE,
+} para_serial_state_t;
 
-pthread_t start_para_serial(char*, void *);
+pthread_t start_para_serial(para_panel_config_t *, void *);
 
 #endif /* PARA_SERIAL_H */
\ No newline at end of file
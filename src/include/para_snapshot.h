@@ -0,0 +1,64 @@
+/*
+ * The source of the MQTT daemon interacting with Paradox EVO control panel
+ * via their's PRT3 module.
+ *
+ * para_snapshot.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Darau, blė
+ *
+ *  This file is a part of personal use utilities developed to be used
+ *  on various Linux devices.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+#ifndef PARA_SNAPSHOT_H
+#define PARA_SNAPSHOT_H
+
+#include <stdint.h>
+
+#include "para_state.h"
+
+#define SNAP_MAGIC "PEVOSNP1"
+#define SNAP_MAGIC_LEN 8
+
+/*
+ * Labels and last known state of one panel, memory mapped from a file.
+ * Only valid if the checksum matches and the fingerprint of monitored
+ * areas and zones is the same as the daemon is started with.
+ */
+typedef struct {
+    char magic[SNAP_MAGIC_LEN];
+    uint32_t size;
+    uint32_t checksum; // Of everything after the header
+    uint64_t fingerprint;
+
+    para_area_state_t areas[MAX_AREAS];
+    para_zone_state_t zones[MAX_ZONES];
+    char area_names[MAX_AREAS][LABEL_LENGTH];
+    char zone_names[MAX_ZONES][LABEL_LENGTH];
+} para_snapshot_data_t;
+
+typedef struct {
+    int fd;
+    para_snapshot_data_t *data; // NULL if no snapshot is kept
+    uint64_t fingerprint;
+} para_snapshot_t;
+
+int para_snapshot_open(para_snapshot_t *snap, const char *path, const para_state_t *state);
+
+int para_snapshot_load(para_snapshot_t *snap, para_state_t *state);
+
+void para_snapshot_save(para_snapshot_t *snap, para_state_t *state);
+
+void para_snapshot_close(para_snapshot_t *snap, para_state_t *state);
+
+#endif /* PARA_SNAPSHOT_H */
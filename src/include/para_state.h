@@ -0,0 +1,191 @@
+/*
+ * The source of the MQTT daemon interacting with Paradox EVO control panel
+ * via their's PRT3 module.
+ *
+ * para_state.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Darau, blė
+ *
+ *  This file is a part of personal use utilities developed to be used
+ *  on various Linux devices.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+#ifndef PARA_STATE_H
+#define PARA_STATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "para_mgr.h"
+#include "paratypes.h"
+
+#define PARA_BITS_WORDS(n) (((n) + 63) / 64)
+#define PARA_AREA_WORDS PARA_BITS_WORDS(MAX_AREAS)
+#define PARA_ZONE_WORDS PARA_BITS_WORDS(MAX_ZONES)
+
+/*
+ * Zone conditions kept as bitsets over all zones of the panel,
+ * so per area questions are a mask and a popcount.
+ */
+typedef enum {
+    ZB_OPEN = 0,
+    ZB_ALARM,
+    ZB_FIRE,
+    ZB_BYPASSED,
+    ZB_LOW_BATTERY,
+    ZB_COUNT,
+} para_zone_bit_t;
+
+/*
+ * State of one panel in a few flat arrays. Areas are indexed by number - 1,
+ * zones by a compact slot: a site using 30 of 192 zones keeps them in the
+ * first 30 slots, in the order they were added. Bitsets are by number.
+ * Records are not allocated, the monitored bitsets tell which ones are in use.
+ * Changes mark dirty bits, reports are sent by walking those. Labels changed
+ * before the first report go along with it.
+ */
+typedef struct {
+    uint64_t areas_monitored[PARA_AREA_WORDS];
+    uint64_t zones_monitored[PARA_ZONE_WORDS];
+    uint64_t areas_reported[PARA_AREA_WORDS]; // First report carries all the fields
+    uint64_t zones_reported[PARA_ZONE_WORDS];
+    uint64_t areas_dirty[PARA_AREA_WORDS];
+    uint64_t zones_dirty[PARA_ZONE_WORDS];
+    uint64_t areas_known[PARA_AREA_WORDS]; // Status received from the panel
+    uint64_t zones_known[PARA_ZONE_WORDS];
+
+    uint64_t zone_bits[ZB_COUNT][PARA_ZONE_WORDS];
+    uint64_t area_zones[MAX_AREAS][PARA_ZONE_WORDS];
+
+    uint8_t zone_slot[MAX_ZONES]; // Slot + 1 by zone number - 1, 0 if not monitored
+    uint8_t slot_zone[MAX_ZONES]; // Zone number by slot
+    int zone_count; // Slots in use
+
+    para_area_state_t areas[MAX_AREAS];
+    para_zone_state_t zones[MAX_ZONES]; // By slot
+
+    // Fields changed since the last report, a bit per field and FIELD_LABEL_BIT
+    uint16_t area_fields[MAX_AREAS];
+    uint16_t zone_fields[MAX_ZONES]; // By slot
+
+    int unsaved; // Changed since the last snapshot
+
+    unsigned troubles; // System troubles, a bit per para_trouble_t
+    int troubles_known; // Set by a trouble event or by all areas reporting no trouble
+
+    char area_names[MAX_AREAS][LABEL_LENGTH];
+    char zone_names[MAX_ZONES][LABEL_LENGTH]; // By slot
+} para_state_t;
+
+static inline int bits_test(const uint64_t *bits, int idx)
+{
+    return (bits[idx / 64] >> (idx % 64)) & 1;
+}
+
+static inline void bits_set(uint64_t *bits, int idx)
+{
+    bits[idx / 64] |= 1ULL << (idx % 64);
+}
+
+static inline void bits_clear(uint64_t *bits, int idx)
+{
+    bits[idx / 64] &= ~(1ULL << (idx % 64));
+}
+
+static inline void bits_assign(uint64_t *bits, int idx, int value)
+{
+    if (value) {
+        bits_set(bits, idx);
+    } else {
+        bits_clear(bits, idx);
+    }
+}
+
+void para_state_init(para_state_t *state);
+
+void para_state_add_area(para_state_t *state, int area_num);
+
+void para_state_add_zone(para_state_t *state, int area_num, int zone_num);
+
+static inline int para_state_has_area(const para_state_t *state, int area_num)
+{
+    return area_num > 0 && area_num <= MAX_AREAS && bits_test(state->areas_monitored, area_num - 1);
+}
+
+static inline int para_state_has_zone(const para_state_t *state, int zone_num)
+{
+    return zone_num > 0 && zone_num <= MAX_ZONES && bits_test(state->zones_monitored, zone_num - 1);
+}
+
+/*
+ * The zone must be monitored.
+ */
+static inline int para_state_zone_idx(const para_state_t *state, int zone_num)
+{
+    return state->zone_slot[zone_num - 1] - 1;
+}
+
+static inline para_zone_state_t *para_state_zone(para_state_t *state, int zone_num)
+{
+    return &state->zones[para_state_zone_idx(state, zone_num)];
+}
+
+static inline const char *para_state_zone_name(const para_state_t *state, int zone_num)
+{
+    return state->zone_names[para_state_zone_idx(state, zone_num)];
+}
+
+static inline int para_state_dirty(const para_state_t *state)
+{
+    uint64_t dirty = 0;
+
+    for (int w = 0; w < PARA_AREA_WORDS; w++) {
+        dirty |= state->areas_dirty[w];
+    }
+
+    for (int w = 0; w < PARA_ZONE_WORDS; w++) {
+        dirty |= state->zones_dirty[w];
+    }
+
+    return dirty != 0;
+}
+
+int para_state_area_set(para_state_t *state, int area_num, para_area_field_t field, char value);
+
+int para_state_zone_set(para_state_t *state, int zone_num, para_zone_field_t field, char value);
+
+void para_state_area_label(para_state_t *state, int area_num, const char *label, size_t len);
+
+void para_state_zone_label(para_state_t *state, int zone_num, const char *label, size_t len);
+
+unsigned para_state_take_area_fields(para_state_t *state, int area_num);
+
+unsigned para_state_take_zone_fields(para_state_t *state, int zone_num);
+
+unsigned para_state_areas_mask(const para_state_t *state);
+
+unsigned para_state_ready_areas(const para_state_t *state);
+
+int para_state_area_count(const para_state_t *state, int area_num, para_zone_bit_t bit);
+
+int para_state_next_area(const uint64_t *bits, int after);
+
+int para_state_next_zone(const uint64_t *bits, int after);
+
+int para_state_pop_dirty_area(para_state_t *state);
+
+int para_state_pop_dirty_zone(para_state_t *state);
+
+void para_state_dirty_reported(para_state_t *state);
+
+#endif /* PARA_STATE_H */
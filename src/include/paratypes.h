@@ -28,8 +28,6 @@
 #define MAX_UTILITY_KEY 251
 
 #define LABEL_LENGTH 17
-#define RECORD_CLEAR 0
-#define RECORD_UPDATED 1
 
 #define HA_ARM_AWAY "ARM_AWAY"
 #define HA_ARM_HOME "ARM_HOME"
@@ -53,34 +51,64 @@ typedef enum {
     MQZ_ON,
 } mqtt_zone_state_t;
 
-typedef struct {
-    int num; // 1-based Area in the panel
-    char name[LABEL_LENGTH];
-    char status;
-    mqtt_panel_state_t mqtt_state; // Pre-calculated state for MQTT HA compatibility
-    char memory;
-    char trouble;
-    char ready;
-    char programming;
-    char alarm;
-    char strobe;
-    int firstreport; // On first report a MQTT control subscription is performed (as otherwise area number is not known)
-    int updated;
-} para_area_t;
+/*
+ * Fields of area and zone state, in the order of PRT3 status bytes.
+ * Changes are tracked and reported as a mask with a bit per field.
+ */
+typedef enum {
+    AF_STATUS = 0,
+    AF_MEMORY,
+    AF_TROUBLE,
+    AF_READY,
+    AF_PROGRAMMING,
+    AF_ALARM,
+    AF_STROBE,
+    AF_MQTT_STATE, // Pre-calculated state for MQTT HA compatibility
+    AF_COUNT,
+} para_area_field_t;
+
+typedef enum {
+    ZF_STATUS = 0,
+    ZF_ALARM,
+    ZF_FIRE,
+    ZF_SUPERVISION,
+    ZF_BATTERY,
+    ZF_BYPASSED,
+    ZF_MQTT_STATE,
+    ZF_COUNT,
+} para_zone_field_t;
+
+#define FIELD_LABEL_BIT (1 << 15) // Label changed, in addition to the field bits
+
+typedef union {
+    struct {
+        char status;
+        char memory;
+        char trouble;
+        char ready;
+        char programming;
+        char alarm;
+        char strobe;
+        char mqtt_state; // mqtt_panel_state_t
+    };
+    char fields[AF_COUNT];
+} para_area_state_t;
 
 typedef struct {
-    int num;
     int area;
-    char name[LABEL_LENGTH];
-    mqtt_zone_state_t mqtt_state;
-    char status;
-    char alarm;
-    char fire;
-    char supervision;
-    char battery;
-    char bypassed;
-    int updated;
-} para_zone_t;
+    union {
+        struct {
+            char status;
+            char alarm;
+            char fire;
+            char supervision;
+            char battery;
+            char bypassed;
+            char mqtt_state; // mqtt_zone_state_t
+        };
+        char fields[ZF_COUNT];
+    };
+} para_zone_state_t;
 
 typedef enum {
     PRT3_EVENT = 'G',
@@ -90,6 +118,7 @@ typedef enum {
     //PRT3_USER = 'U', // TBD
     PRT3_LABEL = 'L',
     PRT3_DISARM = 'D',
+    PRT3_QUICK = 'Q',
 } para_prt3_input_t;
 
 typedef enum {
@@ -134,44 +163,62 @@ typedef enum {
     RZ_LOW_BAT,
 } para_rz_status_bytes_t;
 
+/*
+ * PRT3 event groups: X(name, group number, handler, kind).
+ * The panel manager generates its dispatch table from this list, so
+ * handling another group takes a line here and a handler there. Area
+ * events go through the transition table in para_area.c.
+ * Zone events carry a zone number as the event number, system events
+ * a para_trouble_t code and no area.
+ */
+#define EV_AREA 0
+#define EV_ZONE 1
+#define EV_SYSTEM 2
+#define PARA_EVENT_GROUPS(X) \
+    X(G_ZONE_OK,                            0,  zone_status,  EV_ZONE) \
+    X(G_ZONE_OPEN,                          1,  zone_status,  EV_ZONE) \
+    X(G_ZONE_TAMPERED,                      2,  zone_status,  EV_ZONE) \
+    X(G_ZONE_FIRE_LOOP,                     3,  zone_status,  EV_ZONE) \
+                                                                       \
+    X(G_ARMING_WITH_MASTER,                 9,  area,         EV_AREA) \
+    X(G_ARMING_WITH_USER_CODE,              10, area,         EV_AREA) \
+    X(G_ARMING_WITH_KEYSWITCH,              11, area,         EV_AREA) \
+    X(G_SPECIAL_ARMING,                     12, area,         EV_AREA) \
+                                                                       \
+    X(G_DISARM_WITH_MASTER,                 13, area,         EV_AREA) \
+    X(G_DISARM_WITH_USER_CODE,              14, area,         EV_AREA) \
+    X(G_DISARM_WITH_KEYSWITCH,              15, area,         EV_AREA) \
+    X(G_DISARM_AFTER_ALARM_WITH_MASTER,     16, area,         EV_AREA) \
+    X(G_DISARM_AFTER_ALARM_WITH_USER_CODE,  17, area,         EV_AREA) \
+    X(G_DISARM_AFTER_ALARM_WITH_KEYSWITCH,  18, area,         EV_AREA) \
+    X(G_ALARM_CANCELLED_WITH_MASTER,        19, area,         EV_AREA) \
+    X(G_ALARM_CANCELLED_WITH_USER_CODE,     20, area,         EV_AREA) \
+    X(G_ALARM_CANCELLED_WITH_KEYSWITCH,     21, area,         EV_AREA) \
+    X(G_SPECIAL_DISARM,                     22, area,         EV_AREA) \
+                                                                       \
+    X(G_ZONE_BYPASSED,                      23, zone_bypass,  EV_ZONE) \
+    X(G_ZONE_IN_ALARM,                      24, zone_alarm,   EV_ZONE) \
+    X(G_ZONE_FIRE_ALARM,                    25, zone_alarm,   EV_ZONE) \
+    X(G_ZONE_ALARM_RESTORE,                 26, zone_restore, EV_ZONE) \
+    X(G_ZONE_FIRE_RESTORE,                  27, zone_restore, EV_ZONE) \
+                                                                       \
+    X(G_ZONE_SHUTDOWN,                      32, zone_bypass,  EV_ZONE) \
+    X(G_ZONE_TAMPER,                        33, zone_tamper,  EV_ZONE) \
+    X(G_ZONE_TAMPER_RESTORE,                34, zone_tamper,  EV_ZONE) \
+    X(G_SPECIAL_TAMPER,                     35, log_only,     EV_AREA) \
+    X(G_TROUBLE_EVENT,                      36, trouble,      EV_SYSTEM) \
+    X(G_TROUBLE_RESTORE,                    37, trouble,      EV_SYSTEM) \
+                                                                       \
+    X(G_STATUS_1,                           64, area,         EV_AREA) \
+    X(G_STATUS_2,                           65, area,         EV_AREA) \
+    X(G_STATUS_3,                           66, status_3,     EV_AREA)
+
+#define G_GROUPS_LEN 100 // All the groups PRT3 reports fit below
+
 typedef enum {
-    G_ZONE_OK = 0,
-    G_ZONE_OPEN = 1,
-    G_ZONE_TAMPERED = 2,
-    G_ZONE_FIRE_LOOP = 3,
-
-    G_ARMING_WITH_MASTER = 9,
-    G_ARMING_WITH_USER_CODE = 10,
-    G_ARMING_WITH_KEYSWITCH = 11,
-    G_SPECIAL_ARMING = 12,
-
-    G_DISARM_WITH_MASTER = 13,
-    G_DISARM_WITH_USER_CODE = 14,
-    G_DISARM_WITH_KEYSWITCH = 15,
-    G_DISARM_AFTER_ALARM_WITH_MASTER = 16,
-    G_DISARM_AFTER_ALARM_WITH_USER_CODE = 17,
-    G_DISARM_AFTER_ALARM_WITH_KEYSWITCH = 18,
-    G_ALARM_CANCELLED_WITH_MASTER = 19,
-    G_ALARM_CANCELLED_WITH_USER_CODE = 20,
-    G_ALARM_CANCELLED_WITH_KEYSWITCH = 21,
-    G_SPECIAL_DISARM = 22,
-
-    G_ZONE_BYPASSED = 23,
-    G_ZONE_IN_ALARM = 24,
-    G_ZONE_FIRE_ALARM = 25,
-    G_ZONE_ALARM_RESTORE = 26,
-    G_ZONE_FIRE_RESTORE = 27,
-
-    G_ZONE_SHUTDOWN = 32,
-    G_ZONE_TAMPER = 33,
-    G_ZONE_TAMPER_RESTORE = 34,
-    G_SPECIAL_TAMPER = 35,
-    G_TROUBLE_EVENT = 36,
-    G_TROUBLE_RESTORE = 37,
-
-    G_STATUS_1 = 64,
-    G_STATUS_2 = 65,
-    G_STATUS_3 = 66,
+#define X(name, group, handler, kind) name = group,
+    PARA_EVENT_GROUPS(X)
+#undef X
 } para_event_group_t;
 
 typedef enum {
@@ -183,6 +230,7 @@ typedef enum {
     T_BELL_ABSENT,
     T_CLOCK_TROUBLE,
     T_GLOBAL_FIRE_LOOP,
+    T_COUNT,
 } para_trouble_t;
 
 typedef enum {
@@ -207,11 +255,26 @@ typedef enum {
     S2_KEYPAD_LOCKOUT,
 } para_status_2_t;
 
+typedef enum {
+    S3_INTELLIZONE_DELAY = 0,
+    S3_FIRE_DELAY,
+    S3_AUTO_ARM,
+    S3_VOICE_ARMING,
+    S3_TAMPER,
+    S3_ZONE_LOW_BATTERY,
+    S3_FIRE_LOOP_TROUBLE,
+    S3_ZONE_SUPERVISION_TROUBLE,
+} para_status_3_t;
+
 typedef enum {
     CMD_AREA_CONTROL = 0,
     CMD_UTILITY_KEY,
     CMD_VIRTUAL_INTPUT,
     CMD_VIRTUAL_PGM,
+    CMD_AREA_GET,
+    CMD_ZONE_GET,
+    CMD_DUMP,
+    CMD_HISTORY,
 } para_command_type_t;
 
 typedef enum {
@@ -220,10 +283,18 @@ typedef enum {
     AC_DISARM,
 } para_arm_cmd_e_t;
 
+typedef enum {
+    CR_OK = 0, // Echoed by PRT3 and the area got there
+    CR_FAIL, // PRT3 answered &fail: a wrong code, the area not ready
+    CR_TIMEOUT, // No echo or the area did not get there in time
+    CR_REFUSED, // Not sent, e.g. disarm without user code
+} para_cmd_result_t;
+
 typedef struct {
     para_command_type_t type;
     int num;
     para_arm_cmd_e_t command;
+    int count; // CMD_HISTORY only
 } para_arm_cmd_t;
 
 #endif /* PARA_TYPES_H */
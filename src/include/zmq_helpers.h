@@ -29,6 +29,8 @@ int z_start_endpoint(void *context, void **socket, const int type, const char *e
 
 int z_connect_endpoint(void *context, void **socket, const int type, const char *endpoint);
 
+const char *z_panel_endpoint(char *buffer, const char *pattern, int panel);
+
 void z_drop_message(void *socket);
 
 char *z_receive_string(void *socket);
@@ -55,7 +55,11 @@
 #include "log.h"
 #include "config.h"
 #include "mqtt_mgr.h"
+#include "mqtt_queue.h"
+#include "para_replay.h"
+#include "para_history.h"
 #include "para_mgr.h"
+#include "para_sched.h"
 #include "para_serial.h"
 #include "endpoints.h"
 
@@ -68,8 +72,43 @@ para_evo_config_t config = {
     .mqtt_login = NULL,
     .mqtt_password = NULL,
     .mqtt_retain = 0,
+    .mqtt_republish = 0,
+    .mqtt_queue_count = MQTT_QUEUE_DEFAULT_COUNT,
+    .mqtt_queue_bytes = MQTT_QUEUE_DEFAULT_BYTES,
+    .mqtt_drain_rate = MQTT_QUEUE_DEFAULT_DRAIN,
+    .publish = {
+        PUBLISH_DEFAULT,
+        PUBLISH_DEFAULT,
+        PUBLISH_DEFAULT,
+        PUBLISH_DEFAULT,
+        PUBLISH_DEFAULT,
+        PUBLISH_DEFAULT,
+    },
     .user_code = NULL,
     .area_status_period = 60,
+    .prt3_window = PARA_SCHED_DEFAULT_WINDOW,
+    .prt3_timeout = PARA_SCHED_DEFAULT_TIMEOUT,
+    .coalesce = 0,
+    .history = PARA_HISTORY_DEFAULT,
+    .panel_count = 1,
+};
+
+// Long options without a short switch
+enum {
+    OPT_PRT3_WINDOW = 256,
+    OPT_PRT3_TIMEOUT,
+    OPT_RECORD,
+    OPT_REPLAY,
+    OPT_SPEED,
+    OPT_PANEL_TOPIC,
+    OPT_COALESCE,
+    OPT_SNAPSHOT,
+    OPT_HISTORY,
+    OPT_REPUBLISH,
+    OPT_QUEUE_COUNT,
+    OPT_QUEUE_BYTES,
+    OPT_DRAIN_RATE,
+    OPT_PUBLISH,
 };
 
 void *killpublisher = NULL;
@@ -77,7 +116,9 @@ void *killpublisher = NULL;
 /* Function headers */
 void print_usage();
 static int create_daemon();
+static int next_panel(int panel);
 static void s_catch_signals();
+static void s_signal_handler(int signal_value);
 
 int main(int argc, char **argv)
 {
@@ -108,6 +149,20 @@ int main(int argc, char **argv)
         {"device",        required_argument, 0, 'd'},
         {"user_code",     required_argument, 0, 'u'},
         {"status_period", required_argument, 0, 'S'},
+        {"prt3_window",   required_argument, 0, OPT_PRT3_WINDOW},
+        {"prt3_timeout",  required_argument, 0, OPT_PRT3_TIMEOUT},
+        {"record",        required_argument, 0, OPT_RECORD},
+        {"replay",        required_argument, 0, OPT_REPLAY},
+        {"speed",         required_argument, 0, OPT_SPEED},
+        {"panel_topic",   required_argument, 0, OPT_PANEL_TOPIC},
+        {"coalesce",      required_argument, 0, OPT_COALESCE},
+        {"history",       required_argument, 0, OPT_HISTORY},
+        {"republish",     no_argument,       0, OPT_REPUBLISH},
+        {"queue_count",   required_argument, 0, OPT_QUEUE_COUNT},
+        {"queue_bytes",   required_argument, 0, OPT_QUEUE_BYTES},
+        {"drain_rate",    required_argument, 0, OPT_DRAIN_RATE},
+        {"publish",       required_argument, 0, OPT_PUBLISH},
+        {"snapshot",      required_argument, 0, OPT_SNAPSHOT},
         {"help",          no_argument,       0, 'h'},
         {"verbose",       no_argument,       0, 'v'},
         {0, 0, 0, 0}
@@ -119,10 +174,16 @@ int main(int argc, char **argv)
     int c = 0;
     int areanum = 0;
 
-    int areaset = 0;
-    int zonesset = 0;
+    // Options of areas, zones, device etc. apply to the current panel.
+    int panel = 0;
+    int areaset[MAX_PANELS] = {0};
+    int zonesset[MAX_PANELS] = {0};
 
-    char *serialdevice = NULL;
+    double replayspeed = 1;
+
+    for (int i = 0; i < MAX_PANELS; i++) {
+        config.panels[i].index = i;
+    }
 
     while(1) {
         c = getopt_long(argc, argv, "m:p:t:l:w:ra:z:Dd:u:S:hv", long_options, &opt_idx);
@@ -171,8 +232,9 @@ int main(int argc, char **argv)
                     goto EXIT_MAIN;
                 }
 
-                if (para_mgr_set_area(areanum) == 0) {
-                    areaset = 1;
+                if (para_mgr_set_area(panel, areanum) == 0) {
+                    mqtt_mgr_set_area(panel, areanum);
+                    areaset[panel] = 1;
                 }
             break;
 
@@ -194,8 +256,9 @@ int main(int argc, char **argv)
                         goto EXIT_MAIN;
                     }
 
-                    if (para_mgr_set_zone(areanum, zoneindex) == 0) {
-                        zonesset = 1;
+                    if (para_mgr_set_zone(panel, areanum, zoneindex) == 0) {
+                        mqtt_mgr_set_zone(panel, areanum, zoneindex);
+                        zonesset[panel] = 1;
                     }
 
                     zone = strtok(NULL, ",");
@@ -205,7 +268,17 @@ int main(int argc, char **argv)
             break;
 
             case 'd':
-                serialdevice = optarg;
+                if ((panel = next_panel(panel)) < 0) {
+                    return_main = -13;
+                    goto EXIT_MAIN;
+                }
+
+                if (panel != config.panel_count - 1) {
+                    areanum = 0;
+                }
+
+                config.panel_count = panel + 1;
+                config.panels[panel].device = optarg;
             break;
 
             case 'u':
@@ -222,6 +295,124 @@ int main(int argc, char **argv)
                 }
             break;
 
+            case OPT_PRT3_WINDOW:
+                config.prt3_window = strtol(optarg, NULL, 10);
+
+                if (config.prt3_window < 1 || config.prt3_window > PARA_SCHED_MAX_WINDOW) {
+                    log_error("PARAEVO: PRT3 request window must be 1 to %d!\n", PARA_SCHED_MAX_WINDOW);
+                    return_main = -10;
+                    goto EXIT_MAIN;
+                }
+            break;
+
+            case OPT_PRT3_TIMEOUT:
+                config.prt3_timeout = strtol(optarg, NULL, 10);
+
+                if (config.prt3_timeout < 50) {
+                    log_error("PARAEVO: PRT3 response timeout cannot be shorter than 50 ms!\n");
+                    return_main = -11;
+                    goto EXIT_MAIN;
+                }
+            break;
+
+            case OPT_COALESCE:
+                config.coalesce = strtol(optarg, NULL, 10);
+
+                if (config.coalesce < 0 || config.coalesce > PARA_MGR_MAX_COALESCE) {
+                    log_error("PARAEVO: coalescing window must be 0 to %d ms!\n", PARA_MGR_MAX_COALESCE);
+                    return_main = -14;
+                    goto EXIT_MAIN;
+                }
+            break;
+
+            case OPT_REPUBLISH:
+                config.mqtt_republish = 1;
+            break;
+
+            case OPT_QUEUE_COUNT:
+                config.mqtt_queue_count = strtol(optarg, NULL, 10);
+
+                if (config.mqtt_queue_count < 0 || config.mqtt_queue_count > MQTT_QUEUE_MAX_COUNT) {
+                    log_error("PARAEVO: outbound queue must be 0 to %d messages!\n", MQTT_QUEUE_MAX_COUNT);
+                    return_main = -16;
+                    goto EXIT_MAIN;
+                }
+            break;
+
+            case OPT_QUEUE_BYTES:
+                config.mqtt_queue_bytes = strtol(optarg, NULL, 10);
+
+                if (config.mqtt_queue_bytes < 1024) {
+                    log_error("PARAEVO: outbound queue must be at least 1024 bytes!\n");
+                    return_main = -17;
+                    goto EXIT_MAIN;
+                }
+            break;
+
+            case OPT_DRAIN_RATE:
+                config.mqtt_drain_rate = strtol(optarg, NULL, 10);
+
+                if (config.mqtt_drain_rate < 1 || config.mqtt_drain_rate > 10000) {
+                    log_error("PARAEVO: drain rate must be 1 to 10000 messages per second!\n");
+                    return_main = -18;
+                    goto EXIT_MAIN;
+                }
+            break;
+
+            case OPT_PUBLISH:
+                if (mqtt_mgr_set_publish(optarg) != 0) {
+                    log_error("PARAEVO: publish profile %s is not valid!\n", optarg);
+                    return_main = -19;
+                    goto EXIT_MAIN;
+                }
+            break;
+
+            case OPT_HISTORY:
+                config.history = strtol(optarg, NULL, 10);
+
+                if (config.history < 0 || config.history > PARA_HISTORY_MAX) {
+                    log_error("PARAEVO: event history must be 0 to %d events!\n", PARA_HISTORY_MAX);
+                    return_main = -15;
+                    goto EXIT_MAIN;
+                }
+            break;
+
+            case OPT_RECORD:
+                config.panels[panel].record_file = optarg;
+            break;
+
+            case OPT_SNAPSHOT:
+                config.panels[panel].snapshot_file = optarg;
+            break;
+
+            case OPT_REPLAY:
+                if ((panel = next_panel(panel)) < 0) {
+                    return_main = -13;
+                    goto EXIT_MAIN;
+                }
+
+                if (panel != config.panel_count - 1) {
+                    areanum = 0;
+                }
+
+                config.panel_count = panel + 1;
+                config.panels[panel].replay_file = optarg;
+            break;
+
+            case OPT_PANEL_TOPIC:
+                config.panels[panel].topic = optarg;
+            break;
+
+            case OPT_SPEED:
+                replayspeed = strtod(optarg, NULL);
+
+                if (replayspeed < 0) {
+                    log_error("PARAEVO: replay speed cannot be negative!\n");
+                    return_main = -12;
+                    goto EXIT_MAIN;
+                }
+            break;
+
             case 'D':
                 opt_daemon = 1;
             break;
@@ -248,22 +439,36 @@ int main(int argc, char **argv)
         goto EXIT_MAIN;
     }
 
-    if (!areaset) {
-        log_error("PARAEVO: No area was set! Exiting.\n");
-        return_main = -5;
-        goto EXIT_MAIN;
-    }
+    for (int i = 0; i < config.panel_count; i++) {
+        para_panel_config_t *p = &config.panels[i];
 
-    if (!zonesset) {
-        fprintf(stderr, "PARAEVO: Not a single zone was set! Exiting.\n");
-        return_main = -6;
-        goto EXIT_MAIN;
-    }
+        if (!areaset[i]) {
+            log_error("PARAEVO: No area was set for panel %d! Exiting.\n", i + 1);
+            return_main = -5;
+            goto EXIT_MAIN;
+        }
 
-    if (!serialdevice) {
-        fprintf(stderr, "PARAEVO: No serial device was set for PRT3! Exiting.\n");
-        return_main = -7;
-        goto EXIT_MAIN;
+        if (!zonesset[i]) {
+            fprintf(stderr, "PARAEVO: Not a single zone was set for panel %d! Exiting.\n", i + 1);
+            return_main = -6;
+            goto EXIT_MAIN;
+        }
+
+        if (!p->device && !p->replay_file) {
+            fprintf(stderr, "PARAEVO: No serial device was set for PRT3! Exiting.\n");
+            return_main = -7;
+            goto EXIT_MAIN;
+        }
+
+        // The first panel keeps the topics it always had.
+        if (!p->topic) {
+            if (i == 0) {
+                p->topic = config.mqtt_topic;
+            } else {
+                snprintf(p->default_topic, PANEL_TOPIC_SIZE, "%s/panel%d", config.mqtt_topic, i + 1);
+                p->topic = p->default_topic;
+            }
+        }
     }
 
     if (!config.mqtt_server) {
@@ -296,17 +501,44 @@ int main(int argc, char **argv)
    
     s_catch_signals();
 
-    pthread_t pstid = start_para_serial(serialdevice, context);
-    pthread_t pmgrtid = para_mgr_start(context);
+    // A serial (or replay) and a manager thread per panel, one MQTT manager for all.
+    pthread_t pstid[MAX_PANELS];
+    pthread_t pmgrtid[MAX_PANELS];
+
+    for (int i = 0; i < config.panel_count; i++) {
+        if (config.panels[i].replay_file) {
+            pstid[i] = start_para_replay(&config.panels[i], replayspeed, context);
+        } else {
+            pstid[i] = start_para_serial(&config.panels[i], context);
+        }
+
+        if (!pstid[i]) {
+            log_info("PARAEVO: Error creating the SERIAL thread of panel %d\n", i + 1);
+
+            if (i > 0) {
+                // Lamely give time for the started ones to subscribe to KILL.
+                sleep(2);
+                s_signal_handler(0);
+
+                for (int j = 0; j < i; j++) {
+                    pthread_join(pstid[j], NULL);
+                    pthread_join(pmgrtid[j], NULL);
+                }
+            }
+
+            goto EXIT_MAIN;
+        }
+
+        pmgrtid[i] = para_mgr_start(i, context);
+    }
+
     pthread_t mmgrid = mqtt_mgr_start(context);
 
-    if (pstid) {
-        pthread_join(pstid, NULL);
-    } else {
-        log_info("PARAEVO: Error creating the SERIAL thread\n");
-        goto EXIT_MAIN;
+    for (int i = 0; i < config.panel_count; i++) {
+        pthread_join(pstid[i], NULL);
+        pthread_join(pmgrtid[i], NULL);
     }
-    pthread_join(pmgrtid, NULL);
+
     pthread_join(mmgrid, NULL);
 
 EXIT_MAIN:
@@ -324,6 +556,23 @@ EXIT_MAIN:
     return return_main;
 }
 
+/*
+ * A device or replay given to a panel which already has one starts the next panel.
+ */
+static int next_panel(int panel)
+{
+    if (!config.panels[panel].device && !config.panels[panel].replay_file) {
+        return panel;
+    }
+
+    if (panel + 1 >= MAX_PANELS) {
+        log_error("PARAEVO: no more than %d panels are supported!\n", MAX_PANELS);
+        return -1;
+    }
+
+    return panel + 1;
+}
+
 static int create_daemon()
 {
     pid_t pid = fork();
@@ -366,12 +615,16 @@ static void s_catch_signals()
 void print_usage()
 {
     printf(
-        "Usage: paraevo -d <USART device> -a <area> -z <zone list> --mqtt_server=<server address> [options]\n"
+        "Usage: paraevo -d <USART device> -a <area> -z <zone list> [-d <USART device> -a <area> -z <zone list>...]\n"
+        "               --mqtt_server=<server address> [options]\n"
         "\n"
         "Main options:\n"
         "  -D, --daemon                             Run application in daemon mode.\n"
         "  -d <device>   --device=<device>          Set device of PRT3 module.\n"
         "                                           E.g. paraevo -d /dev/ttyUSB0\n"
+        "                                           Each next -d starts another panel: the -a, -z,\n"
+        "                                           --panel_topic, --record and --snapshot following\n"
+        "                                           it belong to that panel.\n"
         "  -a <area>     --area=<area>              Set an area number to monitor. Several areas\n"
         "                                           can be provided, e.g. -a 1 -a 2\n"
         "  -z <zones>    --zones=<zones>            Assign zones to an area by comma-separated\n"
@@ -385,11 +638,47 @@ void print_usage()
         "Additional options:\n"
         "  -p <port>     --mqtt_port=<port>         Set MQTT server's port. Default 1883.\n"
         "  -t <topic>    --mqtt_topic=<topic>       Set parent MQTT topic. Default \"darauble/paraevo\".\n"
+        "  --panel_topic=<topic>                    Set MQTT topic of the current panel. Default is the\n"
+        "                                           parent topic for the first panel and\n"
+        "                                           <parent topic>/panel<N> for the others.\n"
         "  -l <login>    --mqtt_login=<login>       Set a username/login for MQTT server (if required).\n"
         "  -w <pass>     --mqtt_password=<pass>     Set a password for MQTT server (if required).\n"
         "  -r,           --mqtt_retain              If given, all messages sent by the daemon will be retained.\n"
-        "  -S <seconds>  --status_period=<seconds>  An idle timeout when to request Area Status update.\n"
-        "                                           Minimum is 60 s (and it's default).\n"
+        "  --republish                              Publish all area, zone, readiness and trouble topics\n"
+        "                                           every 60 s, not only their changes.\n"
+        "  --queue_count=<count>                    How many messages to keep while MQTT server is\n"
+        "                                           unreachable, one per topic. Default 1024, 0 keeps none.\n"
+        "  --queue_bytes=<bytes>                    Memory limit of the kept messages. Default 262144.\n"
+        "  --drain_rate=<count>                     Kept messages sent per second after reconnect.\n"
+        "                                           Default 100.\n"
+        "  --publish=<class>:<settings>             QoS, retain and enable of a class of topics:\n"
+        "                                           area_state, area_json, zone_state, zone_alarm,\n"
+        "                                           zone_json or heartbeat. Settings are a comma list\n"
+        "                                           of qos0, qos1, qos2, retain, noretain, on and off,\n"
+        "                                           e.g. --publish=zone_state:qos0 --publish=zone_json:off\n"
+        "                                           Default is qos1, retain as given by -r, on.\n"
+        "  -S <seconds>  --status_period=<seconds>  How often each area's status is confirmed by a\n"
+        "                                           request. Shortened down to a quarter while events\n"
+        "                                           disagree with it. Minimum is 60 s (and it's default).\n"
+        "  --prt3_window=<count>                    How many requests may await PRT3 response at once.\n"
+        "                                           Default 4, maximum 16.\n"
+        "  --prt3_timeout=<ms>                      How long to wait for PRT3 response before resending\n"
+        "                                           a status or label request, commands are not\n"
+        "                                           resent. Default 500 ms.\n"
+        "  --coalesce=<ms>                          Gather area and zone changes for this long into\n"
+        "                                           one report. Alarms are reported at once.\n"
+        "                                           Default 0 (no delay), maximum 1000 ms.\n"
+        "  --history=<count>                        How many last events to keep per panel for\n"
+        "                                           history queries. Default 256, 0 keeps none.\n"
+        "  --record=<file>                          Append every line read from and written to PRT3\n"
+        "                                           with timestamps to a capture file.\n"
+        "  --snapshot=<file>                        Keep labels and last known state in this file.\n"
+        "                                           On start they are published at once and only\n"
+        "                                           statuses are requested from the panel.\n"
+        "  --replay=<file>                          Feed a capture to the daemon instead of PRT3 device.\n"
+        "                                           Starts another panel just like -d.\n"
+        "  --speed=<factor>                         Replay speed: 1 is real time (default), 0 is as\n"
+        "                                           fast as possible.\n"
         "\n"
         "Other options:\n"
         "  -v, --verbose                            Print verbose output of daemon's actions.\n"
@@ -0,0 +1,110 @@
+/*
+ * The source of the MQTT daemon interacting with Paradox EVO control panel
+ * via their's PRT3 module.
+ *
+ * mqtt_json.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Darau, blė
+ *
+ *  This file is a part of personal use utilities developed to be used
+ *  on various Linux devices.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "log.h"
+#include "mqtt_json.h"
+
+// A field not known yet is a space, so the object stays valid.
+#define SLOT_VALUE(c) ((c) ? (c) : ' ')
+
+/*
+ * Label as a JSON string body: quotes and backslashes escaped, control
+ * characters as \u00XX. Returns the length written, out is cut at size.
+ */
+size_t mqtt_json_escape(char *out, size_t size, const char *label)
+{
+    size_t pos = 0;
+
+    for (const unsigned char *c = (const unsigned char *) label; *c; c++) {
+        char escaped[8];
+        int len;
+
+        if (*c == '"' || *c == '\\') {
+            len = snprintf(escaped, sizeof(escaped), "\\%c", *c);
+        } else if (*c < 0x20) {
+            len = snprintf(escaped, sizeof(escaped), "\\u%04x", *c);
+        } else {
+            escaped[0] = *c;
+            len = 1;
+        }
+
+        if (pos + len >= size) {
+            break;
+        }
+
+        memcpy(out + pos, escaped, len);
+        pos += len;
+    }
+
+    out[pos] = 0;
+
+    return pos;
+}
+
+/*
+ * Head is the object start up to the fields, e.g. {"num": 1,"name": "Hall",
+ * the fields follow as ,"key": "c" and the object is closed. Returns -1 if it does not fit.
+ */
+int mqtt_json_render(mqtt_json_t *json, const char *head, const char **keys, int key_count, const char *fields)
+{
+    int pos = snprintf(json->str, MQTT_JSON_SIZE, "%s", head);
+
+    json->len = 0;
+    json->slot_count = 0;
+
+    for (int k = 0; k < key_count && k < MQTT_JSON_SLOTS && pos < MQTT_JSON_SIZE; k++) {
+        pos += snprintf(json->str + pos, MQTT_JSON_SIZE - pos, ",\"%s\": \"", keys[k]);
+
+        if (pos < MQTT_JSON_SIZE) {
+            json->slots[json->slot_count++] = pos;
+            pos += snprintf(json->str + pos, MQTT_JSON_SIZE - pos, "%c\"", SLOT_VALUE(fields[k]));
+        }
+    }
+
+    if (pos < MQTT_JSON_SIZE) {
+        pos += snprintf(json->str + pos, MQTT_JSON_SIZE - pos, "}");
+    }
+
+    if (pos >= MQTT_JSON_SIZE || json->slot_count < key_count) {
+        log_error("JSON: object of %d fields does not fit: %s\n", key_count, head);
+        return -1;
+    }
+
+    json->len = pos;
+
+    return 0;
+}
+
+/*
+ * Write the fields of the mask bits to their slots.
+ */
+void mqtt_json_patch(mqtt_json_t *json, const char *fields, unsigned mask)
+{
+    for (int s = 0; s < json->slot_count; s++) {
+        if (mask & (1U << s)) {
+            json->str[json->slots[s]] = SLOT_VALUE(fields[s]);
+        }
+    }
+}
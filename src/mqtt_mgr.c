@@ -1,3 +1,6 @@
+#include <signal.h>
+#include <stdarg.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -5,8 +8,13 @@
 #include "config.h"
 #include "endpoints.h"
 #include "log.h"
+#include "mqtt_json.h"
 #include "mqtt_mgr.h"
+#include "mqtt_queue.h"
+#include "para_mgr.h"
+#include "para_report.h"
 #include "paratypes.h"
+#include "time_helpers.h"
 #include "zmq_helpers.h"
 
 #include "MQTTAsync.h"
@@ -17,37 +25,43 @@ extern para_evo_config_t config;
 #define AREA_TOPIC_PREFIX "%s/area/"
 #define MAIN_AREA_TOPIC AREA_TOPIC_PREFIX "%d"
 #define LWT_TOPIC "%s/daemon"
+#define READY_TOPIC "%s/daemon/ready"
+#define TROUBLE_TOPIC "%s/trouble"
 #define AREA_CONTROL_SET "/set"
 #define AREA_CONTROL_TOPIC MAIN_AREA_TOPIC AREA_CONTROL_SET
-#define AREA_STATE_TOPIC MAIN_AREA_TOPIC "/state"
-#define AREA_STATE_JSON "{" \
+#define REFRESH_GET "/get"
+#define AREA_REFRESH_TOPIC AREA_TOPIC_PREFIX "+" REFRESH_GET
+#define ZONE_REFRESH_TOPIC AREA_TOPIC_PREFIX "+/zone/+" REFRESH_GET
+#define DUMP_TOPIC "%s/dump"
+#define HISTORY_TOPIC "%s/history"
+#define AREA_HISTORY_TOPIC MAIN_AREA_TOPIC "/history"
+#define HISTORY_GET_TOPIC HISTORY_TOPIC REFRESH_GET
+#define AREA_HISTORY_GET_TOPIC AREA_TOPIC_PREFIX "+/history" REFRESH_GET
+#define HISTORY_EVENT_JSON "{" \
+    "\"age\": %u," \
+    "\"event\": \"%s\"," \
+    "\"group\": %d," \
     "\"num\": %d," \
-    "\"name\": \"%s\"," \
+    "\"area\": %d," \
     "\"status\": \"%c\"," \
-    "\"memory\": \"%c\"," \
-    "\"trouble\": \"%c\"," \
-    "\"ready\": \"%c\"," \
-    "\"programming\": \"%c\"," \
-    "\"alarm\": \"%c\"," \
-    "\"strobe\": \"%c\"" \
+    "\"state\": \"%s\"" \
 "}"
+#define HISTORY_EVENT_SIZE 160
+#define AREA_STATE_TOPIC MAIN_AREA_TOPIC "/state"
+#define AREA_RESULT_TOPIC MAIN_AREA_TOPIC "/result"
+#define AREA_STATE_JSON_HEAD "{" \
+    "\"num\": %d," \
+    "\"name\": \"%s\""
 
 #define UTILITY_KEY_TOPIC "%s/utilitykey"
 
 #define ZONE_STATUS_TOPIC MAIN_AREA_TOPIC "/zone/%d"
 #define ZONE_ALARM_TOPIC MAIN_AREA_TOPIC "/zone/%d/alarm"
 #define ZONE_STATE_TOPIC MAIN_AREA_TOPIC "/zone/%d/state"
-#define ZONE_STATE_JSON "{" \
+#define ZONE_STATE_JSON_HEAD "{" \
     "\"num\": %d," \
     "\"area\": %d," \
-    "\"name\": \"%s\"," \
-    "\"status\": \"%c\"," \
-    "\"alarm\": \"%c\"," \
-    "\"fire\": \"%c\"," \
-    "\"supervision\": \"%c\"," \
-    "\"battery\": \"%c\"," \
-    "\"bypassed\": \"%c\"" \
-"}"
+    "\"name\": \"%s\""
 
 #define DAEMON_ONLINE "online"
 #define DAEMON_OFFLINE "offline"
@@ -55,6 +69,13 @@ extern para_evo_config_t config;
 #define TOPIC_SIZE 256
 #define PAYLOAD_SIZE 256
 
+#define MQTT_HEARTBEAT 60000 // ms between LWT messages and republishing, if configured
+#define MQTT_WAKEUP 1000 // ms to notice a reconnect at the latest
+#define MQTT_DRAIN_TICK 100 // ms between batches of queued messages
+
+#define PUB_FIXED PUB_COUNT // Readiness and troubles, they have the default profile
+#define PROFILE_RETAIN(profile) ((profile)->retain < 0 ? config.mqtt_retain : (profile)->retain)
+
 static char topic[TOPIC_SIZE];
 static char payload[PAYLOAD_SIZE];
 static char lwt_topic[TOPIC_SIZE];
@@ -78,18 +99,166 @@ static const char *mqz_states[] = {
     "on",
 };
 
+// Keys of the state JSON fields, by para_area_field_t and para_zone_field_t
+static const char *area_json_keys[] = {
+    "status",
+    "memory",
+    "trouble",
+    "ready",
+    "programming",
+    "alarm",
+    "strobe",
+};
+
+static const char *zone_json_keys[] = {
+    "status",
+    "alarm",
+    "fire",
+    "supervision",
+    "battery",
+    "bypassed",
+};
+
+#define AREA_JSON_KEYS (int) (sizeof(area_json_keys) / sizeof(area_json_keys[0]))
+#define ZONE_JSON_KEYS (int) (sizeof(zone_json_keys) / sizeof(zone_json_keys[0]))
+
+// By para_publish_class_t
+static const char *publish_classes[PUB_COUNT] = {
+    "area_state",
+    "area_json",
+    "zone_state",
+    "zone_alarm",
+    "zone_json",
+    "heartbeat",
+};
+
+static const para_publish_profile_t publish_fixed = PUBLISH_DEFAULT;
+
+// By para_arm_cmd_e_t and para_cmd_result_t
+static const char *command_names[] = {
+    HA_ARM_AWAY,
+    HA_ARM_HOME,
+    HA_DISARM,
+};
+
+static const char *command_results[] = {
+    "ok",
+    "fail",
+    "timeout",
+    "refused",
+};
+
+// Names of PR_TROUBLE bits, by para_trouble_t
+static const char *trouble_names[T_COUNT] = {
+    "tlm",
+    "ac_failure",
+    "battery_failure",
+    "auxiliary_current_limit",
+    "bell_current_limit",
+    "bell_absent",
+    "clock",
+    "global_fire_loop",
+};
+
+// Names of event groups for the history, zone events carry a zone state.
+static const struct {
+    const char *name;
+    int kind;
+} event_groups[G_GROUPS_LEN] = {
+#define X(name, group, handler, kind) [group] = { #name + 2, kind },
+    PARA_EVENT_GROUPS(X)
+#undef X
+};
+
+// Topic classes of areas and zones, zones have no set and result topics.
+typedef enum {
+    TT_STATE, // area/N or area/N/zone/M
+    TT_JSON, // .../state
+    TT_ALARM, // area/N/zone/M/alarm
+    TT_SET, // area/N/set
+    TT_RESULT, // area/N/result
+    TT_COUNT,
+} mqtt_topic_class_t;
+
+// Topics are formatted once, publishing only picks them up. The fingerprint
+// of the last payload published keeps the same payload from going out again.
+typedef struct {
+    char *str;
+    size_t len;
+    uint64_t fingerprint;
+    int published;
+} mqtt_topic_t;
+
+// Last known state of areas and zones, panel reports carry only the changes.
+typedef struct {
+    para_area_state_t state;
+    char name[LABEL_LENGTH];
+    int subscribed; // On first report a MQTT control subscription is performed (as otherwise area number is not known)
+    int configured;
+    mqtt_topic_t topics[TT_COUNT];
+    mqtt_json_t json;
+} mqtt_area_t;
+
+typedef struct {
+    para_zone_state_t state;
+    char name[LABEL_LENGTH];
+    int configured;
+    int topic_area; // Area the topics were formatted for
+    mqtt_topic_t topics[TT_COUNT];
+    mqtt_json_t json;
+} mqtt_zone_t;
+
+// Last readiness and troubles of a panel, kept to republish them.
+typedef struct {
+    mqtt_topic_t ready_topic;
+    mqtt_topic_t trouble_topic;
+    unsigned ready_mask;
+    unsigned ready;
+    int ready_known;
+    unsigned troubles;
+    int troubles_known;
+} mqtt_panel_t;
+
+// A command of a Paho callback on its way to the panel through the MQTT thread.
+typedef struct {
+    int panel;
+    para_arm_cmd_t cmd;
+} mqtt_control_t;
+
+static mqtt_area_t areas[MAX_PANELS][MAX_AREAS];
+static mqtt_zone_t zones[MAX_PANELS][MAX_ZONES];
+static mqtt_panel_t panels[MAX_PANELS];
+
+// Set by Paho on every (re)connect, the broker may have lost what was published.
+static volatile sig_atomic_t mqtt_resync = 0;
+static unsigned long mqtt_suppressed = 0;
+
+// Messages held while the broker is unreachable, only the MQTT thread touches it.
+static mqtt_queue_t outbound;
+static long long drain_at = 0;
+
 static MQTTAsync client;
 
 static void *mqtt_mgr_thread(void *context);
 static void mqtt_start();
 static void mqtt_subscribe();
-static void mqtt_area_report(void *area_report_reader);
-static void mqtt_zone_report(void *zone_report_reader);
-static void mqtt_send(const char *topic, const char *payload);
+static void mqtt_report(void *report_reader);
+static void mqtt_area_report(const para_report_t *report);
+static void mqtt_zone_report(const para_report_t *report);
+static void mqtt_ready_report(const para_report_t *report);
+static void mqtt_history_report(const para_report_t *report);
+static void mqtt_trouble_report(const para_report_t *report);
+static void mqtt_command_report(const para_report_t *report);
+static void mqtt_send_topic(mqtt_topic_t *topic, int class, const char *payload, size_t len);
+static void mqtt_send_response(const char *topic, const char *payload);
+static int mqtt_publish(const char *topic, const char *payload, int len, int qos, int retained, void *owner);
+static void mqtt_queue_dropped(void *owner);
+static void mqtt_drain();
 static void mqtt_send_lwt();
 static void mqtt_stop();
 
 static void onConnect(void* context, MQTTAsync_successData* response);
+static void onConnected(void* context, char* cause);
 static void onConnectFailure(void* context, MQTTAsync_failureData* response);
 static void onDisconnect(void* context, MQTTAsync_successData* response);
 static void onDisconnectFailure(void* context, MQTTAsync_failureData* response);
@@ -98,11 +267,102 @@ static void onDisconnectFailure(void* context, MQTTAsync_failureData* response);
 static void onSubscribe(void* context, MQTTAsync_successData* response);
 static void onSubscribeFailure(void* context, MQTTAsync_failureData* response);
 
-static void *mqtt_area_command = NULL;
+static void mqtt_send_command(int panel, para_arm_cmd_t *cmd);
+static void mqtt_send_control(int panel, para_arm_cmd_t *cmd);
+static void mqtt_control(void *control_reader);
+static int mqtt_refresh_control(int panel, const char *area_topic);
+static void mqtt_history_control(int panel, int area_num, MQTTAsync_message *message);
+
+static int mqtt_topic_intern(mqtt_topic_t *topic, const char *format, ...);
+static int mqtt_area_topics(int panel, int num);
+static int mqtt_zone_topics(int panel, int area, int num);
+static void mqtt_topics_build();
+static void mqtt_topics_free();
+static void mqtt_area_publish(int panel, int num);
+static void mqtt_zone_publish(int panel, int num);
+static void mqtt_ready_publish(int panel);
+static void mqtt_trouble_publish(int panel);
+static void mqtt_forget_area(int panel, int num);
+static void mqtt_forget_zone(int panel, int num);
+static void mqtt_republish(int panel);
+static void mqtt_subscribe_topic(const char *topic, const char *what, int panel);
+
+// One per panel, commands go to the panel the topic belongs to.
+static void *mqtt_area_command[MAX_PANELS];
+
+// Paho callbacks pass commands to the MQTT thread here, only they use it.
+static void *control_writer = NULL;
+
+/*
+ * Areas and zones to build the topics for, called while parsing arguments.
+ */
+void mqtt_mgr_set_area(int panel, int area)
+{
+    areas[panel][area - 1].configured = 1;
+}
+
+void mqtt_mgr_set_zone(int panel, int area, int zone)
+{
+    zones[panel][zone - 1].configured = 1;
+    zones[panel][zone - 1].state.area = area;
+}
+
+/*
+ * <class>:<settings>, settings are a comma list of qos0, qos1, qos2, retain,
+ * noretain, on and off. Returns -1 if the class or a setting is not known.
+ */
+int mqtt_mgr_set_publish(const char *spec)
+{
+    const char *settings = strchr(spec, ':');
+    para_publish_profile_t *profile = NULL;
+
+    if (!settings) {
+        return -1;
+    }
+
+    for (int c = 0; c < PUB_COUNT; c++) {
+        if (strlen(publish_classes[c]) == (size_t) (settings - spec)
+            && strncmp(spec, publish_classes[c], settings - spec) == 0
+        ) {
+            profile = &config.publish[c];
+            break;
+        }
+    }
+
+    if (!profile) {
+        return -1;
+    }
+
+    for (const char *setting = settings + 1; *setting; ) {
+        size_t len = strcspn(setting, ",");
+
+        if (len == 4 && strncmp(setting, "qos", 3) == 0 && setting[3] >= '0' && setting[3] <= '2') {
+            profile->qos = setting[3] - '0';
+        } else if (len == 6 && strncmp(setting, "retain", len) == 0) {
+            profile->retain = 1;
+        } else if (len == 8 && strncmp(setting, "noretain", len) == 0) {
+            profile->retain = 0;
+        } else if (len == 2 && strncmp(setting, "on", len) == 0) {
+            profile->enabled = 1;
+        } else if (len == 3 && strncmp(setting, "off", len) == 0) {
+            profile->enabled = 0;
+        } else {
+            return -1;
+        }
+
+        setting += len + (setting[len] == ',');
+    }
+
+    return 0;
+}
 
 pthread_t mqtt_mgr_start(void *context)
 {
     pthread_t thread;
+
+    // Panel topics are final by now.
+    mqtt_topics_build();
+
     pthread_create(&thread, NULL, mqtt_mgr_thread, context);
 
     return thread;
@@ -116,8 +376,14 @@ static void *mqtt_mgr_thread(void *context) {
     void *kill_subscriber = NULL;
     void *area_report_reader = NULL;
     void *zone_report_reader = NULL;
+    void *control_reader = NULL;
+    char endpoint[EPT_NAME_LEN];
     int rc;
 
+    if (mqtt_queue_init(&outbound, config.mqtt_queue_count, config.mqtt_queue_bytes, mqtt_queue_dropped) != 0) {
+        log_error("MMGR: messages will not be kept while disconnected\n");
+    }
+
     mqtt_start();
 
     if ((rc = z_start_endpoint(context, &area_report_reader, ZMQ_PULL, EPT_MQTT_AREA_REPORT)) != 0) {
@@ -130,6 +396,11 @@ static void *mqtt_mgr_thread(void *context) {
         goto EXIT_MQTT_THREAD;
     }
 
+    if ((rc = z_start_endpoint(context, &control_reader, ZMQ_PULL, EPT_MQTT_CONTROL)) != 0) {
+        log_error("MMGR: cannot start control: %d, exiting.\n", rc);
+        goto EXIT_MQTT_THREAD;
+    }
+
     // Lamely give time for ZMQ PULL to initialize.
     sleep(1);
 
@@ -138,8 +409,15 @@ static void *mqtt_mgr_thread(void *context) {
         goto EXIT_MQTT_THREAD;
     }
 
-    if ((rc = z_connect_endpoint(context, &mqtt_area_command, ZMQ_PUSH, EPT_MQTT_AREA_COMMAND)) != 0) {
-        log_error("MMGR: cannot connect to area command: %d, exiting.\n", rc);
+    for (int i = 0; i < config.panel_count; i++) {
+        if ((rc = z_connect_endpoint(context, &mqtt_area_command[i], ZMQ_PUSH, z_panel_endpoint(endpoint, EPT_MQTT_AREA_COMMAND, i))) != 0) {
+            log_error("MMGR: cannot connect to area command of panel %d: %d, exiting.\n", i + 1, rc);
+            goto EXIT_MQTT_THREAD;
+        }
+    }
+
+    if ((rc = z_connect_endpoint(context, &control_writer, ZMQ_PUSH, EPT_MQTT_CONTROL)) != 0) {
+        log_error("MMGR: cannot connect to control: %d, exiting.\n", rc);
         goto EXIT_MQTT_THREAD;
     }
 
@@ -151,12 +429,15 @@ static void *mqtt_mgr_thread(void *context) {
         { kill_subscriber, 0, ZMQ_POLLIN, 0 },
         { area_report_reader, 0, ZMQ_POLLIN, 0 },
         { zone_report_reader, 0, ZMQ_POLLIN, 0 },
+        { control_reader, 0, ZMQ_POLLIN, 0 },
     };
 
     log_info("MMGR: thread ready!\n");
 
+    long long heartbeat_at = t_now_ms() + MQTT_HEARTBEAT;
+
     while (1) {
-        rc = zmq_poll(items, 3, 60000);
+        rc = zmq_poll(items, 4, outbound.count ? MQTT_DRAIN_TICK : MQTT_WAKEUP);
 
         if (items[0].revents & ZMQ_POLLIN) {
             z_drop_message(kill_subscriber);
@@ -164,18 +445,41 @@ static void *mqtt_mgr_thread(void *context) {
             break;
         } else if (items[1].revents & ZMQ_POLLIN) {
             // Area report
-            mqtt_area_report(area_report_reader);
+            mqtt_report(area_report_reader);
         } else if (items[2].revents & ZMQ_POLLIN) {
             // Zone report
-            mqtt_zone_report(zone_report_reader);
+            mqtt_report(zone_report_reader);
+        } else if (items[3].revents & ZMQ_POLLIN) {
+            mqtt_control(control_reader);
         }
 
         // log_debug("MMGR: POLLED: %d\n", rc);
 
-        if (rc == 0) {
-            // Timeout every 60 s, send LWT
-            log_debug("MMGR: poll timeout, send lwt\n");
-            mqtt_send_lwt();
+        if (mqtt_resync) {
+            mqtt_resync = 0;
+            log_info("MMGR: connected, republishing everything known\n");
+
+            for (int p = 0; p < config.panel_count; p++) {
+                mqtt_republish(p);
+            }
+        }
+
+        if (outbound.count) {
+            mqtt_drain();
+        }
+
+        if (t_now_ms() >= heartbeat_at) {
+            heartbeat_at = t_now_ms() + MQTT_HEARTBEAT;
+
+            log_debug("MMGR: heartbeat, send lwt, %lu unchanged messages suppressed, %d queued, %lu replaced, %lu overflows\n",
+                mqtt_suppressed, outbound.count, outbound.replaced, outbound.overflows);
+            if (config.publish[PUB_HEARTBEAT].enabled) {
+                mqtt_send_lwt();
+            }
+
+            for (int p = 0; config.mqtt_republish && p < config.panel_count; p++) {
+                mqtt_republish(p);
+            }
         }
     }
 
@@ -194,10 +498,27 @@ EXIT_MQTT_THREAD:
         zmq_close(zone_report_reader);
     }
 
-    if (mqtt_area_command) {
-        zmq_close(mqtt_area_command);
+    if (control_reader) {
+        zmq_close(control_reader);
+    }
+
+    if (control_writer) {
+        zmq_close(control_writer);
+    }
+
+    for (int i = 0; i < config.panel_count; i++) {
+        if (mqtt_area_command[i]) {
+            zmq_close(mqtt_area_command[i]);
+        }
+    }
+
+    if (outbound.count) {
+        log_info("MMGR: %d queued messages lost\n", outbound.count);
     }
 
+    mqtt_queue_free(&outbound);
+    mqtt_topics_free();
+
     sleep(1);
 
     return NULL;
@@ -210,50 +531,80 @@ static int mqtt_area_control(void *context, char *topicName, int topicLen, MQTTA
     log_debug("MGMR: topic %s arrived\n", topicName);
     log_debug("%.*s\n", (int)message->payloadlen, (char*)message->payload);
 
-    snprintf(topic, TOPIC_SIZE, AREA_TOPIC_PREFIX, config.mqtt_topic);
+    for (int panel = 0; panel < config.panel_count; panel++) {
+        const char *panel_topic = config.panels[panel].topic;
 
-    log_debug("MMGR: compare topic %s\n", topic);
-    log_debug("MMGR: postfix: %s\n", (topicName + strlen(topic) + 1));
+        snprintf(topic, TOPIC_SIZE, AREA_TOPIC_PREFIX, panel_topic);
 
-    if (
-        strncmp(topicName, topic, strlen(topic)) == 0 
-        && strcmp(topicName + strlen(topic) + 1, AREA_CONTROL_SET) == 0
-    ) {
-        int area_num = topicName[strlen(topic)] - 48;
-        log_debug("MMGR: received command for area %d\n", area_num);
+        log_debug("MMGR: compare topic %s\n", topic);
+
+        if (
+            strncmp(topicName, topic, strlen(topic)) == 0
+            && strcmp(topicName + strlen(topic) + 1, AREA_CONTROL_SET) == 0
+        ) {
+            int area_num = topicName[strlen(topic)] - 48;
+            log_debug("MMGR: received command for area %d of panel %d\n", area_num, panel + 1);
+
+            para_arm_cmd_t cmd = { .type = CMD_AREA_CONTROL, .num = area_num, .command = -1 };
 
-        para_arm_cmd_t cmd = { .type = CMD_AREA_CONTROL, .num = area_num, .command = -1 };
+            if (strcmp((char*)message->payload, HA_ARM_AWAY) == 0) {
+                cmd.command = AC_ARM_AWAY;
+            } else if (strcmp((char*)message->payload, HA_ARM_HOME) == 0) {
+                cmd.command = AC_ARM_HOME;
+            } else if (strcmp((char*)message->payload, HA_DISARM) == 0) {
+                cmd.command = AC_DISARM;
+            }
 
-        if (strcmp((char*)message->payload, HA_ARM_AWAY) == 0) {
-            cmd.command = AC_ARM_AWAY;
-        } else if (strcmp((char*)message->payload, HA_ARM_HOME) == 0) {
-            cmd.command = AC_ARM_HOME;
-        } else if (strcmp((char*)message->payload, HA_DISARM) == 0) {
-            cmd.command = AC_DISARM;
+            if (cmd.command != -1) {
+                mqtt_send_control(panel, &cmd);
+            }
+
+            break;
+        }
+
+        if (strncmp(topicName, topic, strlen(topic)) == 0 && mqtt_refresh_control(panel, topicName + strlen(topic))) {
+            break;
         }
 
-        if (cmd.command != -1) {
-            zmq_msg_t zmessage;
+        int area_num, end = 0;
 
-            zmq_msg_init_size (&zmessage, sizeof(para_arm_cmd_t));
-            memcpy(zmq_msg_data(&zmessage), &cmd, sizeof(para_arm_cmd_t));
-            zmq_msg_send (&zmessage, mqtt_area_command, 0);
-            zmq_msg_close (&zmessage);
+        if (
+            strncmp(topicName, topic, strlen(topic)) == 0
+            && sscanf(topicName + strlen(topic), "%d/history" REFRESH_GET "%n", &area_num, &end) == 1
+            && end && !topicName[strlen(topic) + end]
+        ) {
+            mqtt_history_control(panel, area_num, message);
+            break;
         }
-    } else {
-        snprintf(topic, TOPIC_SIZE, UTILITY_KEY_TOPIC, config.mqtt_topic);
+
+        snprintf(topic, TOPIC_SIZE, HISTORY_GET_TOPIC, panel_topic);
+
+        if (strcmp(topicName, topic) == 0) {
+            mqtt_history_control(panel, 0, message);
+            break;
+        }
+
+        snprintf(topic, TOPIC_SIZE, DUMP_TOPIC, panel_topic);
+
+        if (strcmp(topicName, topic) == 0) {
+            log_debug("MMGR: received dump request of panel %d\n", panel + 1);
+
+            para_arm_cmd_t cmd = { .type = CMD_DUMP, .num = 0, .command = 0 };
+            mqtt_send_control(panel, &cmd);
+
+            break;
+        }
+
+        snprintf(topic, TOPIC_SIZE, UTILITY_KEY_TOPIC, panel_topic);
 
         if (strcmp(topicName, topic) == 0) {
             log_debug("MMGR: received Utilty Key %s\n", (char*)message->payload);
             int key_num = strtol((char*)message->payload, NULL, 10);
 
             para_arm_cmd_t cmd = { .type = CMD_UTILITY_KEY, .num = key_num, .command = 0 };
-            zmq_msg_t zmessage;
-            
-            zmq_msg_init_size (&zmessage, sizeof(para_arm_cmd_t));
-            memcpy(zmq_msg_data(&zmessage), &cmd, sizeof(para_arm_cmd_t));
-            zmq_msg_send (&zmessage, mqtt_area_command, 0);
-            zmq_msg_close (&zmessage);
+            mqtt_send_control(panel, &cmd);
+
+            break;
         }
     }
 
@@ -262,10 +613,138 @@ static int mqtt_area_control(void *context, char *topicName, int topicLen, MQTTA
     return 1;
 }
 
+/*
+ * N/get or N/zone/M/get following the area prefix. Returns 1 if it was one of them.
+ * Panel manager does the rate limiting, it knows what is pending already.
+ */
+static int mqtt_refresh_control(int panel, const char *area_topic)
+{
+    int area_num, zone_num, end = 0;
+    para_arm_cmd_t cmd = { .type = CMD_AREA_GET, .num = 0, .command = 0 };
+
+    if (sscanf(area_topic, "%d" REFRESH_GET "%n", &area_num, &end) == 1 && end && !area_topic[end]) {
+        cmd.num = area_num;
+    } else if (sscanf(area_topic, "%d/zone/%d" REFRESH_GET "%n", &area_num, &zone_num, &end) == 2 && end && !area_topic[end]) {
+        cmd.type = CMD_ZONE_GET;
+        cmd.num = zone_num;
+    } else {
+        return 0;
+    }
+
+    log_debug("MMGR: received refresh of %s %d of panel %d\n", cmd.type == CMD_AREA_GET ? "area" : "zone", cmd.num, panel + 1);
+
+    mqtt_send_control(panel, &cmd);
+
+    return 1;
+}
+
+/*
+ * The payload is the number of events wanted, empty for the default.
+ */
+static void mqtt_history_control(int panel, int area_num, MQTTAsync_message *message)
+{
+    char count[16] = "";
+
+    if (message->payloadlen > 0 && message->payloadlen < (int) sizeof(count)) {
+        memcpy(count, message->payload, message->payloadlen);
+        count[message->payloadlen] = 0;
+    }
+
+    para_arm_cmd_t cmd = { .type = CMD_HISTORY, .num = area_num, .command = 0, .count = strtol(count, NULL, 10) };
+
+    log_debug("MMGR: received history query of area %d of panel %d\n", area_num, panel + 1);
+    mqtt_send_control(panel, &cmd);
+}
+
+static void mqtt_send_command(int panel, para_arm_cmd_t *cmd)
+{
+    zmq_msg_t zmessage;
+
+    zmq_msg_init_size (&zmessage, sizeof(para_arm_cmd_t));
+    memcpy(zmq_msg_data(&zmessage), cmd, sizeof(para_arm_cmd_t));
+    zmq_msg_send (&zmessage, mqtt_area_command[panel], 0);
+    zmq_msg_close (&zmessage);
+}
+
+/*
+ * Paho callbacks do not touch the topics, the MQTT thread does it in mqtt_control().
+ */
+static void mqtt_send_control(int panel, para_arm_cmd_t *cmd)
+{
+    mqtt_control_t control = { .panel = panel, .cmd = *cmd };
+
+    if (!control_writer) {
+        log_error("MMGR: command %d of panel %d dropped, not running\n", cmd->type, panel + 1);
+        return;
+    }
+
+    zmq_send(control_writer, &control, sizeof(control), 0);
+}
+
+/*
+ * A refresh or dump is answered even if nothing has changed, so the topics
+ * are forgotten before the panel is asked.
+ */
+static void mqtt_control(void *control_reader)
+{
+    mqtt_control_t control;
+    int size = zmq_recv(control_reader, &control, sizeof(control), 0);
+
+    if (size != sizeof(control) || control.panel < 0 || control.panel >= config.panel_count) {
+        log_error("MMGR: malformed control received!\n");
+        return;
+    }
+
+    int panel = control.panel;
+    para_arm_cmd_t *cmd = &control.cmd;
+
+    if (cmd->type == CMD_AREA_GET && cmd->num >= 1 && cmd->num <= MAX_AREAS) {
+        mqtt_forget_area(panel, cmd->num);
+    } else if (cmd->type == CMD_ZONE_GET && cmd->num >= 1 && cmd->num <= MAX_ZONES) {
+        mqtt_forget_zone(panel, cmd->num);
+    } else if (cmd->type == CMD_DUMP) {
+        for (int a = 1; a <= MAX_AREAS; a++) {
+            mqtt_forget_area(panel, a);
+        }
+
+        for (int z = 1; z <= MAX_ZONES; z++) {
+            mqtt_forget_zone(panel, z);
+        }
+
+        panels[panel].ready_topic.published = 0;
+        panels[panel].trouble_topic.published = 0;
+    }
+
+    mqtt_send_command(panel, cmd);
+}
+
 static void mqtt_subscribe()
 {
-    snprintf(topic, TOPIC_SIZE, UTILITY_KEY_TOPIC, config.mqtt_topic);
+    for (int i = 0; i < config.panel_count; i++) {
+        const char *panel_topic = config.panels[i].topic;
 
+        snprintf(topic, TOPIC_SIZE, UTILITY_KEY_TOPIC, panel_topic);
+        mqtt_subscribe_topic(topic, "utility key", i);
+
+        snprintf(topic, TOPIC_SIZE, AREA_REFRESH_TOPIC, panel_topic);
+        mqtt_subscribe_topic(topic, "area refresh", i);
+
+        snprintf(topic, TOPIC_SIZE, ZONE_REFRESH_TOPIC, panel_topic);
+        mqtt_subscribe_topic(topic, "zone refresh", i);
+
+        snprintf(topic, TOPIC_SIZE, DUMP_TOPIC, panel_topic);
+        mqtt_subscribe_topic(topic, "dump", i);
+
+        snprintf(topic, TOPIC_SIZE, HISTORY_GET_TOPIC, panel_topic);
+        mqtt_subscribe_topic(topic, "history", i);
+
+        snprintf(topic, TOPIC_SIZE, AREA_HISTORY_GET_TOPIC, panel_topic);
+        mqtt_subscribe_topic(topic, "area history", i);
+    }
+}
+
+static void mqtt_subscribe_topic(const char *topic, const char *what, int panel)
+{
     MQTTAsync_responseOptions opts = MQTTAsync_responseOptions_initializer;
 
     opts.onSuccess = onSubscribe;
@@ -275,94 +754,500 @@ static void mqtt_subscribe()
     int rc = MQTTAsync_subscribe(client, topic, 1, &opts);
 
     if (rc == MQTTASYNC_SUCCESS) {
-        log_debug("MMGR: Subscribed utility key topic.\n");
+        log_debug("MMGR: Subscribed %s topic of panel %d.\n", what, panel + 1);
     } else {
-        log_error("MMGR: Subscription utility key control failed: %d\n", rc);
+        log_error("MMGR: Subscription %s control failed: %d\n", what, rc);
     }
 }
 
-static void mqtt_area_report(void *area_report_reader)
+/*
+ * Receive a report, decode it in place and pass on by its kind.
+ * History answers are the only ones longer than PARA_REPORT_MAX_LEN.
+ */
+static void mqtt_report(void *report_reader)
 {
-    para_area_t *area = (para_area_t*) z_receive(area_report_reader);
+    zmq_msg_t message;
+    para_report_t report;
 
-    if (!area) {
-        log_error("MMGR: area report not received!\n");
+    zmq_msg_init(&message);
+
+    int size = zmq_msg_recv(&message, report_reader, 0);
+
+    if (size < 0 || para_report_decode(zmq_msg_data(&message), size, &report) != 0
+        || report.panel >= config.panel_count
+    ) {
+        log_error("MMGR: malformed report received!\n");
+        zmq_msg_close(&message);
         return;
     }
 
-    if (area->firstreport) {
-        // First incoming report, subscribe to this area's control
-        snprintf(topic, TOPIC_SIZE, AREA_CONTROL_TOPIC, config.mqtt_topic, area->num);
+    switch (report.kind) {
+        case PR_AREA:
+            if (report.num >= 1 && report.num <= MAX_AREAS) {
+                mqtt_area_report(&report);
+            } else {
+                log_error("MMGR: report of wrong area %d\n", report.num);
+            }
+        break;
+
+        case PR_ZONE:
+            if (report.num >= 1 && report.num <= MAX_ZONES && report.area >= 1 && report.area <= MAX_AREAS) {
+                mqtt_zone_report(&report);
+            } else {
+                log_error("MMGR: report of wrong zone %d\n", report.num);
+            }
+        break;
+
+        case PR_READY:
+            mqtt_ready_report(&report);
+        break;
+
+        case PR_HISTORY:
+            mqtt_history_report(&report);
+        break;
+
+        case PR_TROUBLE:
+            mqtt_trouble_report(&report);
+        break;
+
+        case PR_COMMAND:
+            if (report.num >= 1 && report.num <= MAX_AREAS) {
+                mqtt_command_report(&report);
+            } else {
+                log_error("MMGR: command result of wrong area %d\n", report.num);
+            }
+        break;
+    }
+
+    zmq_msg_close(&message);
+}
+
+static void mqtt_area_report(const para_report_t *report)
+{
+    int num = report->num;
+    mqtt_area_t *area = &areas[report->panel][num - 1];
 
+    para_report_apply(report, area->state.fields, AF_COUNT, area->name);
+
+    if (!area->topics[TT_STATE].str && mqtt_area_topics(report->panel, num) != 0) {
+        return;
+    }
+
+    if (!area->subscribed) {
+        // First incoming report, subscribe to this area's control
         MQTTAsync_responseOptions opts = MQTTAsync_responseOptions_initializer;
 
         opts.onSuccess = onSubscribe;
         opts.onFailure = onSubscribeFailure;
         opts.context = client;
 
-        int rc = MQTTAsync_subscribe(client, topic, 1, &opts);
+        int rc = MQTTAsync_subscribe(client, area->topics[TT_SET].str, 1, &opts);
         if (rc == MQTTASYNC_SUCCESS) {
-            log_debug("MMGR: Subscribed to area %d: %d\n", area->num, rc);
+            log_debug("MMGR: Subscribed to area %d: %d\n", num, rc);
         } else {
-            log_error("MMGR: Subscription to area %d control failed: %d\n", area->num, rc);
+            log_error("MMGR: Subscription to area %d control failed: %d\n", num, rc);
         }
+
+        area->subscribed = 1;
     }
 
-    const char *area_state = mqp_states[area->mqtt_state];
+    // The label and the keys are rendered again only when the label changes.
+    if (!area->json.len || report->label) {
+        char name[LABEL_LENGTH * 6];
+
+        mqtt_json_escape(name, sizeof(name), area->name);
+        snprintf(payload, PAYLOAD_SIZE, AREA_STATE_JSON_HEAD, num, name);
+        mqtt_json_render(&area->json, payload, area_json_keys, AREA_JSON_KEYS, area->state.fields);
+    } else {
+        mqtt_json_patch(&area->json, area->state.fields, report->mask);
+    }
 
-    snprintf(topic, TOPIC_SIZE, MAIN_AREA_TOPIC, config.mqtt_topic, area->num);
-    mqtt_send(topic, area_state);
+    mqtt_area_publish(report->panel, num);
+}
 
-    snprintf(topic, TOPIC_SIZE, AREA_STATE_TOPIC, config.mqtt_topic, area->num);
-    snprintf(payload, PAYLOAD_SIZE, AREA_STATE_JSON, 
-        area->num,
-        area->name,
-        area->status,
-        area->memory,
-        area->trouble,
-        area->ready,
-        area->programming,
-        area->alarm,
-        area->strobe
-    );
-    mqtt_send(topic, payload);
+/*
+ * Unchanged payloads are suppressed by mqtt_send_topic().
+ */
+static void mqtt_area_publish(int panel, int num)
+{
+    mqtt_area_t *area = &areas[panel][num - 1];
+    const char *area_state = mqp_states[(int) area->state.mqtt_state];
 
-    free(area);
+    mqtt_send_topic(&area->topics[TT_STATE], PUB_AREA_STATE, area_state, strlen(area_state));
+
+    if (area->json.len) {
+        mqtt_send_topic(&area->topics[TT_JSON], PUB_AREA_JSON, area->json.str, area->json.len);
+    }
 }
 
-static void mqtt_zone_report(void *zone_report_reader)
+static void mqtt_zone_report(const para_report_t *report)
 {
-    para_zone_t *zone = (para_zone_t*) z_receive(zone_report_reader);
+    int num = report->num;
+    mqtt_zone_t *zone = &zones[report->panel][num - 1];
+
+    zone->state.area = report->area;
+    para_report_apply(report, zone->state.fields, ZF_COUNT, zone->name);
 
-    if (!zone) {
-        log_error("MMGR: zone report not received!\n");
+    int moved = zone->topic_area != zone->state.area;
+
+    // Zones reported out of their configured area get topics of the reported one.
+    if ((!zone->topics[TT_STATE].str || moved)
+        && mqtt_zone_topics(report->panel, zone->state.area, num) != 0
+    ) {
         return;
     }
 
-    const char *zone_state = mqz_states[zone->mqtt_state];
-    snprintf(topic, TOPIC_SIZE, ZONE_STATUS_TOPIC, config.mqtt_topic, zone->area, zone->num);
-    mqtt_send(topic, zone_state);
+    if (!zone->json.len || report->label || moved) {
+        char name[LABEL_LENGTH * 6];
 
-    const char *alarm_state = zone->alarm == RS_ZONE_IN_ALARM ? mqz_states[MQZ_ON] : mqz_states[MQZ_OFF];
-    snprintf(topic, TOPIC_SIZE, ZONE_ALARM_TOPIC, config.mqtt_topic, zone->area, zone->num);
-    mqtt_send(topic, alarm_state);
+        mqtt_json_escape(name, sizeof(name), zone->name);
+        snprintf(payload, PAYLOAD_SIZE, ZONE_STATE_JSON_HEAD, num, zone->state.area, name);
+        mqtt_json_render(&zone->json, payload, zone_json_keys, ZONE_JSON_KEYS, zone->state.fields);
+    } else {
+        mqtt_json_patch(&zone->json, zone->state.fields, report->mask);
+    }
+
+    mqtt_zone_publish(report->panel, num);
+}
+
+static void mqtt_zone_publish(int panel, int num)
+{
+    mqtt_zone_t *zone = &zones[panel][num - 1];
 
-    snprintf(topic, TOPIC_SIZE, ZONE_STATE_TOPIC, config.mqtt_topic, zone->area, zone->num);
-    snprintf(payload, PAYLOAD_SIZE, ZONE_STATE_JSON,
-        zone->num,
-        zone->area,
-        zone->name,
-        zone->status,
-        zone->alarm,
-        zone->fire,
-        zone->supervision,
-        zone->battery,
-        zone->bypassed
-    );
-    // log_debug("MMGR: zone status: %s\n", payload);
-    mqtt_send(topic, payload);
+    const char *zone_state = mqz_states[(int) zone->state.mqtt_state];
+    mqtt_send_topic(&zone->topics[TT_STATE], PUB_ZONE_STATE, zone_state, strlen(zone_state));
 
-    free(zone);
+    const char *alarm_state = zone->state.alarm == RS_ZONE_IN_ALARM ? mqz_states[MQZ_ON] : mqz_states[MQZ_OFF];
+    mqtt_send_topic(&zone->topics[TT_ALARM], PUB_ZONE_ALARM, alarm_state, strlen(alarm_state));
+
+    // log_debug("MMGR: zone status: %s\n", zone->json.str);
+    if (zone->json.len) {
+        mqtt_send_topic(&zone->topics[TT_JSON], PUB_ZONE_JSON, zone->json.str, zone->json.len);
+    }
+}
+
+/*
+ * Publish the area again even if it has not changed.
+ */
+static void mqtt_forget_area(int panel, int num)
+{
+    for (int t = 0; t < TT_COUNT; t++) {
+        areas[panel][num - 1].topics[t].published = 0;
+    }
+}
+
+static void mqtt_forget_zone(int panel, int num)
+{
+    for (int t = 0; t < TT_COUNT; t++) {
+        zones[panel][num - 1].topics[t].published = 0;
+    }
+}
+
+/*
+ * Everything reported so far, as it is known now.
+ */
+static void mqtt_republish(int panel)
+{
+    for (int a = 1; a <= MAX_AREAS; a++) {
+        if (areas[panel][a - 1].json.len) {
+            mqtt_forget_area(panel, a);
+            mqtt_area_publish(panel, a);
+        }
+    }
+
+    for (int z = 1; z <= MAX_ZONES; z++) {
+        if (zones[panel][z - 1].json.len) {
+            mqtt_forget_zone(panel, z);
+            mqtt_zone_publish(panel, z);
+        }
+    }
+
+    panels[panel].ready_topic.published = 0;
+    panels[panel].trouble_topic.published = 0;
+
+    mqtt_ready_publish(panel);
+    mqtt_trouble_publish(panel);
+}
+
+/*
+ * E.g. {"ready": false, "areas": {"1": true, "2": false}}
+ */
+static void mqtt_ready_report(const para_report_t *report)
+{
+    mqtt_panel_t *panel = &panels[report->panel];
+
+    panel->ready_mask = report->mask;
+    panel->ready = report->ready;
+    panel->ready_known = 1;
+
+    mqtt_ready_publish(report->panel);
+
+    log_info("MMGR: panel %d readiness %s\n", report->panel + 1, payload);
+}
+
+static void mqtt_ready_publish(int panel_idx)
+{
+    mqtt_panel_t *panel = &panels[panel_idx];
+
+    if (!panel->ready_known
+        || (!panel->ready_topic.str && mqtt_topic_intern(&panel->ready_topic, READY_TOPIC, config.panels[panel_idx].topic) != 0)
+    ) {
+        return;
+    }
+
+    int pos = snprintf(payload, PAYLOAD_SIZE, "{\"ready\": %s, \"areas\": {",
+        (panel->ready_mask & ~panel->ready) ? "false" : "true");
+
+    for (int a = 1; a <= MAX_AREAS && pos < PAYLOAD_SIZE; a++) {
+        if (panel->ready_mask & (1U << (a - 1))) {
+            pos += snprintf(payload + pos, PAYLOAD_SIZE - pos, "%s\"%d\": %s",
+                payload[pos - 1] == '{' ? "" : ", ", a, (panel->ready & (1U << (a - 1))) ? "true" : "false");
+        }
+    }
+
+    if (pos < PAYLOAD_SIZE) {
+        pos += snprintf(payload + pos, PAYLOAD_SIZE - pos, "}}");
+    }
+
+    mqtt_send_topic(&panel->ready_topic, PUB_FIXED, payload, pos);
+}
+
+/*
+ * E.g. {"trouble": true, "tlm": false, "ac_failure": true, ...}
+ */
+static void mqtt_trouble_report(const para_report_t *report)
+{
+    mqtt_panel_t *panel = &panels[report->panel];
+
+    panel->troubles = report->mask;
+    panel->troubles_known = 1;
+
+    mqtt_trouble_publish(report->panel);
+
+    log_info("MMGR: panel %d troubles %s\n", report->panel + 1, payload);
+}
+
+static void mqtt_trouble_publish(int panel_idx)
+{
+    mqtt_panel_t *panel = &panels[panel_idx];
+
+    if (!panel->troubles_known
+        || (!panel->trouble_topic.str && mqtt_topic_intern(&panel->trouble_topic, TROUBLE_TOPIC, config.panels[panel_idx].topic) != 0)
+    ) {
+        return;
+    }
+
+    int pos = snprintf(payload, PAYLOAD_SIZE, "{\"trouble\": %s", panel->troubles ? "true" : "false");
+
+    for (int t = 0; t < T_COUNT && pos < PAYLOAD_SIZE; t++) {
+        pos += snprintf(payload + pos, PAYLOAD_SIZE - pos, ", \"%s\": %s",
+            trouble_names[t], (panel->troubles & (1U << t)) ? "true" : "false");
+    }
+
+    if (pos < PAYLOAD_SIZE) {
+        pos += snprintf(payload + pos, PAYLOAD_SIZE - pos, "}");
+    }
+
+    mqtt_send_topic(&panel->trouble_topic, PUB_FIXED, payload, pos);
+}
+
+/*
+ * E.g. {"command": "ARM_AWAY", "result": "ok", "latency": 850, "echo": 120}, latency
+ * and echo in ms from the command, echo is null if PRT3 did not answer &ok.
+ * Results are not retained.
+ */
+static void mqtt_command_report(const para_report_t *report)
+{
+    int command, result;
+    unsigned latency, echo;
+
+    para_report_command(report, &command, &result, &latency, &echo);
+
+    if (command > AC_DISARM || result > CR_REFUSED) {
+        log_error("MMGR: wrong command result %d/%d\n", command, result);
+        return;
+    }
+
+    int pos = snprintf(payload, PAYLOAD_SIZE, "{\"command\": \"%s\", \"result\": \"%s\", \"latency\": %u, \"echo\": ",
+        command_names[command], command_results[result], latency);
+
+    if (echo == PARA_REPORT_NO_ECHO) {
+        snprintf(payload + pos, PAYLOAD_SIZE - pos, "null}");
+    } else {
+        snprintf(payload + pos, PAYLOAD_SIZE - pos, "%u}", echo);
+    }
+
+    mqtt_area_t *area = &areas[report->panel][report->num - 1];
+
+    if (!area->topics[TT_RESULT].str && mqtt_area_topics(report->panel, report->num) != 0) {
+        return;
+    }
+
+    mqtt_send_response(area->topics[TT_RESULT].str, payload);
+}
+
+/*
+ * E.g. {"area": 2, "events": [{"age": 1500, "event": "ZONE_OPEN", ...}, ...]}, oldest first.
+ * Answers are not retained.
+ */
+static void mqtt_history_report(const para_report_t *report)
+{
+    size_t size = 64 + report->events * HISTORY_EVENT_SIZE;
+    char *json = malloc(size);
+
+    if (!json) {
+        log_error("MMGR: cannot allocate history of %d events\n", report->events);
+        return;
+    }
+
+    int pos = snprintf(json, size, "{\"area\": %d, \"events\": [", report->num);
+
+    for (int i = 0; i < report->events; i++) {
+        para_history_entry_t event;
+        unsigned age;
+        const char *name = "UNKNOWN";
+        const char *state;
+
+        para_report_event(report, i, &event, &age);
+
+        if (event.group < G_GROUPS_LEN && event_groups[event.group].name) {
+            name = event_groups[event.group].name;
+        }
+
+        if (event.group < G_GROUPS_LEN && event_groups[event.group].kind == EV_SYSTEM) {
+            state = "";
+        } else if (event.group < G_GROUPS_LEN && event_groups[event.group].kind == EV_ZONE) {
+            state = (unsigned char) event.mqtt_state < sizeof(mqz_states) / sizeof(mqz_states[0]) ? mqz_states[(int) event.mqtt_state] : "";
+        } else {
+            state = (unsigned char) event.mqtt_state < sizeof(mqp_states) / sizeof(mqp_states[0]) ? mqp_states[(int) event.mqtt_state] : "";
+        }
+
+        pos += snprintf(json + pos, size - pos, "%s" HISTORY_EVENT_JSON, i ? ", " : "",
+            age, name, event.group, event.num, event.area, event.status ? event.status : ' ', state);
+    }
+
+    snprintf(json + pos, size - pos, "]}");
+
+    if (report->num) {
+        snprintf(topic, TOPIC_SIZE, AREA_HISTORY_TOPIC, config.panels[report->panel].topic, report->num);
+    } else {
+        snprintf(topic, TOPIC_SIZE, HISTORY_TOPIC, config.panels[report->panel].topic);
+    }
+
+    mqtt_send_response(topic, json);
+    free(json);
+}
+
+/*
+ * Format a topic into its own buffer, reusing the old one. Returns -1 if it does not fit.
+ */
+static int mqtt_topic_intern(mqtt_topic_t *topic, const char *format, ...)
+{
+    char buf[TOPIC_SIZE];
+    va_list args;
+
+    va_start(args, format);
+    int len = vsnprintf(buf, TOPIC_SIZE, format, args);
+    va_end(args);
+
+    if (len < 0 || len >= TOPIC_SIZE) {
+        log_error("MMGR: topic %s... is too long\n", buf);
+        return -1;
+    }
+
+    char *str = realloc(topic->str, len + 1);
+
+    if (!str) {
+        log_error("MMGR: cannot allocate topic %s\n", buf);
+        return -1;
+    }
+
+    memcpy(str, buf, len + 1);
+    topic->str = str;
+    topic->len = len;
+
+    return 0;
+}
+
+static int mqtt_area_topics(int panel, int num)
+{
+    mqtt_area_t *area = &areas[panel][num - 1];
+    const char *panel_topic = config.panels[panel].topic;
+
+    if (mqtt_topic_intern(&area->topics[TT_STATE], MAIN_AREA_TOPIC, panel_topic, num) != 0
+        || mqtt_topic_intern(&area->topics[TT_JSON], AREA_STATE_TOPIC, panel_topic, num) != 0
+        || mqtt_topic_intern(&area->topics[TT_SET], AREA_CONTROL_TOPIC, panel_topic, num) != 0
+        || mqtt_topic_intern(&area->topics[TT_RESULT], AREA_RESULT_TOPIC, panel_topic, num) != 0
+    ) {
+        return -1;
+    }
+
+    return 0;
+}
+
+static int mqtt_zone_topics(int panel, int area, int num)
+{
+    mqtt_zone_t *zone = &zones[panel][num - 1];
+    const char *panel_topic = config.panels[panel].topic;
+
+    if (mqtt_topic_intern(&zone->topics[TT_STATE], ZONE_STATUS_TOPIC, panel_topic, area, num) != 0
+        || mqtt_topic_intern(&zone->topics[TT_JSON], ZONE_STATE_TOPIC, panel_topic, area, num) != 0
+        || mqtt_topic_intern(&zone->topics[TT_ALARM], ZONE_ALARM_TOPIC, panel_topic, area, num) != 0
+    ) {
+        return -1;
+    }
+
+    zone->topic_area = area;
+
+    return 0;
+}
+
+/*
+ * Topics of the configured areas and zones, others are formatted on their first report.
+ */
+static void mqtt_topics_build()
+{
+    int count = 0;
+
+    for (int p = 0; p < config.panel_count; p++) {
+        for (int a = 1; a <= MAX_AREAS; a++) {
+            if (areas[p][a - 1].configured && mqtt_area_topics(p, a) == 0) {
+                count++;
+            }
+        }
+
+        for (int z = 1; z <= MAX_ZONES; z++) {
+            mqtt_zone_t *zone = &zones[p][z - 1];
+
+            if (zone->configured && mqtt_zone_topics(p, zone->state.area, z) == 0) {
+                count++;
+            }
+        }
+    }
+
+    log_debug("MMGR: topics of %d areas and zones built\n", count);
+}
+
+static void mqtt_topics_free()
+{
+    for (int p = 0; p < MAX_PANELS; p++) {
+        for (int t = 0; t < TT_COUNT; t++) {
+            for (int a = 0; a < MAX_AREAS; a++) {
+                free(areas[p][a].topics[t].str);
+                areas[p][a].topics[t].str = NULL;
+            }
+
+            for (int z = 0; z < MAX_ZONES; z++) {
+                free(zones[p][z].topics[t].str);
+                zones[p][z].topics[t].str = NULL;
+            }
+        }
+
+        free(panels[p].ready_topic.str);
+        panels[p].ready_topic.str = NULL;
+        free(panels[p].trouble_topic.str);
+        panels[p].trouble_topic.str = NULL;
+    }
 }
 
 static void mqtt_start()
@@ -378,6 +1263,10 @@ static void mqtt_start()
         log_error("Failed to set callbacks, return code %d\n", rc);
     }//*/
 
+    if ((rc = MQTTAsync_setConnected(client, client, onConnected)) != MQTTASYNC_SUCCESS) {
+        log_error("MMGR: failed to set connected callback: %d\n", rc);
+    }
+
     MQTTAsync_willOptions will_opts = MQTTAsync_willOptions_initializer;
     MQTTAsync_connectOptions conn_opts = MQTTAsync_connectOptions_initializer;
 
@@ -398,7 +1287,8 @@ static void mqtt_start()
     conn_opts.will = &will_opts;
     will_opts.topicName = lwt_topic;
     will_opts.message = DAEMON_OFFLINE;
-    will_opts.retained = config.mqtt_retain;
+    will_opts.retained = PROFILE_RETAIN(&config.publish[PUB_HEARTBEAT]);
+    will_opts.qos = config.publish[PUB_HEARTBEAT].qos;
     
 
     MQTTAsync_connect(client, &conn_opts);
@@ -439,6 +1329,14 @@ static void onConnect(void* context, MQTTAsync_successData* response)
     mqtt_send_lwt();
 }
 
+/*
+ * Called by Paho on the first connect and every automatic reconnect.
+ */
+static void onConnected(void* context, char* cause)
+{
+    mqtt_resync = 1;
+}
+
 static void onConnectFailure(void* context, MQTTAsync_failureData* response)
 {
     log_error("MMGR: Failed to connect to MQTT server: [%d] - %s.\n", response->code, response->message);
@@ -480,19 +1378,127 @@ static void mqtt_send_lwt()
     MQTTAsync_message msg = MQTTAsync_message_initializer;
     msg.payload = DAEMON_ONLINE;
     msg.payloadlen = strlen(msg.payload);
-    msg.qos = 1;
-    msg.retained = config.mqtt_retain;
+    msg.qos = config.publish[PUB_HEARTBEAT].qos;
+    msg.retained = PROFILE_RETAIN(&config.publish[PUB_HEARTBEAT]);
 
     MQTTAsync_sendMessage(client, lwt_topic, &msg, NULL);
 }
 
-static void mqtt_send(const char *topic, const char *payload)
+/*
+ * FNV-1a of the payload.
+ */
+static uint64_t mqtt_fingerprint(const char *payload, size_t len)
 {
-    MQTTAsync_message msg = MQTTAsync_message_initializer;
-    msg.payload = (char *) payload;
-    msg.payloadlen = strlen(msg.payload);
-    msg.qos = 1;
-    msg.retained = config.mqtt_retain;
+    uint64_t hash = 0xcbf29ce484222325ULL;
 
-    MQTTAsync_sendMessage(client, topic, &msg, NULL);
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char) payload[i];
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
 }
+
+/*
+ * Publish with a payload length known already, a truncated one is cut at the buffer.
+ * The payload last published to the topic is not sent again, a failed send is
+ * retried with the next one.
+ */
+static void mqtt_send_topic(mqtt_topic_t *topic, int class, const char *payload, size_t len)
+{
+    const para_publish_profile_t *profile = class < PUB_COUNT ? &config.publish[class] : &publish_fixed;
+
+    if (!profile->enabled) {
+        return;
+    }
+
+    int payloadlen = len < PAYLOAD_SIZE ? len : PAYLOAD_SIZE - 1;
+    uint64_t fingerprint = mqtt_fingerprint(payload, payloadlen);
+
+    if (topic->published && topic->fingerprint == fingerprint) {
+        mqtt_suppressed++;
+        return;
+    }
+
+    // Queued counts as published, unless the queue drops it later.
+    topic->published = mqtt_publish(topic->str, payload, payloadlen, profile->qos, PROFILE_RETAIN(profile), topic) == 0;
+    topic->fingerprint = fingerprint;
+}
+
+static void mqtt_send_response(const char *topic, const char *payload)
+{
+    mqtt_publish(topic, payload, strlen(payload), 1, 0, NULL);
+}
+
+/*
+ * Send at once while connected and nothing is queued, so the order is kept.
+ * Otherwise queue, a newer payload of a topic replaces the queued one.
+ * Returns 0 if sent or queued.
+ */
+static int mqtt_publish(const char *topic, const char *payload, int len, int qos, int retained, void *owner)
+{
+    if (!outbound.count && MQTTAsync_isConnected(client)) {
+        MQTTAsync_message msg = MQTTAsync_message_initializer;
+        msg.payload = (char *) payload;
+        msg.payloadlen = len;
+        msg.qos = qos;
+        msg.retained = retained;
+
+        if (MQTTAsync_sendMessage(client, topic, &msg, NULL) == MQTTASYNC_SUCCESS) {
+            return 0;
+        }
+    }
+
+    if (!outbound.count) {
+        log_info("MMGR: MQTT server unreachable, queueing messages\n");
+    }
+
+    return mqtt_queue_put(&outbound, topic, payload, len, qos, retained, owner);
+}
+
+/*
+ * A queued topic overflowed, its next payload has to be sent even if the same.
+ */
+static void mqtt_queue_dropped(void *owner)
+{
+    if (owner) {
+        ((mqtt_topic_t *) owner)->published = 0;
+    }
+}
+
+/*
+ * Send a batch of queued messages once per MQTT_DRAIN_TICK, so a reconnect
+ * does not flood the broker.
+ */
+static void mqtt_drain()
+{
+    long long now = t_now_ms();
+
+    if (now < drain_at || !MQTTAsync_isConnected(client)) {
+        return;
+    }
+
+    drain_at = now + MQTT_DRAIN_TICK;
+
+    int batch = config.mqtt_drain_rate * MQTT_DRAIN_TICK / 1000;
+    mqtt_queue_entry_t *entry;
+
+    for (int i = 0; i < (batch ? batch : 1) && (entry = mqtt_queue_head(&outbound)); i++) {
+        MQTTAsync_message msg = MQTTAsync_message_initializer;
+        msg.payload = entry->payload;
+        msg.payloadlen = entry->len;
+        msg.qos = entry->qos;
+        msg.retained = entry->retained;
+
+        if (MQTTAsync_sendMessage(client, entry->topic, &msg, NULL) != MQTTASYNC_SUCCESS) {
+            return;
+        }
+
+        mqtt_queue_pop(&outbound);
+    }
+
+    if (!outbound.count) {
+        log_info("MMGR: queue drained, %lu queued, %lu replaced, %lu overflows so far\n",
+            outbound.queued, outbound.replaced, outbound.overflows);
+    }
+}
\ No newline at end of file
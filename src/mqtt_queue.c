@@ -0,0 +1,200 @@
+/*
+ * The source of the MQTT daemon interacting with Paradox EVO control panel
+ * via their's PRT3 module.
+ *
+ * mqtt_queue.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Darau, blė
+ *
+ *  This file is a part of personal use utilities developed to be used
+ *  on various Linux devices.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "mqtt_queue.h"
+
+#define ENTRY(queue, i) (&(queue)->entries[((queue)->head + (i)) % (queue)->size])
+
+static uint64_t topic_hash(const char *topic)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for (const unsigned char *c = (const unsigned char *) topic; *c; c++) {
+        hash ^= *c;
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+static void entry_free(mqtt_queue_t *queue, mqtt_queue_entry_t *entry)
+{
+    queue->bytes -= strlen(entry->topic) + entry->len;
+
+    free(entry->topic);
+    free(entry->payload);
+    memset(entry, 0, sizeof(mqtt_queue_entry_t));
+}
+
+/*
+ * The oldest message is given up for a newer one.
+ */
+static void drop_oldest(mqtt_queue_t *queue)
+{
+    void *owner = ENTRY(queue, 0)->owner;
+
+    mqtt_queue_pop(queue);
+    queue->overflows++;
+
+    if (queue->dropped) {
+        queue->dropped(owner);
+    }
+}
+
+int mqtt_queue_init(mqtt_queue_t *queue, int size, size_t max_bytes, void (*dropped)(void *owner))
+{
+    memset(queue, 0, sizeof(mqtt_queue_t));
+
+    // Size 0 queues nothing, messages are lost while disconnected.
+    if (size <= 0) {
+        return 0;
+    }
+
+    if (!(queue->entries = calloc(size, sizeof(mqtt_queue_entry_t)))) {
+        log_error("MQUE: cannot allocate %d messages\n", size);
+        return -1;
+    }
+
+    queue->size = size;
+    queue->max_bytes = max_bytes;
+    queue->dropped = dropped;
+
+    return 0;
+}
+
+void mqtt_queue_free(mqtt_queue_t *queue)
+{
+    while (queue->count) {
+        mqtt_queue_pop(queue);
+    }
+
+    free(queue->entries);
+    queue->entries = NULL;
+    queue->size = 0;
+}
+
+/*
+ * Queue the payload of the topic, replacing the one waiting already.
+ * Returns -1 if it does not fit at all or cannot be allocated.
+ */
+int mqtt_queue_put(mqtt_queue_t *queue, const char *topic, const char *payload, int len, int qos, int retained, void *owner)
+{
+    size_t topic_len = strlen(topic);
+    uint64_t hash = topic_hash(topic);
+
+    if (!queue->size || topic_len + len > queue->max_bytes) {
+        queue->overflows++;
+        return -1;
+    }
+
+    for (int i = 0; i < queue->count; i++) {
+        mqtt_queue_entry_t *entry = ENTRY(queue, i);
+
+        if (entry->hash == hash && strcmp(entry->topic, topic) == 0) {
+            char *copy = malloc(len ? len : 1);
+
+            if (!copy) {
+                return -1;
+            }
+
+            memcpy(copy, payload, len);
+            free(entry->payload);
+
+            queue->bytes += len - entry->len;
+            entry->payload = copy;
+            entry->len = len;
+            entry->qos = qos;
+            entry->retained = retained;
+            entry->owner = owner;
+            queue->replaced++;
+
+            // The bytes limit may be hit by a longer payload, the replaced
+            // message itself is not dropped for it.
+            while (queue->bytes > queue->max_bytes && i > 0) {
+                drop_oldest(queue);
+                i--;
+            }
+
+            if (queue->bytes > queue->max_bytes) {
+                mqtt_queue_pop(queue);
+                queue->overflows++;
+                return -1;
+            }
+
+            return 0;
+        }
+    }
+
+    while (queue->count && (queue->count == queue->size || queue->bytes + topic_len + len > queue->max_bytes)) {
+        drop_oldest(queue);
+    }
+
+    mqtt_queue_entry_t *entry = ENTRY(queue, queue->count);
+
+    entry->topic = malloc(topic_len + 1);
+    entry->payload = malloc(len ? len : 1);
+
+    if (!entry->topic || !entry->payload) {
+        log_error("MQUE: cannot allocate message of %s\n", topic);
+        free(entry->topic);
+        free(entry->payload);
+        memset(entry, 0, sizeof(mqtt_queue_entry_t));
+        return -1;
+    }
+
+    memcpy(entry->topic, topic, topic_len + 1);
+    memcpy(entry->payload, payload, len);
+    entry->len = len;
+    entry->qos = qos;
+    entry->retained = retained;
+    entry->hash = hash;
+    entry->owner = owner;
+
+    queue->bytes += topic_len + len;
+    queue->count++;
+    queue->queued++;
+
+    return 0;
+}
+
+/*
+ * The oldest message, NULL if none.
+ */
+mqtt_queue_entry_t *mqtt_queue_head(mqtt_queue_t *queue)
+{
+    return queue->count ? ENTRY(queue, 0) : NULL;
+}
+
+void mqtt_queue_pop(mqtt_queue_t *queue)
+{
+    if (!queue->count) {
+        return;
+    }
+
+    entry_free(queue, ENTRY(queue, 0));
+    queue->head = (queue->head + 1) % queue->size;
+    queue->count--;
+}
@@ -0,0 +1,191 @@
+/*
+ * The source of the MQTT daemon interacting with Paradox EVO control panel
+ * via their's PRT3 module.
+ *
+ * para_area.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Darau, blė
+ *
+ *  This file is a part of personal use utilities developed to be used
+ *  on various Linux devices.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+#include <stddef.h>
+
+#include "para_area.h"
+
+#define ANY_NUM 0, 255
+#define GROUP(g) g, g
+#define NUM(n) n, n
+
+/*
+ * Area state machine, the first matching row wins. Events not matched
+ * leave the area as it is.
+ */
+static const para_area_transition_t transitions[] = {
+    // Arming of a disarmed or arming area, special arming 4 is a stay arming.
+    { AS(MQP_DISARMED) | AS(MQP_ARMING), GROUP(G_SPECIAL_ARMING), NUM(4),
+        RS_AREA_STAY_ARMED, 0, MQP_ARMED_HOME, 0 },
+    { AS(MQP_DISARMED) | AS(MQP_ARMING), G_ARMING_WITH_MASTER, G_SPECIAL_ARMING, ANY_NUM,
+        RS_AREA_ARMED, 0, MQP_ARMED_AWAY, 0 },
+
+    // Disarming ends any state, an alarm before it stays in memory.
+    { AS_ANY, G_DISARM_AFTER_ALARM_WITH_MASTER, G_ALARM_CANCELLED_WITH_KEYSWITCH, ANY_NUM,
+        RS_AREA_DISARMED, RS_OK, MQP_DISARMED, AT_CLEAR_BYPASS | AT_MEMORY | AT_FLUSH },
+    { AS_ANY, G_DISARM_WITH_MASTER, G_SPECIAL_DISARM, ANY_NUM,
+        RS_AREA_DISARMED, RS_OK, MQP_DISARMED, AT_CLEAR_BYPASS },
+
+    { AS_ANY, G_ZONE_IN_ALARM, G_ZONE_FIRE_ALARM, ANY_NUM,
+        0, RS_AREA_IN_ALARM, MQP_TRIGGERED, AT_FLUSH },
+
+    // Zones bypassed or shut down while armed.
+    { AS(MQP_ARMED_AWAY) | AS(MQP_ARMED_HOME), GROUP(G_ZONE_BYPASSED), ANY_NUM,
+        0, 0, MQP_ARMED_CUSTOM_BYPASS, 0 },
+    { AS(MQP_ARMED_AWAY) | AS(MQP_ARMED_HOME), GROUP(G_ZONE_SHUTDOWN), ANY_NUM,
+        0, 0, MQP_ARMED_CUSTOM_BYPASS, 0 },
+
+    // Armed statuses do not end an entry delay or an alarm.
+    { AS(MQP_PENDING) | AS(MQP_TRIGGERED), GROUP(G_STATUS_1), S1_ARMED, S1_INSTANT_ARMED,
+        0, 0, AS_KEEP, 0 },
+    { AS_ANY, GROUP(G_STATUS_1), NUM(S1_ARMED),
+        RS_AREA_ARMED, 0, MQP_ARMED_AWAY, 0 },
+    { AS_ANY, GROUP(G_STATUS_1), NUM(S1_FORCE_ARMED),
+        RS_AREA_FORCE_ARMED, 0, MQP_ARMED_AWAY, 0 },
+    { AS_ANY, GROUP(G_STATUS_1), NUM(S1_STAY_ARMED),
+        RS_AREA_STAY_ARMED, 0, MQP_ARMED_HOME, 0 },
+    { AS_ANY, GROUP(G_STATUS_1), NUM(S1_INSTANT_ARMED),
+        RS_AREA_INSTANT_ARMED, 0, MQP_ARMED_AWAY, 0 },
+    { AS_ANY, GROUP(G_STATUS_1), S1_STROBE_ALARM, S1_FIRE_ALARM,
+        0, RS_AREA_IN_ALARM, MQP_TRIGGERED, AT_FLUSH },
+
+    // The arming event comes first, the exit delay after it still is arming.
+    { AS(MQP_DISARMED) | AS(MQP_ARMING) | AS_ARMED, GROUP(G_STATUS_2), NUM(S2_EXIT_DELAY),
+        RS_AREA_EXIT_DELAY, 0, MQP_ARMING, 0 },
+    { AS_ARMED, GROUP(G_STATUS_2), NUM(S2_ENTRY_DELAY),
+        0, 0, MQP_PENDING, AT_FLUSH },
+    { AS_ANY, GROUP(G_STATUS_2), NUM(S2_SYSTEM_IN_TROUBLE),
+        0, 0, AS_KEEP, AT_TROUBLE },
+    { AS_ANY, GROUP(G_STATUS_2), NUM(S2_ALARM_IN_MEMORY),
+        0, 0, AS_KEEP, AT_MEMORY },
+    { AS(MQP_ARMED_AWAY) | AS(MQP_ARMED_HOME), GROUP(G_STATUS_2), NUM(S2_ZONES_BYPASSED),
+        0, 0, MQP_ARMED_CUSTOM_BYPASS, 0 },
+};
+
+#define TRANSITION_COUNT (sizeof(transitions) / sizeof(transitions[0]))
+
+/*
+ * Returns the row for the event in the given MQTT state, NULL if none.
+ */
+const para_area_transition_t *para_area_transition(int mqtt_state, int group, int num)
+{
+    for (size_t i = 0; i < TRANSITION_COUNT; i++) {
+        const para_area_transition_t *t = &transitions[i];
+
+        if ((t->from & AS(mqtt_state))
+            && group >= t->group_min && group <= t->group_max
+            && num >= t->num_min && num <= t->num_max
+        ) {
+            return t;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Move the area by the row for the event: new status and alarm, the effects
+ * on the area record and the MQTT state. Hold keeps the MQTT state, it stays
+ * arming/disarming while a command is awaited. Flushing is left to the caller.
+ * Returns the row applied, NULL if the event leaves the area as it is.
+ */
+const para_area_transition_t *para_area_apply(para_state_t *state, int area_num, int group, int num, int hold)
+{
+    const para_area_transition_t *t = para_area_transition(state->areas[area_num - 1].mqtt_state, group, num);
+
+    if (!t) {
+        return NULL;
+    }
+
+    if (t->status) {
+        para_state_area_set(state, area_num, AF_STATUS, t->status);
+    }
+
+    if (t->alarm) {
+        para_state_area_set(state, area_num, AF_ALARM, t->alarm);
+    }
+
+    if (t->effects & AT_MEMORY) {
+        para_state_area_set(state, area_num, AF_MEMORY, RS_AREA_ZONE_IN_MEMORY);
+    }
+
+    if (t->effects & AT_TROUBLE) {
+        para_state_area_set(state, area_num, AF_TROUBLE, RS_AREA_TROUBLE);
+    }
+
+    // The panel drops all bypasses of an area when it is disarmed.
+    if (t->effects & AT_CLEAR_BYPASS) {
+        for (int z = 0; (z = para_state_next_zone(state->area_zones[area_num - 1], z)); ) {
+            para_state_zone_set(state, z, ZF_BYPASSED, RS_OK);
+        }
+    }
+
+    if (t->to != AS_KEEP && !hold) {
+        int bypassed = para_state_area_count(state, area_num, ZB_BYPASSED);
+        para_state_area_set(state, area_num, AF_MQTT_STATE, para_area_armed(t->to, bypassed));
+    }
+
+    return t;
+}
+
+/*
+ * An area armed with bypassed zones is armed custom bypass.
+ */
+mqtt_panel_state_t para_area_armed(mqtt_panel_state_t armed, int bypassed)
+{
+    if (bypassed && (armed == MQP_ARMED_AWAY || armed == MQP_ARMED_HOME)) {
+        return MQP_ARMED_CUSTOM_BYPASS;
+    }
+
+    return armed;
+}
+
+/*
+ * MQTT state of a polled area record. RA does not tell the entry delay,
+ * so an armed area in it stays pending.
+ */
+mqtt_panel_state_t para_area_derive(const para_area_state_t *area, int bypassed)
+{
+    mqtt_panel_state_t current = area->mqtt_state;
+
+    if (area->alarm == RS_AREA_IN_ALARM) {
+        return MQP_TRIGGERED;
+    }
+
+    switch (area->status) {
+        case RS_AREA_DISARMED:
+            return MQP_DISARMED;
+
+        case RS_AREA_EXIT_DELAY:
+            return MQP_ARMING;
+
+        case RS_AREA_STAY_ARMED:
+            return current == MQP_PENDING ? MQP_PENDING : para_area_armed(MQP_ARMED_HOME, bypassed);
+
+        case RS_AREA_ARMED:
+        case RS_AREA_FORCE_ARMED:
+        case RS_AREA_INSTANT_ARMED:
+            return current == MQP_PENDING ? MQP_PENDING : para_area_armed(MQP_ARMED_AWAY, bypassed);
+    }
+
+    return current;
+}
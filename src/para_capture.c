@@ -0,0 +1,162 @@
+/*
+ * The source of the MQTT daemon interacting with Paradox EVO control panel
+ * via their's PRT3 module.
+ *
+ * para_capture.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Darau, blė
+ *
+ *  This file is a part of personal use utilities developed to be used
+ *  on various Linux devices.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "para_capture.h"
+#include "time_helpers.h"
+
+int cap_open_record(para_capture_t *cap, const char *path)
+{
+    cap->file = fopen(path, "a+b");
+    cap->last_us = 0;
+
+    if (!cap->file) {
+        log_error("CAPTURE: cannot open %s for recording\n", path);
+        return -1;
+    }
+
+    fseek(cap->file, 0, SEEK_END);
+
+    if (ftell(cap->file) == 0) {
+        fwrite(CAP_MAGIC, 1, CAP_MAGIC_LEN, cap->file);
+    } else {
+        char magic[CAP_MAGIC_LEN];
+        rewind(cap->file);
+
+        if (fread(magic, 1, CAP_MAGIC_LEN, cap->file) != CAP_MAGIC_LEN || memcmp(magic, CAP_MAGIC, CAP_MAGIC_LEN) != 0) {
+            log_error("CAPTURE: %s is not a capture file, not appending\n", path);
+            fclose(cap->file);
+            cap->file = NULL;
+            return -2;
+        }
+
+        // Switching from reading to writing needs a seek.
+        fseek(cap->file, 0, SEEK_END);
+        log_info("CAPTURE: appending to %s\n", path);
+    }
+
+    return 0;
+}
+
+void cap_write(para_capture_t *cap, cap_direction_t dir, const char *line, size_t len)
+{
+    if (!cap->file) {
+        return;
+    }
+
+    long long now = t_now_us();
+    unsigned long long delta = cap->last_us ? now - cap->last_us : 0;
+    cap->last_us = now;
+
+    if (len > CAP_MAX_LINE) {
+        len = CAP_MAX_LINE;
+    }
+
+    unsigned char record[10 + 1 + CAP_MAX_LINE];
+    size_t pos = 0;
+
+    do {
+        record[pos] = delta & 0x7F;
+        delta >>= 7;
+        record[pos++] |= delta ? 0x80 : 0;
+    } while (delta);
+
+    record[pos++] = (dir == CAP_TO_PANEL ? CAP_DIR_BIT : 0) | len;
+    memcpy(record + pos, line, len);
+
+    fwrite(record, 1, pos + len, cap->file);
+}
+
+void cap_flush(para_capture_t *cap)
+{
+    if (cap->file) {
+        fflush(cap->file);
+    }
+}
+
+int cap_open_replay(para_capture_t *cap, const char *path)
+{
+    char magic[CAP_MAGIC_LEN];
+
+    cap->file = fopen(path, "rb");
+    cap->last_us = 0;
+
+    if (!cap->file) {
+        log_error("CAPTURE: cannot open %s for replay\n", path);
+        return -1;
+    }
+
+    if (fread(magic, 1, CAP_MAGIC_LEN, cap->file) != CAP_MAGIC_LEN || memcmp(magic, CAP_MAGIC, CAP_MAGIC_LEN) != 0) {
+        log_error("CAPTURE: %s is not a capture file\n", path);
+        fclose(cap->file);
+        cap->file = NULL;
+        return -2;
+    }
+
+    return 0;
+}
+
+/*
+ * Read the next record, line buffer must fit CAP_MAX_LINE bytes.
+ * Returns 1 on success, 0 at the end of capture, -1 on a broken record.
+ */
+int cap_read(para_capture_t *cap, long long *delta_us, cap_direction_t *dir, char *line, size_t *len)
+{
+    unsigned long long delta = 0;
+    int shift = 0;
+    int c;
+
+    do {
+        if ((c = fgetc(cap->file)) == EOF) {
+            return shift == 0 ? 0 : -1;
+        }
+
+        delta |= (unsigned long long) (c & 0x7F) << shift;
+        shift += 7;
+    } while ((c & 0x80) && shift < 64);
+
+    if ((c = fgetc(cap->file)) == EOF) {
+        return -1;
+    }
+
+    *dir = (c & CAP_DIR_BIT) ? CAP_TO_PANEL : CAP_FROM_PANEL;
+    *len = c & ~CAP_DIR_BIT;
+    *delta_us = (long long) delta;
+
+    if (fread(line, 1, *len, cap->file) != *len) {
+        return -1;
+    }
+
+    return 1;
+}
+
+void cap_close(para_capture_t *cap)
+{
+    if (cap->file) {
+        fclose(cap->file);
+        cap->file = NULL;
+    }
+}
@@ -0,0 +1,127 @@
+/*
+ * The source of the MQTT daemon interacting with Paradox EVO control panel
+ * via their's PRT3 module.
+ *
+ * para_frame.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Darau, blė
+ *
+ *  This file is a part of personal use utilities developed to be used
+ *  on various Linux devices.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+#include <string.h>
+#include <unistd.h>
+
+#include "log.h"
+#include "para_frame.h"
+#include "para_serial.h"
+
+void para_frame_init(para_frame_t *frame)
+{
+    frame->start = 0;
+    frame->scan = 0;
+    frame->end = 0;
+    frame->discarding = 0;
+    frame->lines = 0;
+    frame->resyncs = 0;
+}
+
+/*
+ * Read as much as is available into the free space of the buffer.
+ * Returns read() result.
+ */
+ssize_t para_frame_read(para_frame_t *frame, int fd)
+{
+    if (PARA_FRAME_LEN - frame->end < PARA_SERIAL_BUFF_LEN) {
+        // Wrap around, carrying over the unfinished line.
+        size_t pending = frame->end - frame->start;
+
+        memmove(frame->buffer, frame->buffer + frame->start, pending);
+        frame->scan -= frame->start;
+        frame->start = 0;
+        frame->end = pending;
+    }
+
+    ssize_t br = read(fd, frame->buffer + frame->end, PARA_FRAME_LEN - frame->end);
+
+    if (br > 0) {
+        frame->end += br;
+    }
+
+    return br;
+}
+
+/*
+ * Get the next complete line (without EOL). The slice stays valid
+ * until the next para_frame_read(). Returns 1 if a line is given,
+ * 0 if more input is needed.
+ */
+int para_frame_next(para_frame_t *frame, const char **line, size_t *len)
+{
+    while (frame->scan < frame->end) {
+        char *eol = memchr(frame->buffer + frame->scan, PARA_SERIAL_EOL, frame->end - frame->scan);
+
+        if (eol == NULL) {
+            frame->scan = frame->end;
+
+            if (frame->end - frame->start >= PARA_SERIAL_INPUT_LEN) {
+                // Something awry happened, input should not be that long! Drop until next EOL.
+                if (!frame->discarding) {
+                    log_error("SERIAL: input [%.*s] is too long, resyncing\n", PARA_SERIAL_INPUT_LEN, frame->buffer + frame->start);
+                    frame->resyncs++;
+                    frame->discarding = 1;
+                }
+
+                frame->start = frame->end;
+            }
+
+            return 0;
+        }
+
+        size_t line_start = frame->start;
+        size_t line_end = eol - frame->buffer;
+
+        frame->start = line_end + 1;
+        frame->scan = frame->start;
+
+        if (frame->discarding) {
+            // The tail of an over-long line.
+            frame->discarding = 0;
+            continue;
+        }
+
+        // Stray NUL or LF bytes (e.g. on USB reconnect) are not part of PRT3 lines.
+        while (line_start < line_end && (frame->buffer[line_start] == 0 || frame->buffer[line_start] == '\n')) {
+            line_start++;
+        }
+
+        if (line_start == line_end) {
+            continue;
+        }
+
+        if (line_end - line_start >= PARA_SERIAL_INPUT_LEN) {
+            log_error("SERIAL: input [%.*s] is too long, resyncing\n", PARA_SERIAL_INPUT_LEN, frame->buffer + line_start);
+            frame->resyncs++;
+            continue;
+        }
+
+        *line = frame->buffer + line_start;
+        *len = line_end - line_start;
+        frame->lines++;
+
+        return 1;
+    }
+
+    return 0;
+}
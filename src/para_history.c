@@ -0,0 +1,106 @@
+/*
+ * The source of the MQTT daemon interacting with Paradox EVO control panel
+ * via their's PRT3 module.
+ *
+ * para_history.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Darau, blė
+ *
+ *  This file is a part of personal use utilities developed to be used
+ *  on various Linux devices.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "para_history.h"
+#include "time_helpers.h"
+
+/*
+ * Size 0 keeps no history. Returns -1 if the entries cannot be allocated.
+ */
+int para_history_init(para_history_t *hist, int size)
+{
+    memset(hist, 0, sizeof(para_history_t));
+
+    if (size <= 0) {
+        return 0;
+    }
+
+    if (!(hist->entries = calloc(size, sizeof(para_history_entry_t)))) {
+        log_error("HIST: cannot allocate %d events\n", size);
+        return -1;
+    }
+
+    hist->size = size;
+
+    return 0;
+}
+
+void para_history_free(para_history_t *hist)
+{
+    free(hist->entries);
+    hist->entries = NULL;
+    hist->size = 0;
+}
+
+void para_history_add(para_history_t *hist, int group, int num, int area, char status, char mqtt_state)
+{
+    if (!hist->size) {
+        return;
+    }
+
+    para_history_entry_t *entry = &hist->entries[hist->count % hist->size];
+
+    entry->time = t_now_ms();
+    entry->group = group;
+    entry->num = num;
+    entry->area = area;
+    entry->status = status;
+    entry->mqtt_state = mqtt_state;
+
+    hist->count++;
+}
+
+/*
+ * Copy up to count latest events of the area (0 - of all areas) to out, oldest first.
+ * Returns the number of events copied.
+ */
+int para_history_query(const para_history_t *hist, int area, int count, para_history_entry_t *out)
+{
+    unsigned long long kept = hist->count < hist->size ? hist->count : hist->size;
+    unsigned long long first = hist->count;
+    int found = 0;
+
+    // Walk back from the newest to find where the answer starts.
+    while (found < count && first > hist->count - kept) {
+        first--;
+
+        if (!area || hist->entries[first % hist->size].area == area) {
+            found++;
+        }
+    }
+
+    int copied = 0;
+
+    for (unsigned long long i = first; copied < found; i++) {
+        const para_history_entry_t *entry = &hist->entries[i % hist->size];
+
+        if (!area || entry->area == area) {
+            out[copied++] = *entry;
+        }
+    }
+
+    return copied;
+}
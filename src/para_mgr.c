@@ -30,151 +30,215 @@
 #include "log.h"
 #include "endpoints.h"
 #include "para_mgr.h"
+#include "para_area.h"
+#include "para_history.h"
+#include "para_parse.h"
+#include "para_poll.h"
+#include "para_report.h"
+#include "para_sched.h"
+#include "para_serial.h"
+#include "para_snapshot.h"
+#include "para_state.h"
 #include "paratypes.h"
+#include "time_helpers.h"
 
-static para_area_t *areas[MAX_AREAS];
-static para_zone_t *zones[MAX_ZONES];
-
-static void *para_mgr_thread(void *context);
-static void *para_mgr_initial_request_thread(void *serial_sender);
-static void *para_mgr_area_status_thread(void *serial_sender);
-static void para_request_area_status(void *serial_sender, int areanum);
-static void para_request_area_label(void *serial_sender, int areanum);
-static void para_area_arm(void *serial_sender, int areanum, char arm_type, char *user_code);
-static void para_area_disarm(void *serial_sender, int areanum, char *user_code);
-static void para_area_quick_arm(void *serial_sender, int areanum, char arm_type);
-static void para_request_zone_status(void *serial_sender, int zonenum);
-static void para_request_zone_label(void *serial_sender, int zonenum);
-static void para_utility_key(void *serial_sender, int utility_key);
-static void para_process_prt3_event(char *prt3_string, void *serial_sender, void *mqtt_area_report, void *mqtt_zone_report);
-static void para_process_prt3_response(char *prt3_string, void *mqtt_area_report, void *mqtt_zone_report);
-static void para_process_command(void *mqtt_area_command, void *serial_sender);
-static int  get_number_at_substring(char *str, size_t length);
-static void set_label(char *dst, const char *src);
-static void update_area_record(int area_num, char *prt3_string);
-static void update_zone_record(int zone_num, char *prt3_string);
-static void send_area_report(int area_num, void *mqtt_sender);
-static void send_zone_report(int zone_num, void *mqtt_sender);
-
-static void area_set_status(int area_num, char status);
-static void area_set_memory(int area_num, char memory);
-static void area_set_trouble(int area_num, char trouble);
-static void area_set_ready(int area_num, char ready);
-static void area_set_programming(int area_num, char programming);
-static void area_set_alarm(int area_num, char alarm);
-static void area_set_strobe(int area_num, char strobe);
-static void area_update_mqtt_state(int area_num);
-
-static void zone_set_status(int zone_num, char status);
-static void zone_set_alarm(int zone_num, char alarm);
-static void zone_set_fire(int zone_num, char fire);
-static void zone_set_supervision(int zone_num, char supervision);
-static void zone_set_battery(int zone_num, char battery);
-static void zone_set_bypassed(int zone_num, char bypassed);
-static void zone_update_mqtt_state(int zone_num);
-static void zone_update_area_alarm(int zone_num);
+/*
+ * An arm or disarm command from MQTT, until the panel confirms it.
+ * Meanwhile the area is published as arming or disarming.
+ */
+typedef struct {
+    int active;
+    para_arm_cmd_e_t command;
+    long long sent_at; // Monotonic ms when received from MQTT
+    long long echo_at; // When PRT3 answered &ok, 0 before
+    long long deadline;
+    int failed; // PRT3 answered &fail
+} para_area_command_t;
+
+typedef struct {
+    para_panel_config_t *cfg;
+    void *context;
+    para_state_t state;
+    para_snapshot_t snapshot;
+    para_sched_t sched;
+    para_poll_t poll;
+    para_history_t history;
+    int serial_online; // Replay never reports, so assume it is there
+    int flush_now; // An alarm changed, do not wait for the coalescing window
+    unsigned ready_sent; // Ready areas last reported to MQTT
+    unsigned troubles_sent; // System troubles last reported to MQTT
+    uint64_t areas_refresh[PARA_AREA_WORDS]; // Asked for over MQTT, reported even if unchanged
+    uint64_t zones_refresh[PARA_ZONE_WORDS];
+    int refresh_tokens;
+    long long refresh_at; // When the last token was added
+    long long dump_at;
+    para_area_command_t commands[MAX_AREAS];
+} para_panel_t;
+
+static para_panel_t panels[MAX_PANELS];
+
+static void *para_mgr_thread(void *arg);
+static void para_mgr_initial_request(para_panel_t *panel, int labels);
+static void para_mgr_area_status_request(para_panel_t *panel);
+static int area_record_drifted(para_panel_t *panel, int area_num, const char *prt3_string);
+static void para_mgr_resync_request(para_panel_t *panel);
+static void para_serial_state(para_panel_t *panel, void *serial_status);
+static void para_request_area_status(para_panel_t *panel, int areanum);
+static void para_request_area_label(para_panel_t *panel, int areanum);
+static void para_area_arm(para_panel_t *panel, int areanum, char arm_type, char *user_code);
+static void para_area_disarm(para_panel_t *panel, int areanum, char *user_code);
+static void para_area_quick_arm(para_panel_t *panel, int areanum, char arm_type);
+static void para_request_zone_status(para_panel_t *panel, int zonenum);
+static void para_request_zone_label(para_panel_t *panel, int zonenum);
+static void para_utility_key(para_panel_t *panel, int utility_key);
+static int para_refresh_allowed(para_panel_t *panel);
+static void para_refresh_area(para_panel_t *panel, int area_num);
+static void para_refresh_zone(para_panel_t *panel, int zone_num);
+static void para_dump(para_panel_t *panel);
+static void para_command_start(para_panel_t *panel, int area_num, para_arm_cmd_e_t command);
+static void para_command_echo(para_panel_t *panel, const para_line_t *line, int ok);
+static void para_command_check(para_panel_t *panel, void *mqtt_area_report);
+static void para_command_finish(para_panel_t *panel, int area_num, para_cmd_result_t result, void *mqtt_area_report);
+static void send_command_report(para_panel_t *panel, int area_num, para_arm_cmd_e_t command, para_cmd_result_t result,
+    unsigned latency, unsigned echo, void *mqtt_area_report);
+static int para_command_next_timeout(para_panel_t *panel);
+static void para_process_prt3_line(para_panel_t *panel, const char *prt3_string, int size);
+static void para_process_prt3_event(para_panel_t *panel, const para_line_t *line);
+static void para_process_prt3_response(para_panel_t *panel, const para_line_t *line);
+static void para_process_command(para_panel_t *panel, void *mqtt_area_command, void *mqtt_area_report);
+static void para_send_history(para_panel_t *panel, int area_num, int count, void *mqtt_area_report);
+static void update_area_record(para_panel_t *panel, int area_num, const char *prt3_string);
+static void update_zone_record(para_panel_t *panel, int zone_num, const char *prt3_string);
+static void send_reports(para_panel_t *panel, void *mqtt_area_report, void *mqtt_zone_report);
+static void send_area_report(para_panel_t *panel, int area_num, void *mqtt_sender);
+static void send_ready_report(para_panel_t *panel, void *mqtt_sender);
+static void send_trouble_report(para_panel_t *panel, void *mqtt_sender);
+static void send_zone_report(para_panel_t *panel, int zone_num, void *mqtt_sender);
+
+static void area_set_status(para_panel_t *panel, int area_num, char status);
+static void area_set_memory(para_panel_t *panel, int area_num, char memory);
+static void area_set_trouble(para_panel_t *panel, int area_num, char trouble);
+static void area_set_ready(para_panel_t *panel, int area_num, char ready);
+static void area_set_programming(para_panel_t *panel, int area_num, char programming);
+static void area_set_alarm(para_panel_t *panel, int area_num, char alarm);
+static void area_set_strobe(para_panel_t *panel, int area_num, char strobe);
+static void area_update_mqtt_state(para_panel_t *panel, int area_num);
+static void area_transition(para_panel_t *panel, int area_num, int group, int num);
+static void troubles_check_areas(para_panel_t *panel);
+
+static void zone_set_status(para_panel_t *panel, int zone_num, char status);
+static void zone_set_alarm(para_panel_t *panel, int zone_num, char alarm);
+static void zone_set_fire(para_panel_t *panel, int zone_num, char fire);
+static void zone_set_supervision(para_panel_t *panel, int zone_num, char supervision);
+static void zone_set_battery(para_panel_t *panel, int zone_num, char battery);
+static void zone_set_bypassed(para_panel_t *panel, int zone_num, char bypassed);
+static void zone_update_mqtt_state(para_panel_t *panel, int zone_num);
+static void zone_update_area_alarm(para_panel_t *panel, int zone_num);
+
+typedef void (*event_handler_t)(para_panel_t *panel, const para_line_t *line);
+
+static void event_zone_status(para_panel_t *panel, const para_line_t *line);
+static void event_area(para_panel_t *panel, const para_line_t *line);
+static void event_zone_alarm(para_panel_t *panel, const para_line_t *line);
+static void event_zone_restore(para_panel_t *panel, const para_line_t *line);
+static void event_status_3(para_panel_t *panel, const para_line_t *line);
+static void event_zone_bypass(para_panel_t *panel, const para_line_t *line);
+static void event_zone_tamper(para_panel_t *panel, const para_line_t *line);
+static void event_trouble(para_panel_t *panel, const para_line_t *line);
+static void event_log_only(para_panel_t *panel, const para_line_t *line);
+
+// Generated from PARA_EVENT_GROUPS, groups not listed there have no handler.
+static const struct {
+    event_handler_t handler;
+    int kind;
+    const char *name;
+} event_groups[G_GROUPS_LEN] = {
+#define X(name, group, handler, kind) [group] = { event_##handler, kind, #name + 2 },
+    PARA_EVENT_GROUPS(X)
+#undef X
+};
 
 void para_mgr_init()
 {
-    for (int i = 0; i < MAX_AREAS; i++) {
-        areas[i] = NULL;
-    }
+    memset(panels, 0, sizeof(panels));
 
-    for (int i = 0; i < MAX_ZONES; i++) {
-        zones[i] = NULL;
+    for (int i = 0; i < MAX_PANELS; i++) {
+        panels[i].cfg = &config.panels[i];
+        para_state_init(&panels[i].state);
+        panels[i].serial_online = 1;
     }
 }
 
 /*
- * Initialize appropriate area memory.
+ * Start monitoring the area.
  * NOTE: area index is 1 based!
  */
-int para_mgr_set_area(int area_num) {
-    log_verbose("PMGR: initialize area %d\n", area_num);
+int para_mgr_set_area(int panel_idx, int area_num) {
+    log_verbose("PMGR: initialize area %d on panel %d\n", area_num, panel_idx + 1);
 
-    int aidx = area_num - 1;
+    para_state_add_area(&panels[panel_idx].state, area_num);
 
-    if (areas[aidx] == NULL) {
-        areas[aidx] = malloc(sizeof(para_area_t));
-    }
-
-    if (areas[aidx]) {
-        memset(areas[aidx], 0, sizeof(para_area_t));
-        areas[aidx]->num = area_num;
-        areas[aidx]->firstreport = 1;
-        return 0;
-    } else {
-        return -1;
-    }
+    return 0;
 }
 
-int para_mgr_set_zone(int area_num, int zone_num)
+int para_mgr_set_zone(int panel_idx, int area_num, int zone_num)
 {
     log_verbose("PMGR: initialize zone %d on area %d\n", zone_num, area_num);
 
-    int zidx = zone_num - 1;
-
-    if (zones[zidx] == NULL) {
-        zones[zidx] = malloc(sizeof(para_zone_t));
-    }
-
-    // Assume the area is already initialized. Otherwise crash-boom-bang.
+    // Assume the area is already initialized.
+    para_state_add_zone(&panels[panel_idx].state, area_num, zone_num);
 
-    if (zones[zidx]) {
-        memset(zones[zidx], 0, sizeof(para_zone_t));
-        zones[zidx]->num = zone_num;
-        zones[zidx]->area = area_num;
-        zones[zidx]->bypassed = RS_OK;
-        
-        return 0;
-    } else {
-        return -1;
-    }
+    return 0;
 }
 
-pthread_t para_mgr_start(void *context)
+pthread_t para_mgr_start(int panel_idx, void *context)
 {
     pthread_t thread;
 
-    pthread_create(&thread, NULL, para_mgr_thread, context);
+    panels[panel_idx].context = context;
+    pthread_create(&thread, NULL, para_mgr_thread, &panels[panel_idx]);
 
     return thread;
 }
 
 void para_mgr_clean() {
-    for (int i = 0; i < MAX_AREAS; i++) {
-        if (areas[i] != NULL) {
-            free(areas[i]);
-        }
-    }
-
-    for (int i = 0; i < MAX_ZONES; i++) {
-        if (zones[i] != NULL) {
-            free(zones[i]);
-        }
+    // State is not allocated, just forget what was monitored.
+    for (int p = 0; p < MAX_PANELS; p++) {
+        para_state_init(&panels[p].state);
     }
 }
 
-static void *para_mgr_thread(void *context)
+static void *para_mgr_thread(void *arg)
 {
     __label__ EXIT_PMGR_THREAD;
 
-    log_info("PMGR: starting thread...\n");
+    para_panel_t *panel = (para_panel_t*) arg;
+    void *context = panel->context;
+    int index = panel->cfg->index;
+    char endpoint[EPT_NAME_LEN];
+
+    log_info("PMGR: starting thread for panel %d...\n", index + 1);
 
     void *kill_subscriber = NULL;
     void *serial_receiver = NULL;
     void *serial_sender = NULL;
+    void *serial_status = NULL;
     void *mqtt_area_command = NULL;
     void *mqtt_area_report = NULL;
     void *mqtt_zone_report = NULL;
     int rc;
 
-    if ((rc = z_start_endpoint(context, &serial_receiver, ZMQ_PULL, EPT_SERIAL_READ)) != 0) {
+    if ((rc = z_start_endpoint(context, &serial_receiver, ZMQ_PULL, z_panel_endpoint(endpoint, EPT_SERIAL_READ, index))) != 0) {
         log_error("PMGR: cannot start serial receiver: %d, exiting.\n", rc);
         goto EXIT_PMGR_THREAD;
     }
 
-    if ((rc = z_start_endpoint(context, &mqtt_area_command, ZMQ_PULL, EPT_MQTT_AREA_COMMAND)) != 0) {
+    if ((rc = z_start_endpoint(context, &serial_status, ZMQ_PULL, z_panel_endpoint(endpoint, EPT_SERIAL_STATUS, index))) != 0) {
+        log_error("PMGR: cannot start serial status receiver: %d, exiting.\n", rc);
+        goto EXIT_PMGR_THREAD;
+    }
+
+    if ((rc = z_start_endpoint(context, &mqtt_area_command, ZMQ_PULL, z_panel_endpoint(endpoint, EPT_MQTT_AREA_COMMAND, index))) != 0) {
         log_error("PMGR: cannot start command receiver: %d, exiting.\n", rc);
         goto EXIT_PMGR_THREAD;
     }
@@ -189,18 +253,18 @@ static void *para_mgr_thread(void *context)
 
     zmq_setsockopt (kill_subscriber, ZMQ_SUBSCRIBE, "", 0);
 
-    if ((rc = z_connect_endpoint(context, &serial_sender, ZMQ_PUSH, EPT_SERIAL_WRITE)) != 0) {
+    if ((rc = z_connect_endpoint(context, &serial_sender, ZMQ_PUSH, z_panel_endpoint(endpoint, EPT_SERIAL_WRITE, index))) != 0) {
         log_error("PMGR: cannot start serial sender: %d, exiting\n", rc);
         goto EXIT_PMGR_THREAD;
     }
 
     if ((rc = z_connect_endpoint(context, &mqtt_area_report, ZMQ_PUSH, EPT_MQTT_AREA_REPORT)) != 0) {
-        log_error("PMGR: cannot start serial sender: %d, exiting\n", rc);
+        log_error("PMGR: cannot start area report sender: %d, exiting\n", rc);
         goto EXIT_PMGR_THREAD;
     }
 
     if ((rc = z_connect_endpoint(context, &mqtt_zone_report, ZMQ_PUSH, EPT_MQTT_ZONE_REPORT)) != 0) {
-        log_error("PMGR: cannot start serial sender: %d, exiting\n", rc);
+        log_error("PMGR: cannot start zone report sender: %d, exiting\n", rc);
         goto EXIT_PMGR_THREAD;
     }
     
@@ -208,16 +272,72 @@ static void *para_mgr_thread(void *context)
         { kill_subscriber, 0, ZMQ_POLLIN, 0 },
         { serial_receiver, 0, ZMQ_POLLIN, 0 },
         { mqtt_area_command, 0, ZMQ_POLLIN, 0 },
+        { serial_status, 0, ZMQ_POLLIN, 0 },
     };
 
-    log_info("PMGR: thread ready!\n");
+    log_info("PMGR: thread for panel %d ready!\n", index + 1);
 
-    pthread_t requestthread;
-    pthread_create(&requestthread, NULL, para_mgr_initial_request_thread, serial_sender);
-    pthread_detach(requestthread);
+    para_sched_init(&panel->sched, config.prt3_window, config.prt3_timeout);
+    para_poll_init(&panel->poll, panel->state.areas_monitored, config.area_status_period * 1000);
+    para_history_init(&panel->history, config.history);
+    panel->refresh_tokens = PARA_MGR_REFRESH_BURST;
+    panel->refresh_at = t_now_ms();
+
+    int warm = 0;
+
+    if (panel->cfg->snapshot_file && para_snapshot_open(&panel->snapshot, panel->cfg->snapshot_file, &panel->state) == 0) {
+        warm = para_snapshot_load(&panel->snapshot, &panel->state);
+    }
+
+    if (warm) {
+        // Publish the last known state at once, the panel is asked in the background.
+        log_info("PMGR: panel %d state loaded from snapshot\n", index + 1);
+        send_reports(panel, mqtt_area_report, mqtt_zone_report);
+    }
+
+    panel->ready_sent = ~0U; // Report "nothing ready yet" to replace a retained one
+    send_ready_report(panel, mqtt_area_report);
+    panel->troubles_sent = ~0U; // Reported once known
+
+    para_mgr_initial_request(panel, !warm);
+    para_sched_dispatch(&panel->sched, serial_sender);
+
+    long long flush_at = 0; // When the coalesced reports are due, 0 if nothing is pending
+    long long save_at = 0; // When the changed state is due to the snapshot, 0 if nothing is pending
     
     while (1) {
-        int rc = zmq_poll(items, 3, config.area_status_period * 1000);
+        // Wake up for whichever comes first: a request timing out or an area due for polling.
+        long timeout = para_poll_next_timeout(&panel->poll, panel->state.areas_monitored);
+        // Requests in flight wait for the device to come back, no timeouts meanwhile.
+        int sched_timeout = panel->serial_online ? para_sched_next_timeout(&panel->sched) : -1;
+
+        if (sched_timeout >= 0 && (timeout < 0 || sched_timeout < timeout)) {
+            timeout = sched_timeout;
+        }
+
+        int command_timeout = para_command_next_timeout(panel);
+
+        if (command_timeout >= 0 && (timeout < 0 || command_timeout < timeout)) {
+            timeout = command_timeout;
+        }
+
+        if (flush_at) {
+            long long flush_left = flush_at - t_now_ms();
+
+            if (timeout < 0 || flush_left < timeout) {
+                timeout = flush_left > 0 ? flush_left : 0;
+            }
+        }
+
+        if (save_at) {
+            long long save_left = save_at - t_now_ms();
+
+            if (timeout < 0 || save_left < timeout) {
+                timeout = save_left > 0 ? save_left : 0;
+            }
+        }
+
+        zmq_poll(items, 4, timeout);
 
         if (items[0].revents & ZMQ_POLLIN) {
             z_drop_message(kill_subscriber);
@@ -225,34 +345,68 @@ static void *para_mgr_thread(void *context)
             break;
         } else if (items[1].revents & ZMQ_POLLIN) {
             // Serial responses/events parsing here.
-            char *prt3_string = z_receive_string(serial_receiver);
-
-            // log_debug("PMGR: response/event received %s\n", prt3_string);
+            char prt3_string[PARA_SERIAL_INPUT_LEN + 1];
+            int size = zmq_recv(serial_receiver, prt3_string, PARA_SERIAL_INPUT_LEN, 0);
 
-            if (prt3_string[0] == PRT3_EVENT) {
-                para_process_prt3_event(prt3_string, serial_sender, mqtt_area_report, mqtt_zone_report);
-            } else {
-                para_process_prt3_response(prt3_string, mqtt_area_report, mqtt_zone_report);
+            if (size <= 0 || size > PARA_SERIAL_INPUT_LEN) {
+                continue;
             }
 
-            free(prt3_string);
+            prt3_string[size] = 0;
+
+            para_process_prt3_line(panel, prt3_string, size);
         } else if (items[2].revents & ZMQ_POLLIN) {
-            para_process_command(mqtt_area_command, serial_sender);
+            para_process_command(panel, mqtt_area_command, mqtt_area_report);
+        } else if (items[3].revents & ZMQ_POLLIN) {
+            para_serial_state(panel, serial_status);
         }
 
-        if (rc == 0) {
-            // TODO: timeout periodically and more often, check the last run time
-            // and only then start the thread. Otherwise long timeouts might not happen
-            // (e.g. if one disarmed area is crowded, but status update is desired on other armed area).
-            
-            // Timeout, request areas
-            pthread_t t;
-            pthread_create(&t, NULL, para_mgr_area_status_thread, serial_sender);
-            pthread_detach(t);
+        // Before the reports, so a failed command is not published as still going.
+        para_command_check(panel, mqtt_area_report);
+
+        // Changes within the window end up in one report with the final state.
+        if (para_state_dirty(&panel->state)) {
+            long long now = t_now_ms();
+
+            if (config.coalesce == 0 || panel->flush_now || (flush_at && now >= flush_at)) {
+                send_reports(panel, mqtt_area_report, mqtt_zone_report);
+                panel->flush_now = 0;
+                flush_at = 0;
+            } else if (!flush_at) {
+                flush_at = now + config.coalesce;
+            }
+        }
+
+        send_trouble_report(panel, mqtt_area_report);
+
+        // Areas are ready once their coalesced statuses are out too.
+        if (!para_state_dirty(&panel->state)) {
+            send_ready_report(panel, mqtt_area_report);
+        }
+
+        // Changes within the interval are saved at once, not rehashed line by line.
+        if (panel->snapshot.data && panel->state.unsaved) {
+            long long now = t_now_ms();
+
+            if (!save_at) {
+                save_at = now + PARA_MGR_SNAPSHOT_INTERVAL;
+            } else if (now >= save_at) {
+                para_snapshot_save(&panel->snapshot, &panel->state);
+                save_at = 0;
+            }
+        }
+
+        para_mgr_area_status_request(panel);
+
+        if (panel->serial_online) {
+            para_sched_dispatch(&panel->sched, serial_sender);
         }
     }
 
 EXIT_PMGR_THREAD:
+    para_snapshot_close(&panel->snapshot, &panel->state);
+    para_history_free(&panel->history);
+
     if (serial_sender) {
         zmq_close(serial_sender);
     }
@@ -265,6 +419,10 @@ EXIT_PMGR_THREAD:
         zmq_close(serial_receiver);
     }
 
+    if (serial_status) {
+        zmq_close(serial_status);
+    }
+
     if (mqtt_area_command) {
         zmq_close(mqtt_area_command);
     }
@@ -281,455 +439,706 @@ EXIT_PMGR_THREAD:
 }
 
 /**
- * Request status and labels from all areas and zones.
- * Needs to be in a separate thread for the main thread
- * to absorb and parse results.
- * 
- * Also needs delays between requests for serial port
- * to send request and read response in a timely manner.
+ * Queue status and label requests of all areas and zones.
+ * The scheduler paces them to PRT3 in this order as responses arrive:
+ * area statuses are the most useful, labels can wait.
+ * Labels are skipped when they are known from the snapshot.
  */
-void *para_mgr_initial_request_thread(void *serial_sender)
+static void para_mgr_initial_request(para_panel_t *panel, int labels)
 {
-    log_info("PMGR: Initial request started...\n");
+    log_info("PMGR: Initial request queued%s.\n", labels ? "" : ", labels are known");
 
-    struct timespec tv = {
-        .tv_sec = 0,
-        .tv_nsec = 100000000,
-    };
+    para_state_t *state = &panel->state;
 
-    // Give time for the main thread to go into loop
-    nanosleep(&tv, NULL);
+    for (int a = 0; (a = para_state_next_area(state->areas_monitored, a)); ) {
+        para_request_area_status(panel, a);
+    }
 
-    for (int i = 0; i < MAX_AREAS; i++) {
-        if (areas[i]) {
-            para_request_area_label(serial_sender, areas[i]->num);
-            para_request_area_status(serial_sender, areas[i]->num);
-        }
+    for (int z = 0; (z = para_state_next_zone(state->zones_monitored, z)); ) {
+        para_request_zone_status(panel, z);
     }
 
-    for (int i = 0; i < MAX_ZONES; i++) {
-        if (zones[i]) {
-            para_request_zone_label(serial_sender, zones[i]->num);
-            para_request_zone_status(serial_sender, zones[i]->num);
-        }
+    if (!labels) {
+        return;
     }
 
-    log_info("PMGR: Initial request done.\n");
-    return NULL;
+    for (int a = 0; (a = para_state_next_area(state->areas_monitored, a)); ) {
+        para_request_area_label(panel, a);
+    }
+
+    for (int z = 0; (z = para_state_next_zone(state->zones_monitored, z)); ) {
+        para_request_zone_label(panel, z);
+    }
 }
 
-static void *para_mgr_area_status_thread(void *serial_sender)
+/**
+ * Request statuses of areas, which have not been confirmed within their period.
+ * Traffic of other areas does not postpone them.
+ */
+static void para_mgr_area_status_request(para_panel_t *panel)
 {
-    log_debug("PMGR: periodic area status update\n");
-
-    for (int i = 0; i < MAX_AREAS; i++) {
-        if (areas[i]) {
-            para_request_area_status(serial_sender, areas[i]->num);
-        }
+    for (int a = 0; (a = para_poll_next_due(&panel->poll, panel->state.areas_monitored, a)); ) {
+        log_debug("PMGR: periodic status update of area %d\n", a);
+        para_request_area_status(panel, a);
     }
-
-    return NULL;
 }
 
-static void para_send_request(void *serial_sender, char *request, int size)
+/**
+ * Labels cannot change while PRT3 is unplugged, but statuses might have,
+ * so only those are requested again after reconnecting.
+ */
+static void para_mgr_resync_request(para_panel_t *panel)
 {
-    zmq_msg_t message;
-    zmq_msg_init_size(&message, size);
+    log_info("PMGR: serial of panel %d is back, resyncing statuses.\n", panel->cfg->index + 1);
 
-    memcpy(zmq_msg_data(&message), request, size);
+    for (int a = 0; (a = para_state_next_area(panel->state.areas_monitored, a)); ) {
+        para_request_area_status(panel, a);
+    }
 
-    zmq_msg_send (&message, serial_sender, 0);
-    zmq_msg_close (&message);
+    for (int z = 0; (z = para_state_next_zone(panel->state.zones_monitored, z)); ) {
+        para_request_zone_status(panel, z);
+    }
+}
 
-    // Block before next request (if sent sequentially).
-    struct timespec tv = {
-        .tv_sec = 0,
-        .tv_nsec = 20000000,
-    };
+static void para_serial_state(para_panel_t *panel, void *serial_status)
+{
+    char state = SERIAL_OFFLINE;
 
-    nanosleep(&tv, NULL);
+    if (zmq_recv(serial_status, &state, 1, 0) != 1) {
+        return;
+    }
+
+    if (state == SERIAL_OFFLINE) {
+        log_error("PMGR: serial of panel %d is offline, holding requests.\n", panel->cfg->index + 1);
+        panel->serial_online = 0;
+
+        // Not ready until the statuses are resynced.
+        memset(panel->state.areas_known, 0, sizeof(panel->state.areas_known));
+        memset(panel->state.zones_known, 0, sizeof(panel->state.zones_known));
+    } else if (!panel->serial_online) {
+        panel->serial_online = 1;
+        para_sched_resend_inflight(&panel->sched);
+        para_mgr_resync_request(panel);
+    }
 }
 
-static void para_request_area_status(void* serial_sender, int areanum)
+static void para_request_area_status(para_panel_t *panel, int areanum)
 {
     log_debug("PMGR: request status for area %d\n", areanum);
-    char req[6];
-    sprintf(req, "RA%03d", areanum);
-
-    para_send_request(serial_sender, req, 5);
+    para_sched_request(&panel->sched, RQ_AREA_STATUS, areanum, NULL);
 }
 
-static void para_request_area_label(void* serial_sender, int areanum)
+static void para_request_area_label(para_panel_t *panel, int areanum)
 {
     log_debug("PMGR: request label for area %d\n", areanum);
-    char req[6];
-    sprintf(req, "AL%03d", areanum);
-
-    para_send_request(serial_sender, req, 5);
+    para_sched_request(&panel->sched, RQ_AREA_LABEL, areanum, NULL);
 }
 
-static void para_request_zone_status(void* serial_sender, int zonenum)
+static void para_request_zone_status(para_panel_t *panel, int zonenum)
 {
     log_debug("PMGR: request status for zone %d\n", zonenum);
-    char req[6];
-    sprintf(req, "RZ%03d", zonenum);
-
-    para_send_request(serial_sender, req, 5);
+    para_sched_request(&panel->sched, RQ_ZONE_STATUS, zonenum, NULL);
 }
 
-static void para_request_zone_label(void* serial_sender, int zonenum)
+static void para_request_zone_label(para_panel_t *panel, int zonenum)
 {
     log_debug("PMGR: request label for zone %d\n", zonenum);
-    char req[6];
-    sprintf(req, "ZL%03d", zonenum);
-
-    para_send_request(serial_sender, req, 5);
+    para_sched_request(&panel->sched, RQ_ZONE_LABEL, zonenum, NULL);
 }
 
-static void para_area_arm(void *serial_sender, int areanum, char arm_type, char *user_code)
+static void para_area_arm(para_panel_t *panel, int areanum, char arm_type, char *user_code)
 {
     log_debug("PMGR: arm area %d to %c\n", areanum, arm_type);
-    char req[13];
-    snprintf(req, 13, "AA%03d%c%s", areanum, arm_type, user_code);
+    char arg[PARA_REQUEST_LEN];
+    snprintf(arg, PARA_REQUEST_LEN, "%c%s", arm_type, user_code);
 
-    para_send_request(serial_sender, req, strlen(req));
+    para_sched_request(&panel->sched, RQ_AREA_ARM, areanum, arg);
 }
 
-static void para_area_disarm(void *serial_sender, int areanum, char *user_code)
+static void para_area_disarm(para_panel_t *panel, int areanum, char *user_code)
 {
     log_debug("PMGR: disarm area %d\n", areanum);
-    char req[12];
-    snprintf(req, 12, "AD%03d%s", areanum, user_code);
-
-    para_send_request(serial_sender, req, strlen(req));
+    para_sched_request(&panel->sched, RQ_AREA_DISARM, areanum, user_code);
 }
 
-static void para_area_quick_arm(void *serial_sender, int areanum, char arm_type)
+static void para_area_quick_arm(para_panel_t *panel, int areanum, char arm_type)
 {
     log_debug("PMGR: quick arm area %d to %c\n", areanum, arm_type);
-    char req[7];
-    sprintf(req, "AQ%03d%c", areanum, arm_type);
+    char arg[2] = { arm_type, 0 };
 
-    para_send_request(serial_sender, req, 6);
+    para_sched_request(&panel->sched, RQ_AREA_QUICK_ARM, areanum, arg);
 }
 
-static void para_utility_key(void *serial_sender, int utility_key)
+static void para_utility_key(para_panel_t *panel, int utility_key)
 {
     log_debug("PMGR: utility key: %d\n", utility_key);
-    char req[6];
-    sprintf(req, "UK%03d", utility_key);
+    para_sched_request(&panel->sched, RQ_UTILITY_KEY, utility_key, NULL);
+}
+
+/*
+ * Token bucket of on-demand refreshes: PARA_MGR_REFRESH_BURST at once,
+ * then one per PARA_MGR_REFRESH_INTERVAL, so a chatty client cannot keep PRT3 busy.
+ */
+static int para_refresh_allowed(para_panel_t *panel)
+{
+    long long now = t_now_ms();
+    long long added = (now - panel->refresh_at) / PARA_MGR_REFRESH_INTERVAL;
 
-    para_send_request(serial_sender, req, 5);
+    if (added > 0) {
+        panel->refresh_tokens += added > PARA_MGR_REFRESH_BURST ? PARA_MGR_REFRESH_BURST : added;
+
+        if (panel->refresh_tokens >= PARA_MGR_REFRESH_BURST) {
+            panel->refresh_tokens = PARA_MGR_REFRESH_BURST;
+            panel->refresh_at = now;
+        } else {
+            panel->refresh_at += added * PARA_MGR_REFRESH_INTERVAL;
+        }
+    }
+
+    if (panel->refresh_tokens == 0) {
+        return 0;
+    }
+
+    panel->refresh_tokens--;
+
+    return 1;
+}
+
+/*
+ * A refresh of an area/zone, which is still waiting for its response,
+ * is answered by that response and costs nothing.
+ */
+static void para_refresh_area(para_panel_t *panel, int area_num)
+{
+    if (!para_state_has_area(&panel->state, area_num)) {
+        log_error("PMGR: refresh of area %d, which is not monitored\n", area_num);
+        return;
+    }
+
+    if (!para_sched_pending(&panel->sched, RQ_AREA_STATUS, area_num)) {
+        if (!para_refresh_allowed(panel)) {
+            log_info("PMGR: too many refreshes, area %d ignored\n", area_num);
+            return;
+        }
+
+        para_request_area_status(panel, area_num);
+    }
+
+    bits_set(panel->areas_refresh, area_num - 1);
+}
+
+static void para_refresh_zone(para_panel_t *panel, int zone_num)
+{
+    if (!para_state_has_zone(&panel->state, zone_num)) {
+        log_error("PMGR: refresh of zone %d, which is not monitored\n", zone_num);
+        return;
+    }
+
+    if (!para_sched_pending(&panel->sched, RQ_ZONE_STATUS, zone_num)) {
+        if (!para_refresh_allowed(panel)) {
+            log_info("PMGR: too many refreshes, zone %d ignored\n", zone_num);
+            return;
+        }
+
+        para_request_zone_status(panel, zone_num);
+    }
+
+    bits_set(panel->zones_refresh, zone_num - 1);
+}
+
+/*
+ * Republish the known state without asking PRT3. Empty reports make
+ * MQTT manager publish what it has cached, readiness is sent again too.
+ */
+static void para_dump(para_panel_t *panel)
+{
+    long long now = t_now_ms();
+
+    if (panel->dump_at && now - panel->dump_at < PARA_MGR_DUMP_INTERVAL) {
+        log_info("PMGR: dump of panel %d was done recently, ignored\n", panel->cfg->index + 1);
+        return;
+    }
+
+    log_verbose("PMGR: dumping state of panel %d\n", panel->cfg->index + 1);
+
+    panel->dump_at = now;
+    para_state_dirty_reported(&panel->state);
+    panel->ready_sent = ~0U;
+    panel->troubles_sent = ~0U;
+    panel->flush_now = 1;
+}
+
+/*
+ * Answer a history query of the area (0 - all areas) with up to count latest events.
+ */
+static void para_send_history(para_panel_t *panel, int area_num, int count, void *mqtt_area_report)
+{
+    if (area_num && !para_state_has_area(&panel->state, area_num)) {
+        log_error("PMGR: history of area %d, which is not monitored\n", area_num);
+        return;
+    }
+
+    if (count <= 0) {
+        count = PARA_HISTORY_QUERY_DEFAULT;
+    } else if (count > PARA_HISTORY_QUERY_MAX) {
+        count = PARA_HISTORY_QUERY_MAX;
+    }
+
+    para_history_entry_t *events = malloc(count * sizeof(para_history_entry_t));
+    uint8_t *report = malloc(PARA_REPORT_HISTORY_LEN(count));
+
+    if (events && report) {
+        count = para_history_query(&panel->history, area_num, count, events);
+        size_t len = para_report_encode_history(report, panel->cfg->index, area_num, events, count, t_now_ms());
+
+        log_debug("PMGR: sending %d events of history\n", count);
+        zmq_send(mqtt_area_report, report, len, 0);
+    } else {
+        log_error("PMGR: cannot allocate history of %d events\n", count);
+    }
+
+    free(events);
+    free(report);
+}
+
+/*
+ * Publish the area as arming or disarming until the panel confirms the command.
+ * A command replaces the one still awaited on the area.
+ */
+static void para_command_start(para_panel_t *panel, int area_num, para_arm_cmd_e_t command)
+{
+    para_area_command_t *cmd = &panel->commands[area_num - 1];
+    long long now = t_now_ms();
+
+    if (cmd->active) {
+        log_info("PMGR: command %d on area %d replaces %d\n", command, area_num, cmd->command);
+    }
+
+    cmd->active = 1;
+    cmd->command = command;
+    cmd->sent_at = now;
+    cmd->echo_at = 0;
+    cmd->deadline = now + PARA_MGR_COMMAND_TIMEOUT;
+    cmd->failed = 0;
+
+    para_state_area_set(&panel->state, area_num, AF_MQTT_STATE, command == AC_DISARM ? MQP_DISARMING : MQP_ARMING);
+    panel->flush_now = 1;
 }
 
-static void para_process_prt3_event(char *prt3_string, void* serial_sender, void *mqtt_area_report, void *mqtt_zone_report)
+/*
+ * AA, AQ or AD echo: &ok lets the events confirm the command, &fail ends it.
+ */
+static void para_command_echo(para_panel_t *panel, const para_line_t *line, int ok)
 {
-    int event_group = get_number_at_substring(prt3_string + 1, 3);
-    int event_num = get_number_at_substring(prt3_string + 5, 3);
-    int area_num = get_number_at_substring(prt3_string + 9, 3);
+    int area_num = line->num;
 
     if (
-        (
-            (event_group >= G_ZONE_OK && event_group <= G_ZONE_FIRE_LOOP)
-            || (event_group >= G_ZONE_BYPASSED && event_group <= G_ZONE_FIRE_RESTORE)
-        )
-        && event_num < 1
+        (line->type != PL_AREA_ARM && line->type != PL_AREA_QUICK_ARM && line->type != PL_AREA_DISARM)
+        || !para_state_has_area(&panel->state, area_num)
+        || !panel->commands[area_num - 1].active
     ) {
+        return;
+    }
+
+    para_area_command_t *cmd = &panel->commands[area_num - 1];
+
+    if ((line->type == PL_AREA_DISARM) != (cmd->command == AC_DISARM)) {
+        log_debug("PMGR: echo %.5s is not of the awaited command\n", line->str);
+        return;
+    }
+
+    if (ok) {
+        cmd->echo_at = t_now_ms();
+    } else {
+        cmd->failed = 1;
+    }
+}
+
+/*
+ * An echoed command is done once the area got there: out of disarmed for
+ * arming (the exit delay counts), disarmed for disarming.
+ */
+static void para_command_check(para_panel_t *panel, void *mqtt_area_report)
+{
+    long long now = t_now_ms();
+
+    for (int a = 0; (a = para_state_next_area(panel->state.areas_monitored, a)); ) {
+        para_area_command_t *cmd = &panel->commands[a - 1];
+
+        if (!cmd->active) {
+            continue;
+        }
+
+        int disarmed = panel->state.areas[a - 1].status == RS_AREA_DISARMED;
+
+        if (cmd->echo_at && disarmed == (cmd->command == AC_DISARM)) {
+            para_command_finish(panel, a, CR_OK, mqtt_area_report);
+        } else if (cmd->failed) {
+            para_command_finish(panel, a, CR_FAIL, mqtt_area_report);
+        } else if (now >= cmd->deadline) {
+            para_command_finish(panel, a, CR_TIMEOUT, mqtt_area_report);
+        }
+    }
+}
+
+/*
+ * Report the result with its latency. The area is published by its record
+ * again; if the command did not succeed, the panel is asked for the truth.
+ */
+static void para_command_finish(para_panel_t *panel, int area_num, para_cmd_result_t result, void *mqtt_area_report)
+{
+    para_area_command_t *cmd = &panel->commands[area_num - 1];
+    unsigned latency = t_now_ms() - cmd->sent_at;
+    unsigned echo = cmd->echo_at ? (unsigned) (cmd->echo_at - cmd->sent_at) : PARA_REPORT_NO_ECHO;
+
+    send_command_report(panel, area_num, cmd->command, result, latency, echo, mqtt_area_report);
+
+    cmd->active = 0;
+    area_update_mqtt_state(panel, area_num);
+    panel->flush_now = 1;
+
+    if (result != CR_OK) {
+        para_request_area_status(panel, area_num);
+    }
+}
+
+/*
+ * Milliseconds until the earliest command times out, -1 if none is awaited.
+ */
+static int para_command_next_timeout(para_panel_t *panel)
+{
+    long long deadline = -1;
+
+    for (int a = 0; a < MAX_AREAS; a++) {
+        if (panel->commands[a].active && (deadline < 0 || panel->commands[a].deadline < deadline)) {
+            deadline = panel->commands[a].deadline;
+        }
+    }
+
+    if (deadline < 0) {
+        return -1;
+    }
+
+    long long left = deadline - t_now_ms();
+
+    return left > 0 ? (int) left : 0;
+}
+
+/*
+ * A line from the panel: an event, or a response to the request in flight.
+ */
+static void para_process_prt3_line(para_panel_t *panel, const char *prt3_string, int size)
+{
+    para_line_t line;
+    int parsed = para_parse_line(prt3_string, size, &line);
+
+    if (parsed == 0 && line.type == PL_EVENT) {
+        para_process_prt3_event(panel, &line);
+    } else if (para_sched_response(&panel->sched, prt3_string) == RQR_FAIL) {
+        log_error("PMGR: request %.5s failed\n", prt3_string);
+
+        if (parsed == 0) {
+            para_command_echo(panel, &line, 0);
+        }
+    } else if (parsed == 0) {
+        para_process_prt3_response(panel, &line);
+    } else {
+        log_error("PMGR: malformed line [%s]\n", prt3_string);
+    }
+}
+
+/*
+ * Dispatch PRT3 event to its group handler. Events of areas and zones,
+ * which are not monitored, are dropped here. System events are of the
+ * whole panel, their area is not looked at.
+ */
+static void para_process_prt3_event(para_panel_t *panel, const para_line_t *line)
+{
+    int event_group = line->group;
+    int event_num = line->num;
+    int area_num = line->area;
+
+    if (event_group >= G_GROUPS_LEN || !event_groups[event_group].handler) {
+        log_verbose("PMGR: event group %d/%d/%d not supported yet!\n", event_group, event_num, area_num);
+        return;
+    }
+
+    int kind = event_groups[event_group].kind;
+
+    if (kind == EV_ZONE && event_num < 1) {
         log_error("PMGR-G: event/zone number is wrong: %d, %d, %d\n", event_group, event_num, area_num);
         return;
     }
 
-    if (area_num < 1 || area_num > MAX_AREAS) {
+    if (kind != EV_SYSTEM && (area_num < 1 || area_num > MAX_AREAS)) {
         log_error("PMGR_G: ignoring area: %d, %d, %d\n", event_group, event_num, area_num);
         return;
     }
 
-    switch (event_group) {
-        case G_ZONE_OK:
-            log_verbose("PMGR-G: zone %d on area %d OK/CLOSED\n", event_num, area_num);
-            zone_set_status(event_num, RS_ZONE_CLOSED);
-            zone_update_mqtt_state(event_num);
-            send_zone_report(event_num, mqtt_zone_report);
-        break;
+    // Panel reports all of its zones and areas, not only the monitored ones.
+    if (kind == EV_ZONE) {
+        if (!para_state_has_zone(&panel->state, event_num)) {
+            log_debug("PMGR-G: zone %d is not monitored\n", event_num);
+            return;
+        }
+    } else if (kind == EV_AREA && !para_state_has_area(&panel->state, area_num)) {
+        log_debug("PMGR-G: area %d is not monitored\n", area_num);
+        return;
+    }
 
-        case G_ZONE_OPEN:
-            log_verbose("PMGR-G: zone %d on area %d OPEN\n", event_num, area_num);
-            zone_set_status(event_num, RS_ZONE_OPEN);
-            zone_update_mqtt_state(event_num);
-            send_zone_report(event_num, mqtt_zone_report);
-        break;
+    event_groups[event_group].handler(panel, line);
 
-        case G_ZONE_TAMPERED:
-            log_verbose("PMGR-G: zone %d on area %d TAMPERED\n", event_num, area_num);
-            zone_set_status(event_num, RS_ZONE_TAMPERED);
-            zone_update_mqtt_state(event_num);
-            send_zone_report(event_num, mqtt_zone_report);
-        break;
+    // Keep the event with the state it has left.
+    if (kind == EV_ZONE) {
+        para_zone_state_t *zone = para_state_zone(&panel->state, event_num);
+        para_history_add(&panel->history, event_group, event_num, area_num, zone->status, zone->mqtt_state);
+    } else if (kind == EV_SYSTEM) {
+        char trouble = panel->state.troubles ? RS_AREA_TROUBLE : RS_OK;
+        para_history_add(&panel->history, event_group, event_num, area_num, trouble, 0);
+    } else {
+        para_area_state_t *area = &panel->state.areas[area_num - 1];
+        para_history_add(&panel->history, event_group, event_num, area_num, area->status, area->mqtt_state);
+    }
+}
 
-        case G_ZONE_FIRE_LOOP:
-            log_verbose("PMGR-G: zone %d on area %d FIRE_LOOP\n", event_num, area_num);
-            zone_set_status(event_num, RS_ZONE_FIRE);
-            zone_update_mqtt_state(event_num);
-            send_zone_report(event_num, mqtt_zone_report);
-        break;
+static void event_zone_status(para_panel_t *panel, const para_line_t *line)
+{
+    static const char zone_statuses[] = {
+        [G_ZONE_OK] = RS_ZONE_CLOSED,
+        [G_ZONE_OPEN] = RS_ZONE_OPEN,
+        [G_ZONE_TAMPERED] = RS_ZONE_TAMPERED,
+        [G_ZONE_FIRE_LOOP] = RS_ZONE_FIRE,
+    };
 
-        case G_ARMING_WITH_MASTER:
-        case G_ARMING_WITH_USER_CODE:
-        case G_ARMING_WITH_KEYSWITCH:
-        case G_SPECIAL_ARMING:
-            log_verbose("PMGR-G: area %d armed with event group: %d, event %d\n", area_num, event_group, event_num);
-            
-            if (areas[area_num - 1]->status == RS_AREA_DISARMED || areas[area_num - 1]->status == RS_AREA_EXIT_DELAY) {
-                if (event_group == G_SPECIAL_ARMING && event_num == 4) {
-                    area_set_status(area_num, RS_AREA_STAY_ARMED);
-                } else {
-                    area_set_status(area_num, RS_AREA_ARMED);
-                }
-                area_update_mqtt_state(area_num);
-                send_area_report(area_num, mqtt_area_report);
-            }
-        break;
+    log_verbose("PMGR-G: zone %d on area %d %s\n", line->num, line->area, event_groups[line->group].name);
+    zone_set_status(panel, line->num, zone_statuses[line->group]);
+    zone_update_mqtt_state(panel, line->num);
+}
 
-        case G_DISARM_WITH_MASTER:
-        case G_DISARM_WITH_USER_CODE:
-        case G_DISARM_WITH_KEYSWITCH:
-        case G_DISARM_AFTER_ALARM_WITH_MASTER:
-        case G_DISARM_AFTER_ALARM_WITH_USER_CODE:
-        case G_DISARM_AFTER_ALARM_WITH_KEYSWITCH:
-        case G_ALARM_CANCELLED_WITH_MASTER:
-        case G_ALARM_CANCELLED_WITH_USER_CODE:
-        case G_ALARM_CANCELLED_WITH_KEYSWITCH:
-        case G_SPECIAL_DISARM:
-            log_verbose("PMGR-G: disarm group %d, event %d, area %d\n", event_group, event_num, area_num);
-            
-            area_set_status(area_num, RS_AREA_DISARMED);
-            area_update_mqtt_state(area_num);
-            send_area_report(area_num, mqtt_area_report);
-        break;
+static void event_area(para_panel_t *panel, const para_line_t *line)
+{
+    log_verbose("PMGR-G: area %d %s %d\n", line->area, event_groups[line->group].name, line->num);
 
+    area_transition(panel, line->area, line->group, line->num);
+}
 
-        case G_ZONE_BYPASSED:
-            log_verbose("PMGR-G: zone %d on area %d BYPASSED\n", event_num, area_num);
-        break;
+static void event_zone_alarm(para_panel_t *panel, const para_line_t *line)
+{
+    log_verbose("PMGR-G: zone %d on area %d %s\n", line->num, line->area, event_groups[line->group].name);
 
-        case G_ZONE_IN_ALARM:
-            log_verbose("PMGR-G: zone %d on area %d ALARM\n", event_num, area_num);
-            zone_set_alarm(event_num, RS_ZONE_IN_ALARM);
-            zone_update_mqtt_state(event_num);
-            send_zone_report(event_num, mqtt_zone_report);
-            
-            area_set_alarm(area_num, RS_AREA_IN_ALARM);
-            area_update_mqtt_state(area_num);
-            send_area_report(area_num, mqtt_area_report);
-        break;
+    if (line->group == G_ZONE_FIRE_ALARM) {
+        zone_set_fire(panel, line->num, RS_ZONE_FIRE);
+    } else {
+        zone_set_alarm(panel, line->num, RS_ZONE_IN_ALARM);
+    }
 
-        case G_ZONE_FIRE_ALARM:
-            log_verbose("PMGR-G: zone %d on area %d FIRE_ALARM\n", event_num, area_num);
-            zone_set_fire(event_num, RS_ZONE_FIRE);
-            zone_update_mqtt_state(event_num);
-            send_zone_report(event_num, mqtt_zone_report);
-            
-            area_set_alarm(area_num, RS_AREA_IN_ALARM);
-            area_update_mqtt_state(area_num);
-            send_area_report(area_num, mqtt_area_report);
-        break;
+    zone_update_mqtt_state(panel, line->num);
 
-        case G_ZONE_ALARM_RESTORE:
-            log_verbose("PMGR-G: zone %d on area %d ALARM_RESTORE\n", event_num, area_num);
-            zone_set_alarm(event_num, RS_OK);
-            zone_update_mqtt_state(event_num);
-            send_zone_report(event_num, mqtt_zone_report);
-            // TODO: Does restore mean Area is back to Armed?
-        break;
+    if (para_state_has_area(&panel->state, line->area)) {
+        area_transition(panel, line->area, line->group, line->num);
+    }
+}
 
-        case G_ZONE_FIRE_RESTORE:
-            log_verbose("PMGR-G: zone %d on area %d FIRE_RESTORE\n", event_num, area_num);
-            zone_set_fire(event_num, RS_OK);
-            zone_update_mqtt_state(event_num);
-            send_zone_report(event_num, mqtt_zone_report);
-            // TODO: Does restore mean Area is back to Armed?
-        break;
+/*
+ * Only the zone is restored. The panel keeps its area in alarm until it is
+ * disarmed or the alarm is cancelled, and those events move the area.
+ */
+static void event_zone_restore(para_panel_t *panel, const para_line_t *line)
+{
+    log_verbose("PMGR-G: zone %d on area %d %s\n", line->num, line->area, event_groups[line->group].name);
 
-        case G_ZONE_SHUTDOWN:
-            log_verbose("PMGR-G: zone %d on area %d SHUTDOWN\n", event_num, area_num);
-        break;
+    if (line->group == G_ZONE_FIRE_RESTORE) {
+        zone_set_fire(panel, line->num, RS_OK);
+    } else {
+        zone_set_alarm(panel, line->num, RS_OK);
+    }
 
-        case G_ZONE_TAMPER:
-            log_verbose("PMGR-G: zone %d on area %d TAMPER\n", event_num, area_num);
-        break;
+    zone_update_mqtt_state(panel, line->num);
+}
 
-        case G_ZONE_TAMPER_RESTORE:
-            log_verbose("PMGR-G: zone %d on area %d TAMPER_RESTORE\n", event_num, area_num);
-        break;
+static void event_status_3(para_panel_t *panel, const para_line_t *line)
+{
+    int area_num = line->area;
 
-        case G_SPECIAL_TAMPER:
-            log_verbose("PMGR-G: zone %d on area %d SPECIAL_TAMPER\n", event_num, area_num);
-        break;
+    log_verbose("PMGR-G: STATUS_3 %d on area %d\n", line->num, area_num);
 
-        case G_TROUBLE_EVENT:
-            log_verbose("PMGR-G: TROUBLE_EVENT %d on area %d\n", event_num, area_num);
+    switch (line->num) {
+        case S3_TAMPER:
+        case S3_ZONE_LOW_BATTERY:
+        case S3_FIRE_LOOP_TROUBLE:
+        case S3_ZONE_SUPERVISION_TROUBLE:
+            area_set_trouble(panel, area_num, RS_AREA_TROUBLE);
+            panel->flush_now = 1;
         break;
+    }
+}
 
-        case G_TROUBLE_RESTORE:
-            log_verbose("PMGR-G: TROUBLE_RESTORE %d on area %d\n", event_num, area_num);
-        break;
+/*
+ * A bypassed zone, or one shut down by the panel after too many alarms,
+ * is not armed with its area: the area becomes armed_custom_bypass.
+ */
+static void event_zone_bypass(para_panel_t *panel, const para_line_t *line)
+{
+    int area_num = para_state_zone(&panel->state, line->num)->area;
 
-        case G_STATUS_1:
-            log_verbose("PMGR-G: STATUS_1 %d on area %d\n", event_num, area_num);
-            
-            if (area_num > 0 && area_num <= MAX_AREAS) {
-                // para_request_area_status(serial_sender, area_num);
-                switch(event_num) {
-                    case 2:
-                        area_set_status(area_num, RS_AREA_STAY_ARMED);
-                        area_update_mqtt_state(area_num);
-                        send_area_report(area_num, mqtt_area_report);
-                    break;
-
-                    case 0:
-                    case 1:
-                    case 3:
-                        area_set_status(area_num, RS_AREA_ARMED);
-                        area_update_mqtt_state(area_num);
-                        send_area_report(area_num, mqtt_area_report);
-                    break;
-
-                    case 4:
-                    case 5:
-                    case 6:
-                    case 7:
-                        area_set_alarm(area_num, RS_AREA_IN_ALARM);
-                        area_update_mqtt_state(area_num);
-                        send_area_report(area_num, mqtt_area_report);
-                    break;
-                }
-            }
-        break;
+    log_verbose("PMGR-G: zone %d on area %d %s\n", line->num, line->area, event_groups[line->group].name);
 
-        case G_STATUS_2:
-            log_verbose("PMGR-G: STATUS_2 %d on area %d\n", event_num, area_num);
-            
-            if (area_num > 0 && area_num <= MAX_AREAS) {
-                // para_request_area_status(serial_sender, area_num);
-                switch(event_num) {
-                    case 1:
-                        if (areas[area_num - 1]->status == RS_AREA_DISARMED) {
-                            area_set_status(area_num, RS_AREA_EXIT_DELAY);
-                            area_update_mqtt_state(area_num);
-                            send_area_report(area_num, mqtt_area_report);
-                        }
-                    case 3:
-                        area_set_trouble(area_num, RS_AREA_TROUBLE);
-                        area_update_mqtt_state(area_num);
-                        send_area_report(area_num, mqtt_area_report);
-                    break;
-
-                    case 4:
-                        area_set_memory(area_num, RS_AREA_ZONE_IN_MEMORY);
-                        area_update_mqtt_state(area_num);
-                        send_area_report(area_num, mqtt_area_report);
-                    break;
-                }
-            }
-        break;
+    zone_set_bypassed(panel, line->num, RS_ZONE_BYPASSED);
+    area_transition(panel, area_num, line->group, line->num);
+    panel->flush_now = 1;
+}
 
-        case G_STATUS_3:
-            log_verbose("PMGR-G: STATUS_3 %d on area %d\n", event_num, area_num);
-        break;
+/*
+ * Restore says nothing of whether the zone is open, so it is asked for.
+ */
+static void event_zone_tamper(para_panel_t *panel, const para_line_t *line)
+{
+    int zone_num = line->num;
 
-        default:
-            log_verbose("PMGR: event group %d/%d/%d not supported yet!\n", event_group, event_num, area_num);
-        break;
+    log_verbose("PMGR-G: zone %d on area %d %s\n", zone_num, line->area, event_groups[line->group].name);
+
+    if (line->group == G_ZONE_TAMPER) {
+        zone_set_status(panel, zone_num, RS_ZONE_TAMPERED);
+    } else if (para_state_zone(&panel->state, zone_num)->status == RS_ZONE_TAMPERED) {
+        zone_set_status(panel, zone_num, RS_ZONE_CLOSED);
+        para_request_zone_status(panel, zone_num);
     }
+
+    zone_update_mqtt_state(panel, zone_num);
+    panel->flush_now = 1;
 }
 
-static void para_process_prt3_response(char *prt3_string, void *mqtt_area_report, void *mqtt_zone_report)
+/*
+ * Troubles are of the whole panel, every area shows them as its trouble.
+ * With the last one gone, the areas are asked: one can still be in a
+ * trouble of its own.
+ */
+static void event_trouble(para_panel_t *panel, const para_line_t *line)
 {
-    switch (prt3_string[0]) {
-        case PRT3_AREA:
-            if (prt3_string[1] == PRT3_LABEL) {
-                int area_num = get_number_at_substring(prt3_string + 2, 3);
+    para_state_t *state = &panel->state;
 
-                if (area_num > 0 && area_num < MAX_AREAS && areas[area_num - 1] != NULL) {
-                    set_label(areas[area_num - 1]->name, prt3_string + 5);
-                    log_debug("PMGR-AL: area label set: [%s]\n", areas[area_num - 1]->name);
-                } else {
-                    log_error("PMGR-AL: ignoring label of area %d\n", area_num);
-                }
-            } else if (prt3_string[1] == PRT3_DISARM) {
-                int area_num = get_number_at_substring(prt3_string + 2, 3);
+    if (line->num >= T_COUNT) {
+        log_verbose("PMGR-G: %s %d not known\n", event_groups[line->group].name, line->num);
+        return;
+    }
+
+    if (line->group == G_TROUBLE_EVENT) {
+        state->troubles |= 1U << line->num;
+    } else {
+        state->troubles &= ~(1U << line->num);
+    }
 
-                if (area_num > 0 && area_num < MAX_AREAS && areas[area_num - 1] != NULL) {
-                    if (prt3_string[6] == 'o' && prt3_string[7] == 'k') {
-                        log_debug("PMGR-AD: area %d disarmed\n", area_num);
+    state->troubles_known = 1;
 
-                        area_set_status(area_num, RS_AREA_DISARMED);
-                        area_update_mqtt_state(area_num);
-                        send_area_report(area_num, mqtt_area_report);
-                    }
-                }
+    log_verbose("PMGR-G: %s %d, troubles now 0x%02x\n", event_groups[line->group].name, line->num, state->troubles);
+
+    for (int a = 0; (a = para_state_next_area(state->areas_monitored, a)); ) {
+        if (state->troubles) {
+            area_set_trouble(panel, a, RS_AREA_TROUBLE);
+        } else {
+            para_request_area_status(panel, a);
+        }
+    }
+
+    panel->flush_now = 1;
+}
+
+static void event_log_only(para_panel_t *panel, const para_line_t *line)
+{
+    log_verbose("PMGR-G: %s %d on area %d\n", event_groups[line->group].name, line->num, line->area);
+}
+
+static void para_process_prt3_response(para_panel_t *panel, const para_line_t *line)
+{
+    int num = line->num;
+
+    switch (line->type) {
+        case PL_AREA_LABEL:
+            if (para_state_has_area(&panel->state, num)) {
+                para_state_area_label(&panel->state, num, line->data, line->data_len);
+                log_debug("PMGR-AL: area label set: [%s]\n", panel->state.area_names[num - 1]);
             } else {
-                log_error("PMGR: area response %c not supported\n", prt3_string[1]);
+                log_error("PMGR-AL: ignoring label of area %d\n", num);
             }
         break;
 
-        case PRT3_REQ_RESP:
-            switch (prt3_string[1]) {
-                case PRT3_AREA: {
-                    int area_num = get_number_at_substring(prt3_string + 2, 3);
-                    
-                    if (area_num > 0 && area_num < MAX_AREAS && areas[area_num - 1] != NULL) {
-                        update_area_record(area_num, prt3_string);
+        case PL_AREA_DISARM:
+            if (para_state_has_area(&panel->state, num)) {
+                if (line->data_len >= 3 && line->data[1] == 'o' && line->data[2] == 'k') {
+                    log_debug("PMGR-AD: area %d disarmed\n", num);
 
-                        log_debug("PMGR-RA: area %d updated\n", area_num);
-
-                        send_area_report(area_num, mqtt_area_report);
-                    } else {
-                        log_error("PMGR: ignoring response of area %d\n", area_num);
-                    }
+                    area_set_status(panel, num, RS_AREA_DISARMED);
+                    area_update_mqtt_state(panel, num);
+                    para_command_echo(panel, line, 1);
                 }
-                break;
+            }
+        break;
 
-                case PRT3_ZONE: {
-                    int zone_num = get_number_at_substring(prt3_string + 2, 3);
-                    
-                    if (zone_num > 0 && zone_num < MAX_ZONES && zones[zone_num - 1] != NULL) {
-                        update_zone_record(zone_num, prt3_string);
+        case PL_AREA_ARM:
+        case PL_AREA_QUICK_ARM:
+            if (para_state_has_area(&panel->state, num) && line->data_len >= 3 && line->data[1] == 'o' && line->data[2] == 'k') {
+                log_debug("PMGR: area %d arming accepted\n", num);
+                para_command_echo(panel, line, 1);
+            }
+        break;
 
-                        log_debug("PMGR-RZ: zone %d updated\n", zone_num);
+        case PL_AREA_STATUS:
+            if (para_state_has_area(&panel->state, num)) {
+                // Only a known area can drift, the first response sets it up.
+                int drifted = bits_test(panel->state.areas_known, num - 1) && area_record_drifted(panel, num, line->str);
 
-                        send_zone_report(zone_num, mqtt_zone_report);
-                        send_area_report(zones[zone_num - 1]->area, mqtt_area_report);
-                    } else {
-                        log_error("PMGR: ignoring response of zone %d\n", zone_num);
-                    }
+                update_area_record(panel, num, line->str);
+                para_poll_confirm(&panel->poll, num, drifted);
+                bits_set(panel->state.areas_known, num - 1);
+                troubles_check_areas(panel);
+
+                if (bits_test(panel->areas_refresh, num - 1)) {
+                    bits_clear(panel->areas_refresh, num - 1);
+                    bits_set(panel->state.areas_dirty, num - 1);
+                    panel->flush_now = 1;
                 }
-                break;
+
+                log_debug("PMGR-RA: area %d updated\n", num);
+
+            } else {
+                log_error("PMGR: ignoring response of area %d\n", num);
             }
         break;
 
-        case PRT3_ZONE:
-            if (prt3_string[1] == PRT3_LABEL) {
-                int zone_num = get_number_at_substring(prt3_string + 2, 3);
+        case PL_ZONE_STATUS:
+            if (para_state_has_zone(&panel->state, num)) {
+                update_zone_record(panel, num, line->str);
+                bits_set(panel->state.zones_known, num - 1);
 
-                if (zone_num > 0 && zone_num < MAX_ZONES && zones[zone_num - 1] != NULL) {
-                    set_label(zones[zone_num - 1]->name, prt3_string + 5);
-                    log_debug("PMGR-ZL: zone label set: [%s]\n", zones[zone_num - 1]->name);
-                } else {
-                    log_error("PMGR: ignoring label of zone %d\n", zone_num);
+                if (bits_test(panel->zones_refresh, num - 1)) {
+                    bits_clear(panel->zones_refresh, num - 1);
+                    bits_set(panel->state.zones_dirty, num - 1);
+                    panel->flush_now = 1;
                 }
+
+                log_debug("PMGR-RZ: zone %d updated\n", num);
+
             } else {
-                log_error("PMGR: area response %c not supported\n", prt3_string[1]);
+                log_error("PMGR: ignoring response of zone %d\n", num);
+            }
+        break;
+
+        case PL_ZONE_LABEL:
+            if (para_state_has_zone(&panel->state, num)) {
+                para_state_zone_label(&panel->state, num, line->data, line->data_len);
+                log_debug("PMGR-ZL: zone label set: [%s]\n", para_state_zone_name(&panel->state, num));
+            } else {
+                log_error("PMGR: ignoring label of zone %d\n", num);
             }
         break;
 
         default:
-            log_error("PMGR: response type not supported: %s\n", prt3_string);
+            log_debug("PMGR: response not processed: %s\n", line->str);
         break;
     }
 }
 
-static void para_process_command(void *mqtt_area_command, void *serial_sender)
+static void para_process_command(para_panel_t *panel, void *mqtt_area_command, void *mqtt_area_report)
 {
     para_arm_cmd_t *cmd = (para_arm_cmd_t*) z_receive(mqtt_area_command);
 
@@ -739,30 +1148,35 @@ static void para_process_command(void *mqtt_area_command, void *serial_sender)
     }
 
     if (cmd->type == CMD_AREA_CONTROL) {
-        if (cmd->num > 0 && cmd->num <= MAX_AREAS && areas[cmd->num - 1] != NULL) {
+        if (para_state_has_area(&panel->state, cmd->num)) {
             switch (cmd->command) {
                 case AC_ARM_AWAY:
+                    para_command_start(panel, cmd->num, cmd->command);
+
                     if (config.user_code == NULL) {
-                        para_area_quick_arm(serial_sender, cmd->num, RS_AREA_ARMED);
+                        para_area_quick_arm(panel, cmd->num, RS_AREA_ARMED);
                     } else {
-                        para_area_arm(serial_sender, cmd->num, RS_AREA_ARMED, config.user_code);
+                        para_area_arm(panel, cmd->num, RS_AREA_ARMED, config.user_code);
                     }
                 break;
 
                 case AC_ARM_HOME:
+                    para_command_start(panel, cmd->num, cmd->command);
                     // !!! For some reason Stay Arm does not work with user code on PRT3!
                     /*if (config.user_code == NULL) { //*/
-                        para_area_quick_arm(serial_sender, cmd->num, RS_AREA_STAY_ARMED);
+                        para_area_quick_arm(panel, cmd->num, RS_AREA_STAY_ARMED);
                     /*} else {
-                        para_area_arm(serial_sender, cmd->num, RS_AREA_STAY_ARMED, config.user_code);
+                        para_area_arm(panel, cmd->num, RS_AREA_STAY_ARMED, config.user_code);
                     } //*/
                 break;
 
                 case AC_DISARM:
                     if (config.user_code != NULL) {
-                        para_area_disarm(serial_sender, cmd->num, config.user_code);
+                        para_command_start(panel, cmd->num, cmd->command);
+                        para_area_disarm(panel, cmd->num, config.user_code);
                     } else {
                         log_info("PMGR: DISARM cannot be performed without user code!\n");
+                        send_command_report(panel, cmd->num, cmd->command, CR_REFUSED, 0, PARA_REPORT_NO_ECHO, mqtt_area_report);
                     }
                 break;
 
@@ -774,267 +1188,280 @@ static void para_process_command(void *mqtt_area_command, void *serial_sender)
             log_error("PMGR: incoming command's area %d is not valid.\n", cmd->num);
         }
     } else if (cmd->type == CMD_UTILITY_KEY && cmd->num > 0 && cmd->num <= MAX_UTILITY_KEY) {
-        para_utility_key(serial_sender, cmd->num);
+        para_utility_key(panel, cmd->num);
+    } else if (cmd->type == CMD_AREA_GET) {
+        para_refresh_area(panel, cmd->num);
+    } else if (cmd->type == CMD_ZONE_GET) {
+        para_refresh_zone(panel, cmd->num);
+    } else if (cmd->type == CMD_DUMP) {
+        para_dump(panel);
+    } else if (cmd->type == CMD_HISTORY) {
+        para_send_history(panel, cmd->num, cmd->count, mqtt_area_report);
     }
 
     free(cmd);
 }
 
-static void update_area_record(int area_num, char *prt3_string)
+/*
+ * Whether the polled status differs from what the events have made of it.
+ */
+static int area_record_drifted(para_panel_t *panel, int area_num, const char *prt3_string)
 {
-    area_set_status(area_num, prt3_string[RA_STATUS]);
-    area_set_memory(area_num, prt3_string[RA_MEMORY]);
-    area_set_trouble(area_num, prt3_string[RA_TROUBLE]);
-    area_set_ready(area_num, prt3_string[RA_READY]);
-    area_set_programming(area_num, prt3_string[RA_PROGRAMMING]);
-    area_set_alarm(area_num, prt3_string[RA_ALARM]);
-    area_set_strobe(area_num, prt3_string[RA_STROBE]);
-    area_update_mqtt_state(area_num);
+    para_area_state_t *area = &panel->state.areas[area_num - 1];
+
+    return area->status != prt3_string[RA_STATUS]
+        || area->memory != prt3_string[RA_MEMORY]
+        || area->trouble != prt3_string[RA_TROUBLE]
+        || area->ready != prt3_string[RA_READY]
+        || area->programming != prt3_string[RA_PROGRAMMING]
+        || area->alarm != prt3_string[RA_ALARM]
+        || area->strobe != prt3_string[RA_STROBE];
 }
 
-static void update_zone_record(int zone_num, char *prt3_string)
+static void update_area_record(para_panel_t *panel, int area_num, const char *prt3_string)
 {
-    zone_set_status(zone_num, prt3_string[RZ_STATUS]);
-    zone_set_alarm(zone_num, prt3_string[RZ_ALARM]);
-    zone_set_fire(zone_num, prt3_string[RZ_FIRE]);
-    zone_set_supervision(zone_num, prt3_string[RZ_SUPERVISION]);
-    zone_set_battery(zone_num, prt3_string[RZ_LOW_BAT]);
-    zone_update_mqtt_state(zone_num);
-    zone_update_area_alarm(zone_num);
+    area_set_status(panel, area_num, prt3_string[RA_STATUS]);
+    area_set_memory(panel, area_num, prt3_string[RA_MEMORY]);
+    area_set_trouble(panel, area_num, prt3_string[RA_TROUBLE]);
+    area_set_ready(panel, area_num, prt3_string[RA_READY]);
+    area_set_programming(panel, area_num, prt3_string[RA_PROGRAMMING]);
+    area_set_alarm(panel, area_num, prt3_string[RA_ALARM]);
+    area_set_strobe(panel, area_num, prt3_string[RA_STROBE]);
+    area_update_mqtt_state(panel, area_num);
 }
 
-static void send_area_report(int area_num, void *mqtt_area_report)
+static void update_zone_record(para_panel_t *panel, int zone_num, const char *prt3_string)
 {
-    para_area_t *area = areas[area_num - 1];
+    zone_set_status(panel, zone_num, prt3_string[RZ_STATUS]);
+    zone_set_alarm(panel, zone_num, prt3_string[RZ_ALARM]);
+    zone_set_fire(panel, zone_num, prt3_string[RZ_FIRE]);
+    zone_set_supervision(panel, zone_num, prt3_string[RZ_SUPERVISION]);
+    zone_set_battery(panel, zone_num, prt3_string[RZ_LOW_BAT]);
+    zone_update_mqtt_state(panel, zone_num);
+    zone_update_area_alarm(panel, zone_num);
+}
 
-    if (area->updated == RECORD_CLEAR) {
-        // Nothing to do
-        return;
+/*
+ * Report whatever has changed since the last time, walking the dirty bits only.
+ */
+static void send_reports(para_panel_t *panel, void *mqtt_area_report, void *mqtt_zone_report)
+{
+    int num;
+
+    while ((num = para_state_pop_dirty_zone(&panel->state))) {
+        send_zone_report(panel, num, mqtt_zone_report);
     }
 
-    log_debug("PMGR: sending area report to MQTT\n");
+    while ((num = para_state_pop_dirty_area(&panel->state))) {
+        send_area_report(panel, num, mqtt_area_report);
+    }
+}
+
+static void send_area_report(para_panel_t *panel, int area_num, void *mqtt_area_report)
+{
+    para_state_t *state = &panel->state;
+    uint8_t report[PARA_REPORT_MAX_LEN];
 
-    // Send to MQTT endpoint
-    zmq_msg_t message;
+    size_t len = para_report_encode(report, PR_AREA, panel->cfg->index, area_num, 0,
+        para_state_take_area_fields(state, area_num),
+        state->areas[area_num - 1].fields, AF_COUNT, state->area_names[area_num - 1]);
 
-    zmq_msg_init_size (&message, sizeof(para_area_t));
-    memcpy(zmq_msg_data(&message), area, sizeof(para_area_t));
-    zmq_msg_send (&message, mqtt_area_report, 0);
-    zmq_msg_close (&message);
+    log_debug("PMGR: sending area report to MQTT\n");
 
-    // Clear the record
-    area->updated = RECORD_CLEAR;
-    area->firstreport = 0;
+    zmq_send(mqtt_area_report, report, len, 0);
 }
 
-static void send_zone_report(int zone_num, void *mqtt_zone_report)
+/*
+ * Tell MQTT which areas are fully known, whenever that changes.
+ */
+static void send_ready_report(para_panel_t *panel, void *mqtt_area_report)
 {
-    para_zone_t *zone = zones[zone_num - 1];
+    unsigned ready = para_state_ready_areas(&panel->state);
 
-    if (zone->updated == RECORD_CLEAR) {
-        // Nothing to do
+    if (ready == panel->ready_sent) {
         return;
     }
 
-    // TODO: send to MQTT endpoint
-    zmq_msg_t message;
+    uint8_t report[PARA_REPORT_MAX_LEN];
+    size_t len = para_report_encode_ready(report, panel->cfg->index, para_state_areas_mask(&panel->state), ready);
 
-    zmq_msg_init_size (&message, sizeof(para_zone_t));
-    memcpy(zmq_msg_data(&message), zone, sizeof(para_zone_t));
-    zmq_msg_send (&message, mqtt_zone_report, 0);
-    zmq_msg_close (&message);
-    
-    // Clear the record
-    zone->updated = RECORD_CLEAR;
+    zmq_send(mqtt_area_report, report, len, 0);
+    panel->ready_sent = ready;
 }
 
-static int get_number_at_substring(char *str, size_t length)
+static void send_command_report(para_panel_t *panel, int area_num, para_arm_cmd_e_t command, para_cmd_result_t result,
+    unsigned latency, unsigned echo, void *mqtt_area_report)
 {
-    char *buff = malloc(length + 1);
+    static const char *results[] = { "ok", "failed", "timed out", "refused" };
+    uint8_t report[PARA_REPORT_MAX_LEN];
+
+    log_info("PMGR: command %d on area %d %s in %u ms\n", command, area_num, results[result], latency);
 
-    strncpy(buff, str, length);
-    buff[length] = 0;
-    int ret = strtol(buff, NULL, 10);
+    size_t len = para_report_encode_command(report, panel->cfg->index, area_num, command, result, latency, echo);
 
-    free(buff);
-    return ret;
+    zmq_send(mqtt_area_report, report, len, 0);
 }
 
-static void set_label(char *dst, const char *src) {
-    strncpy(dst, src, LABEL_LENGTH);
-    dst[LABEL_LENGTH] = 0;
+/*
+ * Tell MQTT the system troubles, once they are known and whenever they change.
+ */
+static void send_trouble_report(para_panel_t *panel, void *mqtt_area_report)
+{
+    if (!panel->state.troubles_known || panel->state.troubles == panel->troubles_sent) {
+        return;
+    }
 
-    int end = LABEL_LENGTH - 1;
+    uint8_t report[PARA_REPORT_MAX_LEN];
+    size_t len = para_report_encode_trouble(report, panel->cfg->index, panel->state.troubles);
 
-    while (dst[end] == PARA_SERIAL_SPACE || dst[end] == 0) {
-        dst[end--] = 0;
-    }
+    zmq_send(mqtt_area_report, report, len, 0);
+    panel->troubles_sent = panel->state.troubles;
 }
 
-static void area_set_status(int area_num, char status) {
-    para_area_t *area = areas[area_num - 1];
+static void send_zone_report(para_panel_t *panel, int zone_num, void *mqtt_zone_report)
+{
+    para_state_t *state = &panel->state;
+    uint8_t report[PARA_REPORT_MAX_LEN];
 
-    if (area->status != status) {
-        area->status = status;
-        area->updated = RECORD_UPDATED;
-    }
+    para_zone_state_t *zone = para_state_zone(state, zone_num);
+
+    size_t len = para_report_encode(report, PR_ZONE, panel->cfg->index, zone_num, zone->area,
+        para_state_take_zone_fields(state, zone_num),
+        zone->fields, ZF_COUNT, para_state_zone_name(state, zone_num));
+
+    zmq_send(mqtt_zone_report, report, len, 0);
 }
 
-static void area_set_memory(int area_num, char memory)
+static void area_set_status(para_panel_t *panel, int area_num, char status)
 {
-    para_area_t *area = areas[area_num - 1];
-    
-    if (area->memory != memory) {
-        area->memory = memory;
-        area->updated = RECORD_UPDATED;
-    }
+    para_state_area_set(&panel->state, area_num, AF_STATUS, status);
 }
 
-static void area_set_trouble(int area_num, char trouble)
+static void area_set_memory(para_panel_t *panel, int area_num, char memory)
 {
-    para_area_t *area = areas[area_num - 1];
-    
-    if (area->trouble != trouble) {
-        area->trouble = trouble;
-        area->updated = RECORD_UPDATED;
-    }
+    para_state_area_set(&panel->state, area_num, AF_MEMORY, memory);
 }
 
-static void area_set_ready(int area_num, char ready)
+static void area_set_trouble(para_panel_t *panel, int area_num, char trouble)
 {
-    para_area_t *area = areas[area_num - 1];
-    
-    if (area->ready != ready) {
-        area->ready = ready;
-        area->updated = RECORD_UPDATED;
-    }
+    para_state_area_set(&panel->state, area_num, AF_TROUBLE, trouble);
 }
 
-static void area_set_programming(int area_num, char programming)
+static void area_set_ready(para_panel_t *panel, int area_num, char ready)
 {
-    para_area_t *area = areas[area_num - 1];
-    
-    if (area->programming != programming) {
-        area->programming = programming;
-        area->updated = RECORD_UPDATED;
-    }
+    para_state_area_set(&panel->state, area_num, AF_READY, ready);
 }
 
-static void area_set_alarm(int area_num, char alarm)
+static void area_set_programming(para_panel_t *panel, int area_num, char programming)
 {
-    para_area_t *area = areas[area_num - 1];
-    
-    if (area->alarm != alarm) {
-        area->alarm = alarm;
-        area->updated = RECORD_UPDATED;
-    }
+    para_state_area_set(&panel->state, area_num, AF_PROGRAMMING, programming);
 }
 
-static void area_set_strobe(int area_num, char strobe)
+static void area_set_alarm(para_panel_t *panel, int area_num, char alarm)
 {
-    para_area_t *area = areas[area_num - 1];
-    
-    if (area->strobe != strobe) {
-        area->strobe = strobe;
-        area->updated = RECORD_UPDATED;
+    if (para_state_area_set(&panel->state, area_num, AF_ALARM, alarm)) {
+        panel->flush_now = 1;
     }
 }
 
-static void area_update_mqtt_state(int area_num)
+static void area_set_strobe(para_panel_t *panel, int area_num, char strobe)
 {
-    para_area_t *area = areas[area_num - 1];
-
-    if (area->alarm != RS_AREA_IN_ALARM) {
-        switch (area->status) {
-            case RS_AREA_DISARMED:
-                area->mqtt_state = MQP_DISARMED;
-            break;
+    para_state_area_set(&panel->state, area_num, AF_STROBE, strobe);
+}
 
-            case RS_AREA_STAY_ARMED:
-                // TODO: check bypassed zones to set to MQP_ARMED_CUSTOM_BYPASS
-                area->mqtt_state = MQP_ARMED_HOME;
-            break;
-            
-            case RS_AREA_ARMED:
-            case RS_AREA_FORCE_ARMED:
-            case RS_AREA_INSTANT_ARMED:
-                // TODO: check bypassed zones to set to MQP_ARMED_CUSTOM_BYPASS
-                area->mqtt_state = MQP_ARMED_AWAY;
-            break;
+/*
+ * Set the MQTT state from the area record, as polled from the panel.
+ * An area awaiting a command keeps its arming/disarming state.
+ */
+static void area_update_mqtt_state(para_panel_t *panel, int area_num)
+{
+    para_area_state_t *area = &panel->state.areas[area_num - 1];
 
-            case RS_AREA_EXIT_DELAY:
-                area->mqtt_state = MQP_ARMING;
-            break;
-        }
-    } else {
-        // Alarm!
-        area->mqtt_state = MQP_TRIGGERED;
+    if (panel->commands[area_num - 1].active) {
+        return; // Stays arming/disarming until the command ends
     }
+
+    int bypassed = para_state_area_count(&panel->state, area_num, ZB_BYPASSED);
+
+    para_state_area_set(&panel->state, area_num, AF_MQTT_STATE, para_area_derive(area, bypassed));
 }
 
-static void zone_set_status(int zone_num, char status)
+/*
+ * Move the area by its transition table row for the event. Like
+ * area_update_mqtt_state(), it leaves the MQTT state of an awaited command.
+ */
+static void area_transition(para_panel_t *panel, int area_num, int group, int num)
 {
-    para_zone_t *zone = zones[zone_num - 1];
+    int hold = panel->commands[area_num - 1].active;
+    const para_area_transition_t *t = para_area_apply(&panel->state, area_num, group, num, hold);
+
+    if (!t) {
+        log_debug("PMGR-G: area %d stays %d on event %d/%d\n",
+            area_num, panel->state.areas[area_num - 1].mqtt_state, group, num);
+        return;
+    }
 
-    if (zone->status != status) {
-        zone->status = status;
-        zone->updated = RECORD_UPDATED;
+    if (t->effects & AT_FLUSH) {
+        panel->flush_now = 1;
     }
 }
 
-static void zone_set_alarm(int zone_num, char alarm)
+/*
+ * No area showing trouble means no system trouble either. An area in trouble
+ * does not tell which one it is, that is left to the trouble events.
+ */
+static void troubles_check_areas(para_panel_t *panel)
 {
-    para_zone_t *zone = zones[zone_num - 1];
+    para_state_t *state = &panel->state;
 
-    if (zone->alarm != alarm) {
-        zone->alarm = alarm;
-        zone->updated = RECORD_UPDATED;
+    for (int a = 0; (a = para_state_next_area(state->areas_monitored, a)); ) {
+        if (!bits_test(state->areas_known, a - 1) || state->areas[a - 1].trouble != RS_OK) {
+            return;
+        }
     }
+
+    state->troubles = 0;
+    state->troubles_known = 1;
 }
 
-static void zone_set_fire(int zone_num, char fire)
+static void zone_set_status(para_panel_t *panel, int zone_num, char status)
 {
-    para_zone_t *zone = zones[zone_num - 1];
+    para_state_zone_set(&panel->state, zone_num, ZF_STATUS, status);
+}
 
-    if (zone->fire != fire) {
-        zone->fire = fire;
-        zone->updated = RECORD_UPDATED;
+static void zone_set_alarm(para_panel_t *panel, int zone_num, char alarm)
+{
+    if (para_state_zone_set(&panel->state, zone_num, ZF_ALARM, alarm)) {
+        panel->flush_now = 1;
     }
 }
 
-static void zone_set_supervision(int zone_num, char supervision)
+static void zone_set_fire(para_panel_t *panel, int zone_num, char fire)
 {
-    para_zone_t *zone = zones[zone_num - 1];
-
-    if (zone->supervision != supervision) {
-        zone->supervision = supervision;
-        zone->updated = RECORD_UPDATED;
+    if (para_state_zone_set(&panel->state, zone_num, ZF_FIRE, fire)) {
+        panel->flush_now = 1;
     }
 }
 
-static void zone_set_battery(int zone_num, char battery)
+static void zone_set_supervision(para_panel_t *panel, int zone_num, char supervision)
 {
-    para_zone_t *zone = zones[zone_num - 1];
-
-    if (zone->battery != battery) {
-        zone->battery = battery;
-        zone->updated = RECORD_UPDATED;
-    }
+    para_state_zone_set(&panel->state, zone_num, ZF_SUPERVISION, supervision);
 }
 
-static void zone_set_bypassed(int zone_num, char bypassed)
+static void zone_set_battery(para_panel_t *panel, int zone_num, char battery)
 {
-    para_zone_t *zone = zones[zone_num - 1];
+    para_state_zone_set(&panel->state, zone_num, ZF_BATTERY, battery);
+}
 
-    if (zone->bypassed != bypassed) {
-        zone->bypassed = bypassed;
-        zone->updated = RECORD_UPDATED;
-    }
+static void zone_set_bypassed(para_panel_t *panel, int zone_num, char bypassed)
+{
+    para_state_zone_set(&panel->state, zone_num, ZF_BYPASSED, bypassed);
 }
 
-static void zone_update_mqtt_state(int zone_num)
+static void zone_update_mqtt_state(para_panel_t *panel, int zone_num)
 {
-    para_zone_t *zone = zones[zone_num - 1];
+    para_zone_state_t *zone = para_state_zone(&panel->state, zone_num);
+    mqtt_zone_state_t mqtt_state;
 
     if (
         zone->status == RS_ZONE_CLOSED
@@ -1042,19 +1469,21 @@ static void zone_update_mqtt_state(int zone_num)
         && zone->fire == RS_OK
         )
     {
-        zone->mqtt_state = MQZ_OFF;
+        mqtt_state = MQZ_OFF;
     } else {
-        zone->mqtt_state = MQZ_ON;
+        mqtt_state = MQZ_ON;
     }
+
+    para_state_zone_set(&panel->state, zone_num, ZF_MQTT_STATE, mqtt_state);
 }
 
-static void zone_update_area_alarm(int zone_num)
+static void zone_update_area_alarm(para_panel_t *panel, int zone_num)
 {
-    para_zone_t *zone = zones[zone_num - 1];
+    para_zone_state_t *zone = para_state_zone(&panel->state, zone_num);
 
-    if (zone->alarm == RS_ZONE_IN_ALARM && areas[zone->area - 1]->alarm == RS_OK) {
+    if (zone->alarm == RS_ZONE_IN_ALARM && panel->state.areas[zone->area - 1].alarm == RS_OK) {
         // Update area to alarm, as zone is in alarm
-        areas[zone->area - 1]->alarm = RS_AREA_IN_ALARM;
-        areas[zone->area - 1]->updated = RECORD_UPDATED;
+        area_set_alarm(panel, zone->area, RS_AREA_IN_ALARM);
+        area_update_mqtt_state(panel, zone->area);
     }
 }
@@ -0,0 +1,127 @@
+/*
+ * The source of the MQTT daemon interacting with Paradox EVO control panel
+ * via their's PRT3 module.
+ *
+ * para_parse.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Darau, blė
+ *
+ *  This file is a part of personal use utilities developed to be used
+ *  on various Linux devices.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+#include "para_parse.h"
+#include "paratypes.h"
+
+#define PL_PREFIX_LEN (2 + PARA_NUM_LEN)
+#define PL_EVENT_LEN 12
+#define PL_AREA_STATUS_LEN (RA_STROBE + 1)
+#define PL_ZONE_STATUS_LEN (RZ_LOW_BAT + 1)
+
+static int decode_number(const char *str);
+
+/*
+ * Split a PRT3 line (without EOL) in one pass. Numbers are decoded and
+ * validated, as well as the length of the known line types.
+ * Returns 0 on success, -1 if the line is malformed.
+ */
+int para_parse_line(const char *str, size_t len, para_line_t *line)
+{
+    if (len < PL_PREFIX_LEN) {
+        return -1;
+    }
+
+    line->str = str;
+
+    if (str[0] == PRT3_EVENT) {
+        if (len < PL_EVENT_LEN || str[4] != 'N' || str[8] != 'A') {
+            return -1;
+        }
+
+        line->type = PL_EVENT;
+        line->group = decode_number(str + 1);
+        line->num = decode_number(str + 5);
+        line->area = decode_number(str + 9);
+        line->data = str + PL_EVENT_LEN;
+        line->data_len = len - PL_EVENT_LEN;
+
+        return (line->group | line->num | line->area) < 0 ? -1 : 0;
+    }
+
+    size_t least = PL_PREFIX_LEN;
+
+    line->group = 0;
+    line->area = 0;
+    line->num = decode_number(str + 2);
+    line->data = str + PL_PREFIX_LEN;
+    line->data_len = len - PL_PREFIX_LEN;
+
+    if (line->num < 0) {
+        return -1;
+    }
+
+    // Two letters in one switch
+    switch (str[0] << 8 | str[1]) {
+        case PRT3_REQ_RESP << 8 | PRT3_AREA:
+            line->type = PL_AREA_STATUS;
+            least = PL_AREA_STATUS_LEN;
+        break;
+
+        case PRT3_REQ_RESP << 8 | PRT3_ZONE:
+            line->type = PL_ZONE_STATUS;
+            least = PL_ZONE_STATUS_LEN;
+        break;
+
+        case PRT3_AREA << 8 | PRT3_LABEL:
+            line->type = PL_AREA_LABEL;
+        break;
+
+        case PRT3_ZONE << 8 | PRT3_LABEL:
+            line->type = PL_ZONE_LABEL;
+        break;
+
+        case PRT3_AREA << 8 | PRT3_DISARM:
+            line->type = PL_AREA_DISARM;
+        break;
+
+        case PRT3_AREA << 8 | PRT3_AREA:
+            line->type = PL_AREA_ARM;
+        break;
+
+        case PRT3_AREA << 8 | PRT3_QUICK:
+            line->type = PL_AREA_QUICK_ARM;
+        break;
+
+        default:
+            line->type = PL_OTHER;
+        break;
+    }
+
+    return len < least ? -1 : 0;
+}
+
+/*
+ * Fixed width, so no strtol: -1 if any of the characters is not a digit.
+ */
+static int decode_number(const char *str)
+{
+    unsigned d0 = (unsigned char) str[0] - '0';
+    unsigned d1 = (unsigned char) str[1] - '0';
+    unsigned d2 = (unsigned char) str[2] - '0';
+
+    if (d0 > 9 || d1 > 9 || d2 > 9) {
+        return -1;
+    }
+
+    return d0 * 100 + d1 * 10 + d2;
+}
@@ -0,0 +1,123 @@
+/*
+ * The source of the MQTT daemon interacting with Paradox EVO control panel
+ * via their's PRT3 module.
+ *
+ * para_poll.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Darau, blė
+ *
+ *  This file is a part of personal use utilities developed to be used
+ *  on various Linux devices.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+#include <string.h>
+
+#include "log.h"
+#include "para_poll.h"
+#include "para_state.h"
+#include "time_helpers.h"
+
+/*
+ * All areas start relaxed, the first due time is a full period away:
+ * the initial request confirms them anyway.
+ */
+void para_poll_init(para_poll_t *poll, const uint64_t *areas, int period_ms)
+{
+    long long now = t_now_ms();
+
+    memset(poll, 0, sizeof(para_poll_t));
+
+    poll->max_period = period_ms;
+    poll->min_period = period_ms / PARA_POLL_TIGHTEN;
+
+    if (poll->min_period < PARA_POLL_MIN_PERIOD) {
+        poll->min_period = period_ms < PARA_POLL_MIN_PERIOD ? period_ms : PARA_POLL_MIN_PERIOD;
+    }
+
+    for (int a = 0; (a = para_state_next_area(areas, a)); ) {
+        poll->period[a - 1] = period_ms;
+        poll->deadline[a - 1] = now + period_ms;
+    }
+}
+
+/*
+ * A RA response has arrived. Drifted means it did not match the state
+ * the events had built, so the area is watched closer for a while.
+ */
+void para_poll_confirm(para_poll_t *poll, int area_num, int drifted)
+{
+    int aidx = area_num - 1;
+    int period = poll->period[aidx];
+
+    if (drifted) {
+        period /= 2;
+
+        if (period < poll->min_period) {
+            period = poll->min_period;
+        }
+    } else if (period < poll->max_period) {
+        period += period / 2;
+
+        if (period > poll->max_period) {
+            period = poll->max_period;
+        }
+    }
+
+    if (period != poll->period[aidx]) {
+        log_debug("POLL: area %d polled every %d s\n", area_num, period / 1000);
+    }
+
+    poll->period[aidx] = period;
+    poll->deadline[aidx] = t_now_ms() + period;
+}
+
+/*
+ * Returns the next area after the given one, which is due for a status
+ * request, 0 if none. Its deadline is moved a period ahead, so an area,
+ * whose request fails or is held, is not asked for again on every call.
+ */
+int para_poll_next_due(para_poll_t *poll, const uint64_t *areas, int after)
+{
+    long long now = t_now_ms();
+
+    for (int a = after; (a = para_state_next_area(areas, a)); ) {
+        if (poll->deadline[a - 1] <= now) {
+            poll->deadline[a - 1] = now + poll->period[a - 1];
+            return a;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Milliseconds until the earliest deadline, -1 if no area is polled.
+ */
+int para_poll_next_timeout(const para_poll_t *poll, const uint64_t *areas)
+{
+    long long deadline = -1;
+
+    for (int a = 0; (a = para_state_next_area(areas, a)); ) {
+        if (deadline < 0 || poll->deadline[a - 1] < deadline) {
+            deadline = poll->deadline[a - 1];
+        }
+    }
+
+    if (deadline < 0) {
+        return -1;
+    }
+
+    long long left = deadline - t_now_ms();
+
+    return left > 0 ? (int) left : 0;
+}
@@ -0,0 +1,201 @@
+/*
+ * The source of the MQTT daemon interacting with Paradox EVO control panel
+ * via their's PRT3 module.
+ *
+ * para_replay.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Darau, blė
+ *
+ *  This file is a part of personal use utilities developed to be used
+ *  on various Linux devices.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "endpoints.h"
+#include "log.h"
+#include "para_capture.h"
+#include "para_replay.h"
+#include "para_serial.h"
+#include "time_helpers.h"
+#include "zmq_helpers.h"
+
+#define REPLAY_BATCH 256 // Lines sent between polls when replaying as fast as possible
+
+typedef struct {
+    para_panel_config_t *cfg;
+    void *context;
+    double speed;
+    para_capture_t capture;
+} para_replay_t;
+
+static para_replay_t replays[MAX_PANELS];
+
+static void *replay_thread(void *arg);
+
+/*
+ * Replay a capture in place of the serial thread: lines read from the panel
+ * are pushed to the manager at the recorded pace divided by speed (0 - as
+ * fast as possible). Requests to the panel are dropped.
+ */
+pthread_t start_para_replay(para_panel_config_t *panel, double speed, void *context)
+{
+    para_replay_t *replay = &replays[panel->index];
+
+    if (cap_open_replay(&replay->capture, panel->replay_file) != 0) {
+        return (pthread_t) NULL;
+    }
+
+    replay->cfg = panel;
+    replay->context = context;
+    replay->speed = speed;
+
+    pthread_t thread;
+
+    pthread_create(&thread, NULL, replay_thread, replay);
+
+    return thread;
+}
+
+static void *replay_thread(void *arg)
+{
+    __label__ EXIT_REPLAY_THREAD;
+
+    para_replay_t *replay = (para_replay_t*) arg;
+    void *context = replay->context;
+    char *replay_path = replay->cfg->replay_file;
+    double replay_speed = replay->speed;
+    char endpoint[EPT_NAME_LEN];
+
+    log_info("REPLAY: starting thread...\n");
+
+    void *command_receiver = NULL;
+    void *kill_subscriber = NULL;
+    void *serial_publisher = NULL;
+    int rc;
+
+    if ((rc = z_start_endpoint(context, &command_receiver, ZMQ_PULL, z_panel_endpoint(endpoint, EPT_SERIAL_WRITE, replay->cfg->index))) != 0) {
+        log_error("REPLAY: cannot start command receiver: %d, exiting.\n", rc);
+        goto EXIT_REPLAY_THREAD;
+    }
+
+    // Lamely give time for ZMQ PUB somewhere to initialize.
+    sleep(1);
+
+    if ((rc = z_connect_endpoint(context, &serial_publisher, ZMQ_PUSH, z_panel_endpoint(endpoint, EPT_SERIAL_READ, replay->cfg->index))) != 0) {
+        log_error("REPLAY: cannot start serial publisher: %d, exiting.\n", rc);
+        goto EXIT_REPLAY_THREAD;
+    }
+
+    if ((rc = z_connect_endpoint(context, &kill_subscriber, ZMQ_SUB, EPT_KILL)) != 0) {
+        log_error("REPLAY: cannot subscribe to kill endpoint: %d, exiting.\n", rc);
+        goto EXIT_REPLAY_THREAD;
+    }
+
+    zmq_setsockopt(kill_subscriber, ZMQ_SUBSCRIBE, "", 0);
+
+    zmq_pollitem_t items[] = {
+        { kill_subscriber, 0, ZMQ_POLLIN, 0 },
+        { command_receiver, 0, ZMQ_POLLIN, 0 },
+    };
+
+    char line[CAP_MAX_LINE];
+    size_t len = 0;
+    cap_direction_t dir = CAP_FROM_PANEL;
+    long long delta_us = 0;
+    long long capture_us = 0; // Position in the capture's time line
+    long long lines = 0;
+    int have_record = cap_read(&replay->capture, &delta_us, &dir, line, &len) == 1;
+    long long start_us = t_now_us();
+
+    if (replay_speed > 0) {
+        log_info("REPLAY: replaying %s at %.1fx\n", replay_path, replay_speed);
+    } else {
+        log_info("REPLAY: replaying %s as fast as possible\n", replay_path);
+    }
+
+    while (1) {
+        long timeout = -1;
+
+        if (have_record) {
+            long long due_us = replay_speed > 0 ? start_us + (capture_us + delta_us) / replay_speed : 0;
+            long long left_us = due_us - t_now_us();
+            timeout = left_us > 0 ? left_us / 1000 : 0;
+        }
+
+        zmq_poll(items, 2, timeout);
+
+        if (items[0].revents & ZMQ_POLLIN) {
+            z_drop_message(kill_subscriber);
+            log_info("REPLAY: received KILL, exitting\n");
+            break;
+        } else if (items[1].revents & ZMQ_POLLIN) {
+            char request[PARA_SERIAL_INPUT_LEN];
+            int size = zmq_recv(command_receiver, request, PARA_SERIAL_INPUT_LEN, 0);
+
+            if (size < 0) {
+                log_error("REPLAY: cannot receive request: %d\n", size);
+            } else {
+                log_debug("REPLAY: dropping request [%.*s]\n", size < PARA_SERIAL_INPUT_LEN ? size : PARA_SERIAL_INPUT_LEN, request);
+            }
+        }
+
+        for (int batch = 0; have_record && batch < REPLAY_BATCH; batch++) {
+            if (replay_speed > 0 && start_us + (capture_us + delta_us) / replay_speed > t_now_us()) {
+                break;
+            }
+
+            capture_us += delta_us;
+
+            if (dir == CAP_FROM_PANEL) {
+                log_verbose("REPLAY: [%.*s]\n", (int) len, line);
+                zmq_send(serial_publisher, line, len, 0);
+                lines++;
+            }
+
+            rc = cap_read(&replay->capture, &delta_us, &dir, line, &len);
+            have_record = rc == 1;
+
+            if (!have_record) {
+                long long took_us = t_now_us() - start_us;
+
+                if (rc < 0) {
+                    log_error("REPLAY: broken record in %s, stopping\n", replay_path);
+                }
+
+                log_info("REPLAY: done, %lld lines of %.1f s capture in %.3f s (%.0f lines/s)\n",
+                    lines, capture_us / 1e6, took_us / 1e6, took_us > 0 ? lines * 1e6 / took_us : 0.0);
+            }
+        }
+    }
+
+EXIT_REPLAY_THREAD:
+    if (command_receiver) {
+        zmq_close(command_receiver);
+    }
+
+    if (serial_publisher) {
+        zmq_close(serial_publisher);
+    }
+
+    if (kill_subscriber) {
+        zmq_close(kill_subscriber);
+    }
+
+    cap_close(&replay->capture);
+
+    return NULL;
+}
@@ -0,0 +1,300 @@
+/*
+ * The source of the MQTT daemon interacting with Paradox EVO control panel
+ * via their's PRT3 module.
+ *
+ * para_report.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Darau, blė
+ *
+ *  This file is a part of personal use utilities developed to be used
+ *  on various Linux devices.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+#include <string.h>
+
+#include "para_report.h"
+
+/*
+ * Encode changed fields (and the label) into buf of PARA_REPORT_MAX_LEN bytes.
+ * Returns the length of the message.
+ */
+size_t para_report_encode(uint8_t *buf, para_report_kind_t kind, int panel, int num, int area,
+    unsigned mask, const char *fields, int field_count, const char *label)
+{
+    size_t pos = PARA_REPORT_HEADER_LEN;
+
+    mask &= ((1U << field_count) - 1) | FIELD_LABEL_BIT;
+
+    buf[0] = PARA_REPORT_VERSION;
+    buf[1] = kind;
+    buf[2] = panel;
+    buf[3] = num;
+    buf[4] = area;
+    buf[5] = mask & 0xFF;
+    buf[6] = mask >> 8;
+
+    for (int f = 0; f < field_count; f++) {
+        if (mask & (1U << f)) {
+            buf[pos++] = fields[f];
+        }
+    }
+
+    if (mask & FIELD_LABEL_BIT) {
+        size_t len = 0;
+
+        while (len < LABEL_LENGTH - 1 && label[len]) {
+            len++;
+        }
+
+        buf[pos++] = len;
+        memcpy(buf + pos, label, len);
+        pos += len;
+    }
+
+    return pos;
+}
+
+size_t para_report_encode_ready(uint8_t *buf, int panel, unsigned areas, unsigned ready)
+{
+    buf[0] = PARA_REPORT_VERSION;
+    buf[1] = PR_READY;
+    buf[2] = panel;
+    buf[3] = 0;
+    buf[4] = 0;
+    buf[5] = areas & 0xFF;
+    buf[6] = areas >> 8;
+    buf[7] = ready & 0xFF;
+    buf[8] = ready >> 8;
+
+    return PARA_REPORT_HEADER_LEN + 2;
+}
+
+size_t para_report_encode_trouble(uint8_t *buf, int panel, unsigned troubles)
+{
+    buf[0] = PARA_REPORT_VERSION;
+    buf[1] = PR_TROUBLE;
+    buf[2] = panel;
+    buf[3] = 0;
+    buf[4] = 0;
+    buf[5] = troubles & 0xFF;
+    buf[6] = troubles >> 8;
+
+    return PARA_REPORT_HEADER_LEN;
+}
+
+static void put_u32(uint8_t *pos, uint32_t value)
+{
+    pos[0] = value & 0xFF;
+    pos[1] = (value >> 8) & 0xFF;
+    pos[2] = (value >> 16) & 0xFF;
+    pos[3] = value >> 24;
+}
+
+static uint32_t get_u32(const uint8_t *pos)
+{
+    return pos[0] | (pos[1] << 8) | (pos[2] << 16) | ((uint32_t) pos[3] << 24);
+}
+
+/*
+ * buf must fit PARA_REPORT_MAX_LEN.
+ */
+size_t para_report_encode_command(uint8_t *buf, int panel, int area, int command, int result,
+    unsigned latency, unsigned echo)
+{
+    uint8_t *pos = buf + PARA_REPORT_HEADER_LEN;
+
+    buf[0] = PARA_REPORT_VERSION;
+    buf[1] = PR_COMMAND;
+    buf[2] = panel;
+    buf[3] = area;
+    buf[4] = 0;
+    buf[5] = 0;
+    buf[6] = 0;
+
+    pos[0] = command;
+    pos[1] = result;
+    put_u32(pos + 2, latency);
+    put_u32(pos + 6, echo);
+
+    return PARA_REPORT_HEADER_LEN + PARA_REPORT_COMMAND_LEN;
+}
+
+void para_report_command(const para_report_t *report, int *command, int *result,
+    unsigned *latency, unsigned *echo)
+{
+    const uint8_t *pos = (const uint8_t*) report->values;
+
+    *command = pos[0];
+    *result = pos[1];
+    *latency = get_u32(pos + 2);
+    *echo = get_u32(pos + 6);
+}
+
+/*
+ * buf must fit PARA_REPORT_HISTORY_LEN(count).
+ */
+size_t para_report_encode_history(uint8_t *buf, int panel, int area,
+    const para_history_entry_t *events, int count, long long now)
+{
+    uint8_t *pos = buf + PARA_REPORT_HEADER_LEN;
+
+    buf[0] = PARA_REPORT_VERSION;
+    buf[1] = PR_HISTORY;
+    buf[2] = panel;
+    buf[3] = area;
+    buf[4] = 0;
+    buf[5] = count & 0xFF;
+    buf[6] = count >> 8;
+
+    for (int i = 0; i < count; i++, pos += PARA_REPORT_EVENT_LEN) {
+        long long age = now - events[i].time;
+        uint32_t age_ms = age > UINT32_MAX ? UINT32_MAX : (uint32_t) age;
+
+        put_u32(pos, age_ms);
+        pos[4] = events[i].group;
+        pos[5] = events[i].num & 0xFF;
+        pos[6] = events[i].num >> 8;
+        pos[7] = events[i].area;
+        pos[8] = events[i].status;
+        pos[9] = events[i].mqtt_state;
+    }
+
+    return PARA_REPORT_HISTORY_LEN(count);
+}
+
+/*
+ * Take the idx-th event of a decoded PR_HISTORY report, time is left 0.
+ */
+void para_report_event(const para_report_t *report, int idx, para_history_entry_t *event, unsigned *age)
+{
+    const uint8_t *pos = (const uint8_t*) report->values + idx * PARA_REPORT_EVENT_LEN;
+
+    *age = get_u32(pos);
+    event->time = 0;
+    event->group = pos[4];
+    event->num = pos[5] | (pos[6] << 8);
+    event->area = pos[7];
+    event->status = pos[8];
+    event->mqtt_state = pos[9];
+}
+
+/*
+ * Check the message and point the report into it, nothing is copied.
+ * Returns 0 on success, -1 if the message is not a valid report.
+ */
+int para_report_decode(const uint8_t *buf, size_t len, para_report_t *report)
+{
+    if (len < PARA_REPORT_HEADER_LEN || buf[0] != PARA_REPORT_VERSION || buf[1] > PR_COMMAND) {
+        return -1;
+    }
+
+    if (buf[1] == PR_HISTORY) {
+        report->kind = PR_HISTORY;
+        report->panel = buf[2];
+        report->num = buf[3];
+        report->area = 0;
+        report->mask = 0;
+        report->values = (const char*) buf + PARA_REPORT_HEADER_LEN;
+        report->label = NULL;
+        report->label_len = 0;
+        report->ready = 0;
+        report->events = buf[5] | (buf[6] << 8);
+
+        return len == PARA_REPORT_HISTORY_LEN(report->events) ? 0 : -1;
+    }
+
+    if (buf[1] == PR_COMMAND) {
+        report->kind = PR_COMMAND;
+        report->panel = buf[2];
+        report->num = buf[3];
+        report->area = 0;
+        report->mask = 0;
+        report->values = (const char*) buf + PARA_REPORT_HEADER_LEN;
+        report->label = NULL;
+        report->label_len = 0;
+        report->ready = 0;
+        report->events = 0;
+
+        return len == PARA_REPORT_HEADER_LEN + PARA_REPORT_COMMAND_LEN ? 0 : -1;
+    }
+
+    if (buf[1] == PR_READY || buf[1] == PR_TROUBLE) {
+        if (len != PARA_REPORT_HEADER_LEN + (buf[1] == PR_READY ? 2 : 0)) {
+            return -1;
+        }
+
+        report->kind = buf[1];
+        report->panel = buf[2];
+        report->num = 0;
+        report->area = 0;
+        report->mask = buf[5] | (buf[6] << 8);
+        report->values = NULL;
+        report->label = NULL;
+        report->label_len = 0;
+        report->ready = buf[1] == PR_READY ? buf[7] | (buf[8] << 8) : 0;
+        report->events = 0;
+
+        return 0;
+    }
+
+    unsigned mask = buf[5] | (buf[6] << 8);
+    unsigned field_count = buf[1] == PR_AREA ? AF_COUNT : ZF_COUNT;
+
+    if (mask & ~(((1U << field_count) - 1) | FIELD_LABEL_BIT)) {
+        return -1;
+    }
+
+    report->kind = buf[1];
+    report->panel = buf[2];
+    report->num = buf[3];
+    report->area = buf[4];
+    report->mask = mask;
+    report->values = (const char*) buf + PARA_REPORT_HEADER_LEN;
+    report->label = NULL;
+    report->label_len = 0;
+    report->ready = 0;
+    report->events = 0;
+
+    size_t pos = PARA_REPORT_HEADER_LEN + __builtin_popcount(report->mask & ~FIELD_LABEL_BIT);
+
+    if (report->mask & FIELD_LABEL_BIT) {
+        if (pos >= len || buf[pos] > LABEL_LENGTH - 1) {
+            return -1;
+        }
+
+        report->label_len = buf[pos++];
+        report->label = (const char*) buf + pos;
+        pos += report->label_len;
+    }
+
+    return pos == len ? 0 : -1;
+}
+
+/*
+ * Copy the changed fields to their places, label must fit LABEL_LENGTH.
+ */
+void para_report_apply(const para_report_t *report, char *fields, int field_count, char *label)
+{
+    const char *value = report->values;
+
+    for (int f = 0; f < field_count; f++) {
+        if (report->mask & (1U << f)) {
+            fields[f] = *value++;
+        }
+    }
+
+    if (report->label) {
+        memcpy(label, report->label, report->label_len);
+        label[report->label_len] = 0;
+    }
+}
@@ -0,0 +1,301 @@
+/*
+ * The source of the MQTT daemon interacting with Paradox EVO control panel
+ * via their's PRT3 module.
+ *
+ * para_sched.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Darau, blė
+ *
+ *  This file is a part of personal use utilities developed to be used
+ *  on various Linux devices.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "zmq_helpers.h"
+
+#include "log.h"
+#include "para_sched.h"
+#include "time_helpers.h"
+
+#define PRT3_PREFIX_LEN 5
+
+static const char rq_codes[RQ_TYPES_COUNT][3] = {
+    "RA",
+    "RZ",
+    "AL",
+    "ZL",
+    "AA",
+    "AD",
+    "AQ",
+    "UK",
+};
+
+static void queue_push(para_request_queue_t *queue, short slot);
+static short queue_pop(para_request_queue_t *queue);
+static void release_slot(para_sched_t *sched, int inflight_pos);
+static void send_request(para_request_t *req, void *serial_sender);
+
+void para_sched_init(para_sched_t *sched, int window, int timeout)
+{
+    memset(sched, 0, sizeof(para_sched_t));
+
+    if (window < 1) {
+        window = 1;
+    } else if (window > PARA_SCHED_MAX_WINDOW) {
+        window = PARA_SCHED_MAX_WINDOW;
+    }
+
+    sched->window = window;
+    sched->timeout = timeout > 0 ? timeout : PARA_SCHED_DEFAULT_TIMEOUT;
+
+    for (int i = 0; i < PARA_SCHED_QUEUE_LEN; i++) {
+        sched->free_slots[i] = PARA_SCHED_QUEUE_LEN - 1 - i;
+    }
+
+    sched->free_count = PARA_SCHED_QUEUE_LEN;
+}
+
+/*
+ * Queue a request to PRT3. Queries for an area/zone already waiting
+ * in the queue or in flight are collapsed into the pending one.
+ * Returns 0 if queued, 1 if collapsed and -1 if the queue is full.
+ */
+int para_sched_request(para_sched_t *sched, para_request_type_t type, int num, const char *arg)
+{
+    if (type < 0 || type >= RQ_TYPES_COUNT || num < 0 || num >= PARA_SCHED_MAX_NUM) {
+        log_error("PSCH: invalid request %d/%d\n", type, num);
+        return -1;
+    }
+
+    if (RQ_IS_QUERY(type) && sched->pending[type][num]) {
+        log_debug("PSCH: %s%03d already pending\n", rq_codes[type], num);
+        sched->collapsed++;
+        return 1;
+    }
+
+    if (sched->free_count == 0) {
+        log_error("PSCH: request queue is full, dropping %s%03d\n", rq_codes[type], num);
+        sched->dropped++;
+        return -1;
+    }
+
+    short slot = sched->free_slots[--sched->free_count];
+    para_request_t *req = &sched->slots[slot];
+
+    req->type = type;
+    req->num = num;
+    req->retries = 0;
+    req->deadline = 0;
+    req->len = snprintf(req->line, PARA_REQUEST_LEN, "%s%03d%s", rq_codes[type], num, arg ? arg : "");
+
+    if (req->len >= PARA_REQUEST_LEN) {
+        log_error("PSCH: request %s%03d is too long\n", rq_codes[type], num);
+        sched->free_slots[sched->free_count++] = slot;
+        return -1;
+    }
+
+    if (RQ_IS_QUERY(type)) {
+        sched->pending[type][num] = slot + 1;
+        queue_push(&sched->queries, slot);
+    } else {
+        queue_push(&sched->commands, slot);
+    }
+
+    return 0;
+}
+
+/*
+ * Resend or give up timed out requests, then fill the free window,
+ * commands first. Call after every poll of the manager's loop.
+ */
+void para_sched_dispatch(para_sched_t *sched, void *serial_sender)
+{
+    long long now = t_now_ms();
+
+    for (int i = 0; i < sched->inflight_count; ) {
+        para_request_t *req = &sched->slots[sched->inflight[i]];
+
+        if (req->deadline > now) {
+            i++;
+            continue;
+        }
+
+        // A command may have been carried out with the echo lost, resending
+        // could arm twice or press a utility key again. The area command
+        // tracker reports the timeout instead.
+        if (RQ_IS_QUERY(req->type) && req->retries < PARA_SCHED_RETRIES) {
+            log_verbose("PSCH: %.*s timed out, resending\n", PRT3_PREFIX_LEN, req->line);
+            req->retries++;
+            req->deadline = now + sched->timeout;
+            sched->retried++;
+            send_request(req, serial_sender);
+            i++;
+        } else {
+            log_error("PSCH: %.*s got no response, giving up\n", PRT3_PREFIX_LEN, req->line);
+            sched->dropped++;
+            release_slot(sched, i);
+        }
+    }
+
+    while (sched->inflight_count < sched->window) {
+        short slot = queue_pop(&sched->commands);
+
+        if (slot < 0) {
+            slot = queue_pop(&sched->queries);
+        }
+
+        if (slot < 0) {
+            break;
+        }
+
+        para_request_t *req = &sched->slots[slot];
+        req->deadline = now + sched->timeout;
+        sched->inflight[sched->inflight_count++] = slot;
+        sched->sent++;
+        send_request(req, serial_sender);
+    }
+}
+
+/*
+ * Match a PRT3 line against the requests in flight by the echoed prefix.
+ * The oldest matching request is completed.
+ */
+para_request_result_t para_sched_response(para_sched_t *sched, const char *line)
+{
+    for (int i = 0; i < sched->inflight_count; i++) {
+        para_request_t *req = &sched->slots[sched->inflight[i]];
+
+        if (strncmp(line, req->line, PRT3_PREFIX_LEN) == 0) {
+            para_request_result_t result = RQR_OK;
+
+            if (line[PRT3_PREFIX_LEN] == '&' && strncmp(line + PRT3_PREFIX_LEN + 1, "fail", 4) == 0) {
+                result = RQR_FAIL;
+            }
+
+            release_slot(sched, i);
+            return result;
+        }
+    }
+
+    return RQR_UNSOLICITED;
+}
+
+/*
+ * Milliseconds until the earliest request in flight times out,
+ * -1 if nothing is in flight.
+ */
+int para_sched_next_timeout(para_sched_t *sched)
+{
+    if (sched->inflight_count == 0) {
+        return -1;
+    }
+
+    long long deadline = sched->slots[sched->inflight[0]].deadline;
+
+    for (int i = 1; i < sched->inflight_count; i++) {
+        if (sched->slots[sched->inflight[i]].deadline < deadline) {
+            deadline = sched->slots[sched->inflight[i]].deadline;
+        }
+    }
+
+    long long left = deadline - t_now_ms();
+
+    return left > 0 ? (int) left : 0;
+}
+
+/*
+ * Requests in flight were lost with the device. Queries are resent on the
+ * next dispatch, counting the retries afresh. Commands are dropped, as in
+ * para_sched_dispatch(): the panel may have carried them out, the area
+ * command tracker reports them.
+ */
+void para_sched_resend_inflight(para_sched_t *sched)
+{
+    for (int i = 0; i < sched->inflight_count; ) {
+        para_request_t *req = &sched->slots[sched->inflight[i]];
+
+        if (RQ_IS_QUERY(req->type)) {
+            req->deadline = 0;
+            req->retries = 0;
+            i++;
+        } else {
+            log_error("PSCH: %.*s lost with the device, dropping\n", PRT3_PREFIX_LEN, req->line);
+            sched->dropped++;
+            release_slot(sched, i);
+        }
+    }
+}
+
+int para_sched_idle(para_sched_t *sched)
+{
+    return sched->inflight_count == 0 && sched->commands.count == 0 && sched->queries.count == 0;
+}
+
+/*
+ * Whether the query is queued or in flight, i.e. its response is still to come.
+ */
+int para_sched_pending(const para_sched_t *sched, para_request_type_t type, int num)
+{
+    return RQ_IS_QUERY(type) && num >= 0 && num < PARA_SCHED_MAX_NUM && sched->pending[type][num] != 0;
+}
+
+static void queue_push(para_request_queue_t *queue, short slot)
+{
+    // Cannot overflow: there are no more slots than queue positions.
+    queue->idx[(queue->head + queue->count) % PARA_SCHED_QUEUE_LEN] = slot;
+    queue->count++;
+}
+
+static short queue_pop(para_request_queue_t *queue)
+{
+    if (queue->count == 0) {
+        return -1;
+    }
+
+    short slot = queue->idx[queue->head];
+    queue->head = (queue->head + 1) % PARA_SCHED_QUEUE_LEN;
+    queue->count--;
+
+    return slot;
+}
+
+static void release_slot(para_sched_t *sched, int inflight_pos)
+{
+    short slot = sched->inflight[inflight_pos];
+    para_request_t *req = &sched->slots[slot];
+
+    if (RQ_IS_QUERY(req->type)) {
+        sched->pending[req->type][req->num] = 0;
+    }
+
+    // Keep the order of the window, so the oldest request matches first.
+    memmove(&sched->inflight[inflight_pos], &sched->inflight[inflight_pos + 1],
+        (sched->inflight_count - inflight_pos - 1) * sizeof(short));
+    sched->inflight_count--;
+
+    sched->free_slots[sched->free_count++] = slot;
+}
+
+static void send_request(para_request_t *req, void *serial_sender)
+{
+    log_debug("PSCH: sending %s\n", req->line);
+
+    zmq_msg_t message;
+    zmq_msg_init_size(&message, req->len);
+
+    memcpy(zmq_msg_data(&message), req->line, req->len);
+
+    zmq_msg_send (&message, serial_sender, 0);
+    zmq_msg_close (&message);
+}
@@ -24,31 +24,85 @@
 #include <stdio.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/inotify.h>
+#include <sys/uio.h>
 #include <fcntl.h>
 #include <sys/select.h>
 #include <string.h>
-#include <fcntl.h>
 #include <unistd.h>
+#include <errno.h>
+#include <libgen.h>
+#include <limits.h>
 
 
 #include "log.h"
+#include "para_capture.h"
+#include "para_frame.h"
 #include "para_serial.h"
+#include "paratypes.h"
 #include "endpoints.h"
+#include "time_helpers.h"
 #include "zmq_helpers.h"
 
-static int fd;
+typedef struct {
+    para_panel_config_t *cfg;
+    void *context;
+    int fd;
+    para_capture_t capture;
 
-void *serial_thread(void *);
+    // Commands waiting for the serial to take them, a ring of bytes.
+    struct {
+        char buffer[PARA_SERIAL_OUT_LEN];
+        size_t head;
+        size_t count;
+    } out;
+} para_serial_t;
 
-pthread_t start_para_serial(char *device, void *context)
+static para_serial_t serials[MAX_PANELS];
+
+void *serial_thread(void *);
+static int serial_open(const char *device);
+static int serial_watch(int inotify_fd, const char *device);
+static int serial_lost(para_serial_t *serial, int read_result);
+static void serial_send_state(void *status_publisher, para_serial_state_t state);
+static void out_receive(para_serial_t *serial, void *command_receiver);
+static void out_capture(para_serial_t *serial, const char *command, int size);
+static int out_flush(para_serial_t *serial);
+
+pthread_t start_para_serial(para_panel_config_t *panel, void *context)
 {
-    fd = open(device, O_RDWR | O_NOCTTY | O_NDELAY);
+    para_serial_t *serial = &serials[panel->index];
+
+    serial->cfg = panel;
+    serial->context = context;
+    serial->fd = serial_open(panel->device);
+
+    if (serial->fd < 0) {
+        log_error("SERIAL: Could not open device handler of %s: %d\n", panel->device, serial->fd);
+        return (pthread_t) NULL;
+    }
 
-    if (fd < 0) {
-        log_error("SERIAL: Could not open device handler: %d\n", fd);
+    if (panel->record_file && cap_open_record(&serial->capture, panel->record_file) != 0) {
+        close(serial->fd);
         return (pthread_t) NULL;
     }
 
+    // Start threads
+    pthread_t thread;
+
+    pthread_create(&thread, NULL, serial_thread, serial);
+
+    return thread;
+}
+
+static int serial_open(const char *device)
+{
+    int dev_fd = open(device, O_RDWR | O_NOCTTY | O_NDELAY);
+
+    if (dev_fd < 0) {
+        return dev_fd;
+    }
+
     struct termios tio = {
 		.c_cflag = PARA_SERIAL_SPEED | CS8 | CLOCAL | CREAD,
 		.c_iflag = 0,
@@ -57,30 +111,181 @@ pthread_t start_para_serial(char *device, void *context)
 		.c_cc = {0},
 	};
 
-	tcflush(fd, TCIFLUSH);
-	tcsetattr(fd, TCSANOW, &tio);
+	tcflush(dev_fd, TCIFLUSH);
+	tcsetattr(dev_fd, TCSANOW, &tio);
 
-    // Start threads
-    pthread_t thread;
+    return dev_fd;
+}
 
-    pthread_create(&thread, NULL, serial_thread, context);
+/*
+ * Watch the directory where the device node should appear. When the last
+ * USB serial is unplugged, /dev/serial/by-id itself is gone, so watch the
+ * closest existing parent instead. Retried on every event anyway.
+ */
+static int serial_watch(int inotify_fd, const char *device)
+{
+    char path[PATH_MAX];
+    snprintf(path, PATH_MAX, "%s", device);
 
-    return thread;
+    char *dir = dirname(path);
+
+    while (1) {
+        if (inotify_add_watch(inotify_fd, dir, IN_CREATE | IN_MOVED_TO | IN_ATTRIB) >= 0) {
+            log_debug("SERIAL: watching %s\n", dir);
+            return 0;
+        }
+
+        if (strcmp(dir, "/") == 0 || strcmp(dir, ".") == 0) {
+            return -1;
+        }
+
+        dir = dirname(dir);
+    }
+}
+
+/*
+ * Tell a vanished device from a read with nothing to read.
+ */
+static int serial_lost(para_serial_t *serial, int read_result)
+{
+    if (read_result < 0) {
+        return errno != EAGAIN && errno != EINTR;
+    }
+
+    // EOF on a tty means hangup, but with VMIN 0 reads may return 0 as well.
+    return access(serial->cfg->device, F_OK) != 0;
+}
+
+static void serial_send_state(void *status_publisher, para_serial_state_t state)
+{
+    char msg = state;
+    zmq_send(status_publisher, &msg, 1, 0);
+}
+
+/*
+ * Queue all the commands waiting in ZMQ, as long as they fit.
+ */
+static void out_receive(para_serial_t *serial, void *command_receiver)
+{
+    while (PARA_SERIAL_OUT_LEN - serial->out.count > PARA_SERIAL_INPUT_LEN) {
+        char command[PARA_SERIAL_INPUT_LEN + 1];
+        int size = zmq_recv(command_receiver, command, PARA_SERIAL_INPUT_LEN, ZMQ_DONTWAIT);
+
+        if (size < 0) {
+            break;
+        }
+
+        if (size > PARA_SERIAL_INPUT_LEN) {
+            log_error("SERIAL: command too long (%d), dropping.\n", size);
+            continue;
+        }
+
+        log_debug("SERIAL: queueing the command: %.*s\n", size, command);
+        out_capture(serial, command, size);
+        command[size++] = PARA_SERIAL_EOL;
+
+        size_t tail = (serial->out.head + serial->out.count) % PARA_SERIAL_OUT_LEN;
+        size_t first = PARA_SERIAL_OUT_LEN - tail < (size_t) size ? PARA_SERIAL_OUT_LEN - tail : (size_t) size;
+
+        memcpy(serial->out.buffer + tail, command, first);
+        memcpy(serial->out.buffer, command + first, size - first);
+        serial->out.count += size;
+    }
+
+    cap_flush(&serial->capture);
+}
+
+/*
+ * Record a command, the user code of AA001A1234 and AD0011234 is masked
+ * so it does not end up on disk.
+ */
+static void out_capture(para_serial_t *serial, const char *command, int size)
+{
+    char masked[PARA_SERIAL_INPUT_LEN];
+    int code = 0;
+
+    if (size >= 2 && command[0] == PRT3_AREA && command[1] == PRT3_AREA) {
+        code = 6;
+    } else if (size >= 2 && command[0] == PRT3_AREA && command[1] == PRT3_DISARM) {
+        code = 5;
+    }
+
+    if (!code || size <= code) {
+        cap_write(&serial->capture, CAP_TO_PANEL, command, size);
+        return;
+    }
+
+    memcpy(masked, command, code);
+    memset(masked + code, '*', size - code);
+    cap_write(&serial->capture, CAP_TO_PANEL, masked, size);
+}
+
+/*
+ * Write as much of the queue as the tty takes, wrapped part in the same call.
+ * Returns -1 on error other than a full tty buffer.
+ */
+static int out_flush(para_serial_t *serial)
+{
+    while (serial->out.count) {
+        struct iovec iov[2];
+        size_t first = PARA_SERIAL_OUT_LEN - serial->out.head;
+        int iovcnt = 1;
+
+        iov[0].iov_base = serial->out.buffer + serial->out.head;
+
+        if (serial->out.count > first) {
+            iov[0].iov_len = first;
+            iov[1].iov_base = serial->out.buffer;
+            iov[1].iov_len = serial->out.count - first;
+            iovcnt = 2;
+        } else {
+            iov[0].iov_len = serial->out.count;
+        }
+
+        ssize_t wrc = writev(serial->fd, iov, iovcnt);
+
+        if (wrc < 0) {
+            if (errno == EAGAIN || errno == EINTR) {
+                return 0;
+            }
+
+            log_error("SERIAL: error writing to device: %d\n", errno);
+            return -1;
+        }
+
+        if ((size_t) wrc < serial->out.count) {
+            log_debug("SERIAL: wrote %ld of %lu bytes, rest waits.\n", wrc, serial->out.count);
+        }
+
+        serial->out.head = (serial->out.head + wrc) % PARA_SERIAL_OUT_LEN;
+        serial->out.count -= wrc;
+    }
+
+    serial->out.head = 0;
+
+    return 0;
 }
 
-void *serial_thread(void *context)
+void *serial_thread(void *arg)
 {
     __label__ EXIT_SERIAL_THREAD;
-    // TODO: Create writing thread
-    log_info("SERIAL: starting thread...\n");
+
+    para_serial_t *serial = (para_serial_t*) arg;
+    void *context = serial->context;
+    int index = serial->cfg->index;
+    char endpoint[EPT_NAME_LEN];
+
+    log_info("SERIAL: starting thread for %s...\n", serial->cfg->device);
 
     void *command_receiver = NULL;
     void *kill_subscriber = NULL;
     void *serial_publisher = NULL;
+    void *status_publisher = NULL;
+    int inotify_fd = -1;
     int rc;
 
     /******* Initialize sockets **********/
-    if ((rc = z_start_endpoint(context, &command_receiver, ZMQ_PULL, EPT_SERIAL_WRITE)) != 0) {
+    if ((rc = z_start_endpoint(context, &command_receiver, ZMQ_PULL, z_panel_endpoint(endpoint, EPT_SERIAL_WRITE, index))) != 0) {
         log_error("SERIAL: cannot start command receiver: %d, exiting.\n", rc);
         goto EXIT_SERIAL_THREAD;
     }
@@ -88,10 +293,15 @@ void *serial_thread(void *context)
     // Lamely give time for ZMQ PUB somewhere to initialize.
     sleep(1);
 
-    if ((rc = z_connect_endpoint(context, &serial_publisher, ZMQ_PUSH, EPT_SERIAL_READ)) != 0) {
+    if ((rc = z_connect_endpoint(context, &serial_publisher, ZMQ_PUSH, z_panel_endpoint(endpoint, EPT_SERIAL_READ, index))) != 0) {
         log_error("SERIAL: cannot start serial publisher: %d, exiting.\n", rc);
         goto EXIT_SERIAL_THREAD;
     }
+
+    if ((rc = z_connect_endpoint(context, &status_publisher, ZMQ_PUSH, z_panel_endpoint(endpoint, EPT_SERIAL_STATUS, index))) != 0) {
+        log_error("SERIAL: cannot start status publisher: %d, exiting.\n", rc);
+        goto EXIT_SERIAL_THREAD;
+    }
     
     if ((rc = z_connect_endpoint(context, &kill_subscriber, ZMQ_SUB, EPT_KILL)) != 0) {
         log_error("SERIAL: cannot subscribe to kill endpoint: %d, exiting.\n", rc);
@@ -101,105 +311,111 @@ void *serial_thread(void *context)
     zmq_setsockopt(kill_subscriber, ZMQ_SUBSCRIBE, "", 0);
     /******* END of Initialize sockets **********/
 
-    char buffer[PARA_SERIAL_BUFF_LEN];
-    memset(buffer, 0, PARA_SERIAL_BUFF_LEN);
+    para_frame_t frame;
+    para_frame_init(&frame);
 
-    char serial_input[PARA_SERIAL_INPUT_LEN];
-    memset(serial_input, 0, PARA_SERIAL_INPUT_LEN);
-    int input_pos = 0;
+    para_serial_state_t state = SERIAL_ONLINE;
+    long long lost_at = 0;
+    int retry = PARA_SERIAL_RETRY_MAX;
 
     zmq_pollitem_t items[] = {
         { kill_subscriber, 0, ZMQ_POLLIN, 0 },
-        { NULL, fd, ZMQ_POLLIN | ZMQ_POLLERR, 0 },
+        { NULL, serial->fd, ZMQ_POLLIN | ZMQ_POLLERR, 0 },
         { command_receiver, 0, ZMQ_POLLIN, 0 },
     };
 
     log_info("SERIAL: thread ready!\n");
 
     while(1) {
-        zmq_poll(items, 3, -1);
+        // While offline the device's directory is watched instead,
+        // and commands wait in the queue.
+        // Commands also wait while the output queue cannot take one more.
+        items[1].fd = state == SERIAL_ONLINE ? serial->fd : inotify_fd;
+        items[1].events = ZMQ_POLLIN | ZMQ_POLLERR | (state == SERIAL_ONLINE && serial->out.count ? ZMQ_POLLOUT : 0);
+        items[2].events = state == SERIAL_ONLINE && PARA_SERIAL_OUT_LEN - serial->out.count > PARA_SERIAL_INPUT_LEN ? ZMQ_POLLIN : 0;
+
+        rc = zmq_poll(items, 3, state == SERIAL_ONLINE ? -1 : retry);
 
         if (items[0].revents & ZMQ_POLLIN) {
             z_drop_message(kill_subscriber);
             log_info("SERIAL: received KILL, exitting\n");
             break;
-        } else if (items[1].revents & ZMQ_POLLIN) {
-            // Bytes in serial to read?
-            // ssize_t br = read(fd, &serial_input[input_pos], 1);
-            ssize_t br = read(fd, buffer, PARA_SERIAL_BUFF_LEN);
+        }
 
-            log_debug("SERIAL: buffer %ld [%s]\n", br, buffer);
+        if (state == SERIAL_OFFLINE) {
+            if (items[1].revents & ZMQ_POLLIN) {
+                char events[4096];
+                while (read(inotify_fd, events, sizeof(events)) > 0);
+
+                // Something appeared, udev may still be setting it up: retry soon.
+                retry = PARA_SERIAL_RETRY_MIN;
+            } else if (rc == 0 && retry < PARA_SERIAL_RETRY_MAX) {
+                retry = retry * 2 < PARA_SERIAL_RETRY_MAX ? retry * 2 : PARA_SERIAL_RETRY_MAX;
+            }
+
+            if ((serial->fd = serial_open(serial->cfg->device)) >= 0) {
+                log_info("SERIAL: %s is back after %lld ms\n", serial->cfg->device, t_now_ms() - lost_at);
+                close(inotify_fd);
+                inotify_fd = -1;
+                state = SERIAL_ONLINE;
+                serial_send_state(status_publisher, state);
+            } else {
+                serial_watch(inotify_fd, serial->cfg->device);
+            }
+
+            continue;
+        }
+
+        int lost = 0;
+
+        if (items[1].revents & (ZMQ_POLLIN | ZMQ_POLLERR)) {
+            // Bytes in serial to read?
+            ssize_t br = para_frame_read(&frame, serial->fd);
 
             if (br > 0) {
-                for (int i = 0; i < br; i++) {
-                    if (buffer[i] == PARA_SERIAL_EOL) {
-                        log_verbose("SERIAL: [%s]\n", serial_input);
-
-                        // TODO: send out
-                        zmq_msg_t message;
-
-                        zmq_msg_init_size (&message, input_pos);
-                        memcpy(zmq_msg_data(&message), serial_input, input_pos);
-                        zmq_msg_send (&message, serial_publisher, 0);
-                        zmq_msg_close (&message);
-
-                        // Cleanup and read again
-                        memset(serial_input, 0, PARA_SERIAL_INPUT_LEN);
-                        input_pos = 0;
-                    } else if (buffer[i] != 0) {
-                        serial_input[input_pos++] = buffer[i];
-
-                        if (input_pos >= PARA_SERIAL_INPUT_LEN - 1) {
-                            // Something awry happened, input should not be that long!
-                            log_error("SERIAL: input buffer [%s] is too long! Read buffer: [%s]\n", serial_input, buffer);
-
-                            memset(serial_input, 0, PARA_SERIAL_INPUT_LEN);
-                            input_pos = 0;
-
-                            break; // Skip this too long buffer.
-                        }
-                    } else {
-                        break; // The end of buffer is reached, partial read.
-                    }
+                const char *line;
+                size_t len;
+
+                while (para_frame_next(&frame, &line, &len)) {
+                    log_verbose("SERIAL: [%.*s]\n", (int) len, line);
+                    zmq_send(serial_publisher, line, len, 0);
+                    cap_write(&serial->capture, CAP_FROM_PANEL, line, len);
                 }
 
-                memset(buffer, 0, PARA_SERIAL_BUFF_LEN);
+                cap_flush(&serial->capture);
+            } else if ((items[1].revents & ZMQ_POLLERR) || serial_lost(serial, br)) {
+                log_error("SERIAL: %s lost (%ld, %d), waiting for it to come back\n", serial->cfg->device, br, errno);
+                lost = 1;
             } else if (br == 0) {
                 log_verbose("SERIAL: nothing read!\n");
             } else {
                 log_error("SERIAL: error reading from device %ld.\n", br);
             }
-        } else if (items[2].revents & ZMQ_POLLIN) {
-            // log_info("SERIAL: receiving command to send to EVO...\n");
-            zmq_msg_t message;
-            
-            zmq_msg_init (&message);
-            int size = zmq_msg_recv (&message, command_receiver, 0);
-
-            if (size > 0) {
-                char *output = malloc(size + 1);
-                
-                memcpy (output, zmq_msg_data (&message), size);
-                output[size] = 0;
-                
-                log_debug("SERIAL: sending the command out: %s...\n", output);
-                output[size] = PARA_SERIAL_EOL;
-
-                ssize_t wrc = write(fd, output, size + 1);
-                
-                if (wrc != size + 1) {
-                    log_debug("\nSERIAL: wrote less bytes than expected: %ld!\n", wrc);
-                }
+        }
 
-                free(output);
-                log_debug("done\n");
-            }
+        if (!lost && (items[2].revents & ZMQ_POLLIN)) {
+            out_receive(serial, command_receiver);
+        }
 
-            if (size >= 0) {
-                zmq_msg_close (&message);
-            }
-        } else {
-            log_info("SERIAL: POLLERR?..\n");
+        if (!lost && serial->out.count && out_flush(serial) != 0) {
+            log_error("SERIAL: %s lost while writing, waiting for it to come back\n", serial->cfg->device);
+            lost = 1;
+        }
+
+        if (lost) {
+            // The scheduler resends the queries in flight, so the output buffer is dropped.
+            close(serial->fd);
+            serial->fd = -1;
+            serial->out.head = 0;
+            serial->out.count = 0;
+            para_frame_init(&frame);
+            lost_at = t_now_ms();
+            retry = PARA_SERIAL_RETRY_MIN;
+            state = SERIAL_OFFLINE;
+            serial_send_state(status_publisher, state);
+
+            inotify_fd = inotify_init1(IN_NONBLOCK);
+            serial_watch(inotify_fd, serial->cfg->device);
         }
     }//*/
 
@@ -212,11 +428,23 @@ EXIT_SERIAL_THREAD:
         zmq_close(serial_publisher);
     }
 
+    if (status_publisher) {
+        zmq_close(status_publisher);
+    }
+
     if (kill_subscriber) {
         zmq_close(kill_subscriber);
     }
 
-    close(fd);
+    if (inotify_fd >= 0) {
+        close(inotify_fd);
+    }
+
+    if (serial->fd >= 0) {
+        close(serial->fd);
+    }
+
+    cap_close(&serial->capture);
     
     return NULL;
 }
@@ -0,0 +1,202 @@
+/*
+ * The source of the MQTT daemon interacting with Paradox EVO control panel
+ * via their's PRT3 module.
+ *
+ * para_snapshot.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Darau, blė
+ *
+ *  This file is a part of personal use utilities developed to be used
+ *  on various Linux devices.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+#include <fcntl.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "log.h"
+#include "para_snapshot.h"
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+#define SNAP_HEADER_LEN offsetof(para_snapshot_data_t, areas)
+
+static uint64_t fnv_hash(uint64_t hash, const void *data, size_t len);
+static uint32_t snap_checksum(const para_snapshot_data_t *data);
+static uint64_t snap_fingerprint(const para_state_t *state);
+
+/*
+ * Map the snapshot file, creating it if needed. The state must have
+ * its areas and zones added already, they make the fingerprint.
+ */
+int para_snapshot_open(para_snapshot_t *snap, const char *path, const para_state_t *state)
+{
+    snap->data = NULL;
+    snap->fingerprint = snap_fingerprint(state);
+
+    if ((snap->fd = open(path, O_RDWR | O_CREAT, 0644)) < 0) {
+        log_error("SNAP: cannot open %s\n", path);
+        return -1;
+    }
+
+    if (ftruncate(snap->fd, sizeof(para_snapshot_data_t)) != 0) {
+        log_error("SNAP: cannot size %s\n", path);
+        close(snap->fd);
+        return -2;
+    }
+
+    void *map = mmap(NULL, sizeof(para_snapshot_data_t), PROT_READ | PROT_WRITE, MAP_SHARED, snap->fd, 0);
+
+    if (map == MAP_FAILED) {
+        log_error("SNAP: cannot map %s\n", path);
+        close(snap->fd);
+        return -3;
+    }
+
+    snap->data = map;
+
+    return 0;
+}
+
+/*
+ * Take labels and statuses from a valid snapshot. Everything loaded is
+ * marked changed, so it is reported right away.
+ * Returns 1 if the snapshot was valid, 0 otherwise.
+ */
+int para_snapshot_load(para_snapshot_t *snap, para_state_t *state)
+{
+    para_snapshot_data_t *data = snap->data;
+
+    if (!data) {
+        return 0;
+    }
+
+    if (memcmp(data->magic, SNAP_MAGIC, SNAP_MAGIC_LEN) != 0 || data->size != sizeof(para_snapshot_data_t)) {
+        log_info("SNAP: no snapshot yet\n");
+        return 0;
+    }
+
+    if (data->fingerprint != snap->fingerprint) {
+        log_info("SNAP: areas or zones have changed, snapshot is not used\n");
+        return 0;
+    }
+
+    if (data->checksum != snap_checksum(data)) {
+        log_error("SNAP: snapshot is broken\n");
+        return 0;
+    }
+
+    for (int a = 0; (a = para_state_next_area(state->areas_monitored, a)); ) {
+        for (int f = 0; f < AF_COUNT; f++) {
+            para_state_area_set(state, a, f, data->areas[a - 1].fields[f]);
+        }
+
+        para_state_area_label(state, a, data->area_names[a - 1], LABEL_LENGTH - 1);
+    }
+
+    // Zones are kept by slot, the fingerprint makes sure the slots are the same.
+    for (int slot = 0; slot < state->zone_count; slot++) {
+        int z = state->slot_zone[slot];
+
+        for (int f = 0; f < ZF_COUNT; f++) {
+            para_state_zone_set(state, z, f, data->zones[slot].fields[f]);
+        }
+
+        para_state_zone_label(state, z, data->zone_names[slot], LABEL_LENGTH - 1);
+    }
+
+    state->unsaved = 0;
+
+    return 1;
+}
+
+/*
+ * Copy the state to the mapping if anything has changed since the last time.
+ * Page cache keeps it through a crash of the daemon, an interrupted copy
+ * is caught by the checksum.
+ */
+void para_snapshot_save(para_snapshot_t *snap, para_state_t *state)
+{
+    para_snapshot_data_t *data = snap->data;
+
+    if (!data || !state->unsaved) {
+        return;
+    }
+
+    memcpy(data->areas, state->areas, sizeof(data->areas));
+    memcpy(data->zones, state->zones, state->zone_count * sizeof(para_zone_state_t));
+    memcpy(data->area_names, state->area_names, sizeof(data->area_names));
+    memcpy(data->zone_names, state->zone_names, state->zone_count * LABEL_LENGTH);
+
+    memcpy(data->magic, SNAP_MAGIC, SNAP_MAGIC_LEN);
+    data->size = sizeof(para_snapshot_data_t);
+    data->fingerprint = snap->fingerprint;
+    data->checksum = snap_checksum(data);
+
+    state->unsaved = 0;
+}
+
+void para_snapshot_close(para_snapshot_t *snap, para_state_t *state)
+{
+    if (!snap->data) {
+        return;
+    }
+
+    para_snapshot_save(snap, state);
+    msync(snap->data, sizeof(para_snapshot_data_t), MS_SYNC);
+    munmap(snap->data, sizeof(para_snapshot_data_t));
+    close(snap->fd);
+
+    snap->data = NULL;
+}
+
+static uint64_t fnv_hash(uint64_t hash, const void *data, size_t len)
+{
+    const uint8_t *bytes = data;
+
+    for (size_t i = 0; i < len; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+static uint32_t snap_checksum(const para_snapshot_data_t *data)
+{
+    uint64_t hash = fnv_hash(FNV_OFFSET, (const uint8_t*) data + SNAP_HEADER_LEN, sizeof(para_snapshot_data_t) - SNAP_HEADER_LEN);
+
+    return (uint32_t) (hash ^ (hash >> 32));
+}
+
+/*
+ * Monitored areas and zones in their slots with zone to area assignment, plus the layout.
+ */
+static uint64_t snap_fingerprint(const para_state_t *state)
+{
+    uint32_t size = sizeof(para_snapshot_data_t);
+    uint64_t hash = fnv_hash(FNV_OFFSET, &size, sizeof(size));
+
+    hash = fnv_hash(hash, state->areas_monitored, sizeof(state->areas_monitored));
+    hash = fnv_hash(hash, state->zones_monitored, sizeof(state->zones_monitored));
+
+    hash = fnv_hash(hash, state->slot_zone, state->zone_count);
+
+    for (int slot = 0; slot < state->zone_count; slot++) {
+        hash = fnv_hash(hash, &state->zones[slot].area, sizeof(state->zones[slot].area));
+    }
+
+    return hash;
+}
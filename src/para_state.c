@@ -0,0 +1,350 @@
+/*
+ * The source of the MQTT daemon interacting with Paradox EVO control panel
+ * via their's PRT3 module.
+ *
+ * para_state.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Darau, blė
+ *
+ *  This file is a part of personal use utilities developed to be used
+ *  on various Linux devices.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+#include <string.h>
+
+#include "para_state.h"
+
+static int bits_next(const uint64_t *bits, int words, int after);
+
+void para_state_init(para_state_t *state)
+{
+    memset(state, 0, sizeof(para_state_t));
+}
+
+void para_state_add_area(para_state_t *state, int area_num)
+{
+    int aidx = area_num - 1;
+
+    memset(&state->areas[aidx], 0, sizeof(para_area_state_t));
+    state->area_names[aidx][0] = 0;
+    state->area_fields[aidx] = 0;
+    bits_set(state->areas_monitored, aidx);
+    bits_clear(state->areas_reported, aidx);
+}
+
+/*
+ * The area is expected to be added already. A zone added again keeps its slot.
+ */
+void para_state_add_zone(para_state_t *state, int area_num, int zone_num)
+{
+    int zidx = zone_num - 1;
+
+    if (!state->zone_slot[zidx]) {
+        state->slot_zone[state->zone_count] = zone_num;
+        state->zone_slot[zidx] = ++state->zone_count;
+    }
+
+    int slot = para_state_zone_idx(state, zone_num);
+
+    memset(&state->zones[slot], 0, sizeof(para_zone_state_t));
+    state->zones[slot].area = area_num;
+    state->zones[slot].bypassed = RS_OK;
+    state->zone_names[slot][0] = 0;
+    state->zone_fields[slot] = 0;
+    bits_clear(state->zones_reported, zidx);
+
+    for (int a = 0; a < MAX_AREAS; a++) {
+        bits_clear(state->area_zones[a], zidx);
+    }
+
+    for (int b = 0; b < ZB_COUNT; b++) {
+        bits_clear(state->zone_bits[b], zidx);
+    }
+
+    bits_set(state->area_zones[area_num - 1], zidx);
+    bits_set(state->zones_monitored, zidx);
+}
+
+/*
+ * Setters return 1 if the value has changed, which marks the field and the area/zone dirty.
+ */
+int para_state_area_set(para_state_t *state, int area_num, para_area_field_t field, char value)
+{
+    para_area_state_t *area = &state->areas[area_num - 1];
+
+    if (area->fields[field] == value) {
+        return 0;
+    }
+
+    area->fields[field] = value;
+    state->area_fields[area_num - 1] |= 1U << field;
+    bits_set(state->areas_dirty, area_num - 1);
+    state->unsaved = 1;
+
+    return 1;
+}
+
+/*
+ * Condition bitsets are kept in line with the status bytes of the zone.
+ */
+int para_state_zone_set(para_state_t *state, int zone_num, para_zone_field_t field, char value)
+{
+    int zidx = zone_num - 1;
+    int slot = para_state_zone_idx(state, zone_num);
+    para_zone_state_t *zone = &state->zones[slot];
+
+    if (zone->fields[field] == value) {
+        return 0;
+    }
+
+    zone->fields[field] = value;
+    state->zone_fields[slot] |= 1U << field;
+    bits_set(state->zones_dirty, zidx);
+    state->unsaved = 1;
+
+    switch (field) {
+        case ZF_STATUS:
+            bits_assign(state->zone_bits[ZB_OPEN], zidx, value == RS_ZONE_OPEN);
+        break;
+
+        case ZF_ALARM:
+            bits_assign(state->zone_bits[ZB_ALARM], zidx, value == RS_ZONE_IN_ALARM);
+        break;
+
+        case ZF_FIRE:
+            bits_assign(state->zone_bits[ZB_FIRE], zidx, value == RS_ZONE_FIRE);
+        break;
+
+        case ZF_BYPASSED:
+            bits_assign(state->zone_bits[ZB_BYPASSED], zidx, value == RS_ZONE_BYPASSED);
+        break;
+
+        case ZF_BATTERY:
+            bits_assign(state->zone_bits[ZB_LOW_BATTERY], zidx, value == RS_ZONE_LOW_BAT);
+        break;
+
+        default:
+        break;
+    }
+
+    return 1;
+}
+
+/*
+ * Labels are padded with spaces to 16 characters.
+ */
+static void set_label(char *dst, const char *src, size_t len)
+{
+    if (len > LABEL_LENGTH - 1) {
+        len = LABEL_LENGTH - 1;
+    }
+
+    while (len > 0 && (src[len - 1] == PARA_SERIAL_SPACE || src[len - 1] == 0)) {
+        len--;
+    }
+
+    memcpy(dst, src, len);
+    dst[len] = 0;
+}
+
+void para_state_area_label(para_state_t *state, int area_num, const char *label, size_t len)
+{
+    char name[LABEL_LENGTH];
+
+    set_label(name, label, len);
+
+    if (strcmp(name, state->area_names[area_num - 1]) != 0) {
+        strcpy(state->area_names[area_num - 1], name);
+        state->area_fields[area_num - 1] |= FIELD_LABEL_BIT;
+        state->unsaved = 1;
+
+        if (bits_test(state->areas_reported, area_num - 1)) {
+            bits_set(state->areas_dirty, area_num - 1);
+        }
+    }
+}
+
+void para_state_zone_label(para_state_t *state, int zone_num, const char *label, size_t len)
+{
+    char name[LABEL_LENGTH];
+
+    set_label(name, label, len);
+
+    int slot = para_state_zone_idx(state, zone_num);
+
+    if (strcmp(name, state->zone_names[slot]) != 0) {
+        strcpy(state->zone_names[slot], name);
+        state->zone_fields[slot] |= FIELD_LABEL_BIT;
+        state->unsaved = 1;
+
+        if (bits_test(state->zones_reported, zone_num - 1)) {
+            bits_set(state->zones_dirty, zone_num - 1);
+        }
+    }
+}
+
+/*
+ * Fields to report and forget. The first report of an area/zone takes all of them.
+ */
+unsigned para_state_take_area_fields(para_state_t *state, int area_num)
+{
+    int aidx = area_num - 1;
+    unsigned fields = state->area_fields[aidx];
+
+    if (!bits_test(state->areas_reported, aidx)) {
+        fields = ((1U << AF_COUNT) - 1) | FIELD_LABEL_BIT;
+        bits_set(state->areas_reported, aidx);
+    }
+
+    state->area_fields[aidx] = 0;
+
+    return fields;
+}
+
+unsigned para_state_take_zone_fields(para_state_t *state, int zone_num)
+{
+    int zidx = zone_num - 1;
+    int slot = para_state_zone_idx(state, zone_num);
+    unsigned fields = state->zone_fields[slot];
+
+    if (!bits_test(state->zones_reported, zidx)) {
+        fields = ((1U << ZF_COUNT) - 1) | FIELD_LABEL_BIT;
+        bits_set(state->zones_reported, zidx);
+    }
+
+    state->zone_fields[slot] = 0;
+
+    return fields;
+}
+
+/*
+ * Monitored areas as a mask, bit 0 is area 1.
+ */
+unsigned para_state_areas_mask(const para_state_t *state)
+{
+    unsigned mask = 0;
+
+    for (int a = 0; (a = para_state_next_area(state->areas_monitored, a)); ) {
+        mask |= 1U << (a - 1);
+    }
+
+    return mask;
+}
+
+/*
+ * Areas, which have their own status and the status of all their zones
+ * received from the panel.
+ */
+unsigned para_state_ready_areas(const para_state_t *state)
+{
+    unsigned ready = 0;
+
+    for (int a = 0; (a = para_state_next_area(state->areas_known, a)); ) {
+        uint64_t missing = 0;
+
+        for (int w = 0; w < PARA_ZONE_WORDS; w++) {
+            missing |= state->area_zones[a - 1][w] & ~state->zones_known[w];
+        }
+
+        if (!missing) {
+            ready |= 1U << (a - 1);
+        }
+    }
+
+    return ready;
+}
+
+/*
+ * Number of the area's zones having the condition, e.g. open or bypassed.
+ */
+int para_state_area_count(const para_state_t *state, int area_num, para_zone_bit_t bit)
+{
+    int count = 0;
+
+    for (int w = 0; w < PARA_ZONE_WORDS; w++) {
+        count += __builtin_popcountll(state->zone_bits[bit][w] & state->area_zones[area_num - 1][w]);
+    }
+
+    return count;
+}
+
+/*
+ * Iterate bitsets: returns the next area/zone number after the given one, 0 at the end.
+ */
+int para_state_next_area(const uint64_t *bits, int after)
+{
+    return bits_next(bits, PARA_AREA_WORDS, after);
+}
+
+int para_state_next_zone(const uint64_t *bits, int after)
+{
+    return bits_next(bits, PARA_ZONE_WORDS, after);
+}
+
+int para_state_pop_dirty_area(para_state_t *state)
+{
+    int area_num = bits_next(state->areas_dirty, PARA_AREA_WORDS, 0);
+
+    if (area_num) {
+        bits_clear(state->areas_dirty, area_num - 1);
+    }
+
+    return area_num;
+}
+
+int para_state_pop_dirty_zone(para_state_t *state)
+{
+    int zone_num = bits_next(state->zones_dirty, PARA_ZONE_WORDS, 0);
+
+    if (zone_num) {
+        bits_clear(state->zones_dirty, zone_num - 1);
+    }
+
+    return zone_num;
+}
+
+/*
+ * Report everything reported before once more, with nothing changed.
+ */
+void para_state_dirty_reported(para_state_t *state)
+{
+    for (int w = 0; w < PARA_AREA_WORDS; w++) {
+        state->areas_dirty[w] |= state->areas_reported[w];
+    }
+
+    for (int w = 0; w < PARA_ZONE_WORDS; w++) {
+        state->zones_dirty[w] |= state->zones_reported[w];
+    }
+}
+
+static int bits_next(const uint64_t *bits, int words, int after)
+{
+    // Numbers are 1 based, so the bit of "after" itself is skipped.
+    int w = after / 64;
+
+    if (w >= words) {
+        return 0;
+    }
+
+    uint64_t word = bits[w] & (~0ULL << (after % 64));
+
+    while (!word) {
+        if (++w >= words) {
+            return 0;
+        }
+
+        word = bits[w];
+    }
+
+    return w * 64 + __builtin_ctzll(word) + 1;
+}
@@ -0,0 +1,647 @@
+/*
+ * The source of the MQTT daemon interacting with Paradox EVO control panel
+ * via their's PRT3 module.
+ *
+ * paraevo_sim.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Darau, blė
+ *
+ *  A PRT3 emulator on a pseudo-terminal for testing and load generation
+ *  without a physical panel. Models an EVO192 with 8 areas and 192 zones,
+ *  answers PRT3 ASCII requests and emits zone events at a given rate,
+ *  paced as 57600 baud serial with a limited PRT3 input buffer.
+ *
+ *  Point the daemon to the printed (or symlinked) pty with -d.
+ *
+ *  This file is a part of personal use utilities developed to be used
+ *  on various Linux devices.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+#define _XOPEN_SOURCE 600
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "log.h"
+#include "paratypes.h"
+#include "time_helpers.h"
+
+#define SIM_AREAS 8
+#define SIM_ZONES 192
+#define SIM_ZONES_PER_AREA (SIM_ZONES / SIM_AREAS)
+
+#define SIM_BAUD 57600
+#define SIM_BYTES_PER_SEC (SIM_BAUD / 10) // 8N1: 10 bits on the wire per byte
+#define SIM_DEFAULT_INPUT_BUFFER 64
+#define SIM_DEFAULT_REQUEST_LATENCY 5 // ms PRT3 needs to answer a request
+#define SIM_OUTPUT_LEN 8192
+#define SIM_LINE_LEN 32
+#define SIM_EOL 0x0D
+
+typedef struct {
+    char name[LABEL_LENGTH];
+    char status;
+    char memory;
+    char trouble;
+    char ready;
+    char programming;
+    char alarm;
+    char strobe;
+} sim_area_t;
+
+typedef struct {
+    char name[LABEL_LENGTH];
+    char status;
+    char alarm;
+    char fire;
+    char supervision;
+    char battery;
+} sim_zone_t;
+
+para_evo_config_t config = {
+    .verbose = 0,
+};
+
+static sim_area_t areas[SIM_AREAS];
+static sim_zone_t zones[SIM_ZONES];
+
+static int master = -1;
+static volatile sig_atomic_t running = 1;
+
+// PRT3 input buffer: bytes received from the daemon and not yet processed.
+static char input[SIM_LINE_LEN * 16];
+static int input_len = 0;
+static int input_limit = SIM_DEFAULT_INPUT_BUFFER;
+
+// Serial output paced to the baud rate.
+static char output[SIM_OUTPUT_LEN];
+static int output_len = 0;
+static int paced = 1;
+
+static struct {
+    long long requests;
+    long long events;
+    long long overruns;
+    long long dropped_output;
+    long long bytes_in;
+    long long bytes_out;
+} stats;
+
+static void sim_init_panel();
+static int sim_open_pty(const char *link_path);
+static void sim_emit(const char *line);
+static void sim_event(int group, int num, int area);
+static void sim_process_request(const char *req, int len);
+static void sim_random_event(int max_zone);
+static void sim_zone_event(int zone_num);
+static void sim_print_stats(long long elapsed_ms);
+static void sim_signal(int sig);
+static void print_usage();
+
+int main(int argc, char **argv)
+{
+    const char *link_path = NULL;
+    double rate = 0;
+    int burst = 1;
+    int latency = SIM_DEFAULT_REQUEST_LATENCY;
+    int stats_period = 5;
+    int max_zone = SIM_ZONES;
+    int sweep = 0;
+    int sweep_zone = 0;
+    unsigned int seed = 1;
+
+    static struct option long_options[] = {
+        {"link",         required_argument, 0, 'l'},
+        {"rate",         required_argument, 0, 'r'},
+        {"burst",        required_argument, 0, 'b'},
+        {"buffer",       required_argument, 0, 'B'},
+        {"latency",      required_argument, 0, 'L'},
+        {"zones",        required_argument, 0, 'z'},
+        {"stats_period", required_argument, 0, 's'},
+        {"seed",         required_argument, 0, 'e'},
+        {"sweep",        no_argument,       0, 'w'},
+        {"no_pacing",    no_argument,       0, 'n'},
+        {"verbose",      no_argument,       0, 'v'},
+        {"help",         no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int c;
+
+    while ((c = getopt_long(argc, argv, "l:r:b:B:L:z:s:e:wnvh", long_options, NULL)) >= 0) {
+        switch (c) {
+            case 'l':
+                link_path = optarg;
+            break;
+
+            case 'r':
+                rate = strtod(optarg, NULL);
+            break;
+
+            case 'b':
+                burst = strtol(optarg, NULL, 10);
+            break;
+
+            case 'B':
+                input_limit = strtol(optarg, NULL, 10);
+            break;
+
+            case 'L':
+                latency = strtol(optarg, NULL, 10);
+            break;
+
+            case 'z':
+                max_zone = strtol(optarg, NULL, 10);
+            break;
+
+            case 's':
+                stats_period = strtol(optarg, NULL, 10);
+            break;
+
+            case 'e':
+                seed = strtoul(optarg, NULL, 10);
+            break;
+
+            case 'w':
+                sweep = 1;
+            break;
+
+            case 'n':
+                paced = 0;
+            break;
+
+            case 'v':
+                config.verbose = 1;
+            break;
+
+            case 'h':
+            default:
+                print_usage();
+                return c == 'h' ? 0 : -1;
+        }
+    }
+
+    if (rate < 0 || burst < 1 || latency < 0 || stats_period < 1
+        || input_limit < SIM_LINE_LEN || input_limit > (int) sizeof(input)
+        || max_zone < 1 || max_zone > SIM_ZONES) {
+        log_error("SIM: invalid arguments\n");
+        print_usage();
+        return -1;
+    }
+
+    srand(seed);
+    sim_init_panel();
+
+    int slave = sim_open_pty(link_path);
+
+    if (slave < 0) {
+        return -2;
+    }
+
+    struct sigaction action = { .sa_handler = sim_signal };
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    long long start = t_now_ms();
+    long long last_pace = start;
+    long long next_request = start;
+    // Bursts are scheduled in us, high rates have several of them due per ms.
+    long long next_burst = rate > 0 ? t_now_us() : -1;
+    long long burst_interval = rate > 0 ? (long long) (burst * 1000000.0 / rate) : 0;
+
+    if (burst_interval < 1) {
+        burst_interval = 1;
+    }
+
+    // Bursts caught up in one pass, i.e. due within a ms of polling.
+    long long bursts_per_pass = 1000 / burst_interval + 1;
+    long long next_stats = start + stats_period * 1000LL;
+    double credit = 0;
+
+    while (running) {
+        long long now = t_now_ms();
+
+        // Earliest of all the pending actions.
+        long long wake = next_stats;
+
+        if (next_burst >= 0 && (next_burst + 999) / 1000 < wake) {
+            wake = (next_burst + 999) / 1000;
+        }
+
+        if (input_len > 0 && next_request < wake && memchr(input, SIM_EOL, input_len)) {
+            wake = next_request;
+        }
+
+        if (output_len > 0) {
+            wake = now + 1;
+        }
+
+        struct pollfd pfd = { .fd = master, .events = POLLIN };
+        int timeout = wake > now ? (int) (wake - now) : 0;
+
+        if (poll(&pfd, 1, timeout) < 0 && errno != EINTR) {
+            log_error("SIM: poll failed: %d\n", errno);
+            break;
+        }
+
+        now = t_now_ms();
+
+        if (pfd.revents & POLLIN) {
+            char buffer[256];
+            ssize_t br = read(master, buffer, sizeof(buffer));
+
+            if (br > 0) {
+                stats.bytes_in += br;
+                int room = input_limit - input_len;
+
+                if (br > room) {
+                    // Like PRT3, whatever does not fit the buffer is lost.
+                    stats.overruns += br - room;
+                    log_verbose("SIM: input buffer overrun, %ld bytes lost\n", (long) (br - room));
+                    br = room;
+                }
+
+                memcpy(input + input_len, buffer, br);
+                input_len += br;
+            }
+        }
+
+        // One request per PRT3 processing time.
+        while (input_len > 0 && next_request <= now) {
+            char *eol = memchr(input, SIM_EOL, input_len);
+
+            if (!eol) {
+                if (input_len == input_limit) {
+                    input_len = 0; // Garbage without EOL filled the buffer
+                }
+                break;
+            }
+
+            int len = eol - input;
+            sim_process_request(input, len);
+            input_len -= len + 1;
+            memmove(input, eol + 1, input_len);
+            next_request = now + latency;
+        }
+
+        long long now_us = t_now_us();
+
+        for (long long pass = 0; next_burst >= 0 && next_burst <= now_us && pass < bursts_per_pass; pass++) {
+            for (int i = 0; i < burst; i++) {
+                if (sweep) {
+                    sim_zone_event(sweep_zone % max_zone + 1);
+
+                    if (++sweep_zone % max_zone == 0) {
+                        log_verbose("SIM: all %d zones toggled\n", max_zone);
+                    }
+                } else {
+                    sim_random_event(max_zone);
+                }
+            }
+
+            next_burst += burst_interval;
+        }
+
+        if (next_burst >= 0 && next_burst < now_us) {
+            next_burst = now_us; // Output is falling behind, do not accumulate bursts
+        }
+
+        // Serial line pacing: only as many bytes as 57600 baud lets through.
+        credit += (now - last_pace) * SIM_BYTES_PER_SEC / 1000.0;
+        last_pace = now;
+
+        if (credit > SIM_BYTES_PER_SEC / 10) {
+            credit = SIM_BYTES_PER_SEC / 10;
+        }
+
+        if (output_len > 0) {
+            int allowed = paced ? (int) credit : output_len;
+
+            if (allowed > output_len) {
+                allowed = output_len;
+            }
+
+            if (allowed > 0) {
+                ssize_t bw = write(master, output, allowed);
+
+                if (bw > 0) {
+                    stats.bytes_out += bw;
+                    credit -= bw;
+                    output_len -= bw;
+                    memmove(output, output + bw, output_len);
+                }
+            }
+        }
+
+        if (now >= next_stats) {
+            sim_print_stats(now - start);
+            next_stats += stats_period * 1000LL;
+        }
+    }
+
+    sim_print_stats(t_now_ms() - start);
+
+    if (link_path) {
+        unlink(link_path);
+    }
+
+    close(slave);
+    close(master);
+
+    return 0;
+}
+
+static void sim_init_panel()
+{
+    char label[LABEL_LENGTH];
+
+    for (int i = 0; i < SIM_AREAS; i++) {
+        snprintf(label, LABEL_LENGTH, "Area %d", i + 1);
+        snprintf(areas[i].name, LABEL_LENGTH, "%-16s", label);
+        areas[i].status = RS_AREA_DISARMED;
+        areas[i].memory = RS_OK;
+        areas[i].trouble = RS_OK;
+        areas[i].ready = RS_OK;
+        areas[i].programming = RS_OK;
+        areas[i].alarm = RS_OK;
+        areas[i].strobe = RS_OK;
+    }
+
+    for (int i = 0; i < SIM_ZONES; i++) {
+        snprintf(label, LABEL_LENGTH, "Zone %03d", i + 1);
+        snprintf(zones[i].name, LABEL_LENGTH, "%-16s", label);
+        zones[i].status = RS_ZONE_CLOSED;
+        zones[i].alarm = RS_OK;
+        zones[i].fire = RS_OK;
+        zones[i].supervision = RS_OK;
+        zones[i].battery = RS_OK;
+    }
+}
+
+static int sim_open_pty(const char *link_path)
+{
+    master = posix_openpt(O_RDWR | O_NOCTTY);
+
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        log_error("SIM: cannot create pseudo-terminal: %d\n", errno);
+        return -1;
+    }
+
+    const char *slave_name = ptsname(master);
+
+    // Keep the slave open, otherwise master reads EIO until the daemon opens it.
+    int slave = open(slave_name, O_RDWR | O_NOCTTY);
+
+    if (slave < 0) {
+        log_error("SIM: cannot open %s: %d\n", slave_name, errno);
+        return -1;
+    }
+
+    struct termios tio;
+    tcgetattr(slave, &tio);
+    tio.c_iflag = 0;
+    tio.c_oflag = 0;
+    tio.c_lflag = 0;
+    tio.c_cflag = B57600 | CS8 | CLOCAL | CREAD;
+    tcsetattr(slave, TCSANOW, &tio);
+
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+
+    if (link_path) {
+        unlink(link_path);
+
+        if (symlink(slave_name, link_path) != 0) {
+            log_error("SIM: cannot link %s to %s: %d\n", link_path, slave_name, errno);
+            return -1;
+        }
+    }
+
+    log_info("SIM: PRT3 emulator on %s%s%s\n", slave_name, link_path ? " -> " : "", link_path ? link_path : "");
+
+    return slave;
+}
+
+static void sim_emit(const char *line)
+{
+    int len = strlen(line);
+
+    if (output_len + len + 1 > SIM_OUTPUT_LEN) {
+        stats.dropped_output++;
+        return;
+    }
+
+    memcpy(output + output_len, line, len);
+    output[output_len + len] = SIM_EOL;
+    output_len += len + 1;
+}
+
+static void sim_event(int group, int num, int area)
+{
+    char line[SIM_LINE_LEN];
+    snprintf(line, SIM_LINE_LEN, "G%03dN%03dA%03d", group, num, area);
+
+    if (config.verbose) {
+        // Wall clock in ms to correlate with the MQTT side.
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        printf("EVENT %lld.%03ld %s\n", (long long) ts.tv_sec, ts.tv_nsec / 1000000, line);
+    }
+
+    stats.events++;
+    sim_emit(line);
+}
+
+static int get_num(const char *str)
+{
+    for (int i = 0; i < 3; i++) {
+        if (str[i] < '0' || str[i] > '9') {
+            return -1;
+        }
+    }
+
+    return (str[0] - '0') * 100 + (str[1] - '0') * 10 + (str[2] - '0');
+}
+
+static void sim_arm(int area_num, char arm_type, int quick)
+{
+    sim_area_t *area = &areas[area_num - 1];
+
+    switch (arm_type) {
+        case RS_AREA_STAY_ARMED:
+            area->status = RS_AREA_STAY_ARMED;
+            sim_event(G_SPECIAL_ARMING, 4, area_num);
+            sim_event(G_STATUS_1, S1_STAY_ARMED, area_num);
+        break;
+
+        case RS_AREA_FORCE_ARMED:
+            area->status = RS_AREA_FORCE_ARMED;
+            sim_event(quick ? G_SPECIAL_ARMING : G_ARMING_WITH_USER_CODE, 1, area_num);
+            sim_event(G_STATUS_1, S1_FORCE_ARMED, area_num);
+        break;
+
+        case RS_AREA_INSTANT_ARMED:
+            area->status = RS_AREA_INSTANT_ARMED;
+            sim_event(quick ? G_SPECIAL_ARMING : G_ARMING_WITH_USER_CODE, 1, area_num);
+            sim_event(G_STATUS_1, S1_INSTANT_ARMED, area_num);
+        break;
+
+        default:
+            area->status = RS_AREA_ARMED;
+            sim_event(quick ? G_SPECIAL_ARMING : G_ARMING_WITH_USER_CODE, 1, area_num);
+            sim_event(G_STATUS_1, S1_ARMED, area_num);
+        break;
+    }
+}
+
+static void sim_process_request(const char *req, int len)
+{
+    char line[SIM_LINE_LEN];
+    char prefix[6] = "";
+
+    stats.requests++;
+
+    if (len < 5) {
+        log_verbose("SIM: short request [%.*s]\n", len, req);
+        return;
+    }
+
+    memcpy(prefix, req, 5);
+    int num = get_num(req + 2);
+    int args = len - 5;
+
+    log_verbose("SIM: request [%.*s]\n", len, req);
+
+    if (req[0] == 'R' && req[1] == 'A' && num >= 1 && num <= SIM_AREAS && args == 0) {
+        sim_area_t *a = &areas[num - 1];
+        snprintf(line, SIM_LINE_LEN, "%s%c%c%c%c%c%c%c", prefix,
+            a->status, a->memory, a->trouble, a->ready, a->programming, a->alarm, a->strobe);
+    } else if (req[0] == 'R' && req[1] == 'Z' && num >= 1 && num <= SIM_ZONES && args == 0) {
+        sim_zone_t *z = &zones[num - 1];
+        snprintf(line, SIM_LINE_LEN, "%s%c%c%c%c%c", prefix,
+            z->status, z->alarm, z->fire, z->supervision, z->battery);
+    } else if (req[0] == 'A' && req[1] == 'L' && num >= 1 && num <= SIM_AREAS && args == 0) {
+        snprintf(line, SIM_LINE_LEN, "%s%s", prefix, areas[num - 1].name);
+    } else if (req[0] == 'Z' && req[1] == 'L' && num >= 1 && num <= SIM_ZONES && args == 0) {
+        snprintf(line, SIM_LINE_LEN, "%s%s", prefix, zones[num - 1].name);
+    } else if (req[0] == 'A' && req[1] == 'A' && num >= 1 && num <= SIM_AREAS && args >= 2) {
+        // Arm type and a user code
+        snprintf(line, SIM_LINE_LEN, "%s&ok", prefix);
+        sim_emit(line);
+        sim_arm(num, req[5], 0);
+        return;
+    } else if (req[0] == 'A' && req[1] == 'Q' && num >= 1 && num <= SIM_AREAS && args == 1) {
+        snprintf(line, SIM_LINE_LEN, "%s&ok", prefix);
+        sim_emit(line);
+        sim_arm(num, req[5], 1);
+        return;
+    } else if (req[0] == 'A' && req[1] == 'D' && num >= 1 && num <= SIM_AREAS && args >= 1) {
+        snprintf(line, SIM_LINE_LEN, "%s&ok", prefix);
+        sim_emit(line);
+
+        if (areas[num - 1].status != RS_AREA_DISARMED || areas[num - 1].alarm != RS_OK) {
+            int after_alarm = areas[num - 1].alarm != RS_OK;
+            areas[num - 1].status = RS_AREA_DISARMED;
+            areas[num - 1].alarm = RS_OK;
+            sim_event(after_alarm ? G_DISARM_AFTER_ALARM_WITH_USER_CODE : G_DISARM_WITH_USER_CODE, 1, num);
+        }
+        return;
+    } else if (req[0] == 'U' && req[1] == 'K' && num >= 1 && num <= MAX_UTILITY_KEY && args == 0) {
+        snprintf(line, SIM_LINE_LEN, "%s&ok", prefix);
+    } else {
+        snprintf(line, SIM_LINE_LEN, "%s&fail", prefix);
+    }
+
+    sim_emit(line);
+}
+
+static void sim_random_event(int max_zone)
+{
+    sim_zone_event(rand() % max_zone + 1);
+}
+
+/*
+ * Toggle the zone. An opening zone of an armed area goes into alarm.
+ */
+static void sim_zone_event(int zone_num)
+{
+    int area_num = (zone_num - 1) / SIM_ZONES_PER_AREA + 1;
+    sim_zone_t *zone = &zones[zone_num - 1];
+    sim_area_t *area = &areas[area_num - 1];
+
+    if (zone->status == RS_ZONE_CLOSED) {
+        zone->status = RS_ZONE_OPEN;
+        sim_event(G_ZONE_OPEN, zone_num, area_num);
+
+        if (area->status != RS_AREA_DISARMED && zone->alarm == RS_OK) {
+            zone->alarm = RS_ZONE_IN_ALARM;
+            area->alarm = RS_AREA_IN_ALARM;
+            sim_event(G_ZONE_IN_ALARM, zone_num, area_num);
+        }
+    } else {
+        zone->status = RS_ZONE_CLOSED;
+        sim_event(G_ZONE_OK, zone_num, area_num);
+
+        if (zone->alarm != RS_OK) {
+            zone->alarm = RS_OK;
+            sim_event(G_ZONE_ALARM_RESTORE, zone_num, area_num);
+        }
+    }
+}
+
+static void sim_print_stats(long long elapsed_ms)
+{
+    double secs = elapsed_ms > 0 ? elapsed_ms / 1000.0 : 1;
+
+    log_info("SIM: %.1f s: %lld events (%.1f/s), %lld requests (%.1f/s), in %lld B, out %lld B (%.0f B/s), "
+        "overruns %lld B, dropped output %lld\n",
+        secs, stats.events, stats.events / secs, stats.requests, stats.requests / secs,
+        stats.bytes_in, stats.bytes_out, stats.bytes_out / secs, stats.overruns, stats.dropped_output);
+}
+
+static void sim_signal(int sig)
+{
+    running = 0;
+}
+
+static void print_usage()
+{
+    printf(
+        "Usage: paraevo-sim [options]\n"
+        "\n"
+        "Emulates PRT3 of an EVO192 panel (8 areas, 192 zones) on a pseudo-terminal.\n"
+        "\n"
+        "  -l <path>     --link=<path>              Create a symlink to the pty, e.g. /tmp/prt3.\n"
+        "  -r <rate>     --rate=<rate>              Zone events per second on average. Default 0 (none).\n"
+        "  -b <count>    --burst=<count>            Events emitted back to back in one burst. Default 1.\n"
+        "  -B <bytes>    --buffer=<bytes>           PRT3 input buffer size, excess is lost. Default 64.\n"
+        "  -L <ms>       --latency=<ms>             Time PRT3 needs to process a request. Default 5.\n"
+        "  -z <count>    --zones=<count>            Emit events for zones 1 to <count> only. Default 192.\n"
+        "  -s <seconds>  --stats_period=<seconds>   How often to print statistics. Default 5.\n"
+        "  -e <seed>     --seed=<seed>              Random seed of the event sequence. Default 1.\n"
+        "  -w,           --sweep                    Toggle zones 1 to <count> in turn instead of random\n"
+        "                                           ones, so every zone is driven.\n"
+        "  -n,           --no_pacing                Do not limit output to 57600 baud.\n"
+        "  -v,           --verbose                  Print requests and timestamped events.\n"
+        "  -h,           --help                     Print this usage message and exit.\n"
+        "\n"
+    );
+}
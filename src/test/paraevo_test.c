@@ -0,0 +1,49 @@
+/*
+ * The source of the MQTT daemon interacting with Paradox EVO control panel
+ * via their's PRT3 module.
+ *
+ * paraevo_test.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Darau, blė
+ *
+ *  Unit tests of the daemon parts that do not need ZMQ nor MQTT.
+ *  Prints the failed checks and exits non-zero if there are any.
+ *
+ *  This file is a part of personal use utilities developed to be used
+ *  on various Linux devices.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+#include <stdio.h>
+
+#include "log.h"
+#include "paraevo_test.h"
+
+para_evo_config_t config = {
+    .verbose = 0,
+};
+
+int test_failures = 0;
+
+int main(void)
+{
+    test_area();
+    test_zones();
+
+    if (test_failures) {
+        printf("%d checks failed\n", test_failures);
+        return 1;
+    }
+
+    printf("All checks passed\n");
+    return 0;
+}
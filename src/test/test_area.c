@@ -0,0 +1,434 @@
+/*
+ * The source of the MQTT daemon interacting with Paradox EVO control panel
+ * via their's PRT3 module.
+ *
+ * test_area.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Darau, blė
+ *
+ *  This file is a part of personal use utilities developed to be used
+ *  on various Linux devices.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+#include <string.h>
+
+#include "para_area.h"
+#include "paraevo_test.h"
+
+#define TEST_AREA 1
+#define TEST_ZONES 4 // Zones 1..4 are in the area
+
+/*
+ * An event of a sequence with the MQTT state and effects expected after it.
+ */
+typedef struct {
+    int group;
+    int num;
+    int mqtt_state;
+    unsigned effects;
+} area_step_t;
+
+static para_state_t state;
+
+static para_area_state_t *area_record()
+{
+    return &state.areas[TEST_AREA - 1];
+}
+
+static int area_bypassed()
+{
+    return para_state_area_count(&state, TEST_AREA, ZB_BYPASSED);
+}
+
+/*
+ * A disarmed area, the given number of its zones bypassed.
+ */
+static void area_setup(int bypassed)
+{
+    static const char fields[AF_COUNT] = {
+        [AF_STATUS] = RS_AREA_DISARMED,
+        [AF_MEMORY] = RS_OK,
+        [AF_TROUBLE] = RS_OK,
+        [AF_READY] = RS_OK,
+        [AF_PROGRAMMING] = RS_OK,
+        [AF_ALARM] = RS_OK,
+        [AF_STROBE] = RS_OK,
+        [AF_MQTT_STATE] = MQP_DISARMED,
+    };
+
+    para_state_init(&state);
+    para_state_add_area(&state, TEST_AREA);
+
+    for (int z = 1; z <= TEST_ZONES; z++) {
+        para_state_add_zone(&state, TEST_AREA, z);
+        para_state_zone_set(&state, z, ZF_BYPASSED, z <= bypassed ? RS_ZONE_BYPASSED : RS_OK);
+    }
+
+    memcpy(area_record()->fields, fields, AF_COUNT);
+}
+
+/*
+ * Applies the steps the way para_mgr does and checks the state after each.
+ * Zone bypass events mark the zone first, as event_zone_bypass does.
+ */
+static void replay(const char *name, const area_step_t *steps, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        const area_step_t *s = &steps[i];
+
+        if (s->group == G_ZONE_BYPASSED || s->group == G_ZONE_SHUTDOWN) {
+            para_state_zone_set(&state, s->num, ZF_BYPASSED, RS_ZONE_BYPASSED);
+        }
+
+        const para_area_transition_t *t = para_area_apply(&state, TEST_AREA, s->group, s->num, 0);
+        unsigned effects = t ? t->effects : 0;
+
+        TEST_CHECK(area_record()->mqtt_state == s->mqtt_state,
+            "%s: step %zu G%03dN%03d state %d, expected %d",
+            name, i, s->group, s->num, area_record()->mqtt_state, s->mqtt_state);
+        TEST_CHECK(effects == s->effects,
+            "%s: step %zu G%03dN%03d effects 0x%x, expected 0x%x",
+            name, i, s->group, s->num, effects, s->effects);
+    }
+}
+
+#define STEPS(steps) steps, sizeof(steps) / sizeof(steps[0])
+
+static void test_alarm_cycle(void)
+{
+    static const area_step_t steps[] = {
+        { G_STATUS_2, S2_EXIT_DELAY, MQP_ARMING, 0 },
+        { G_ARMING_WITH_USER_CODE, 1, MQP_ARMED_AWAY, 0 },
+        { G_STATUS_1, S1_ARMED, MQP_ARMED_AWAY, 0 },
+        { G_STATUS_2, S2_ENTRY_DELAY, MQP_PENDING, AT_FLUSH },
+        // The armed status polled during the entry delay does not end it
+        { G_STATUS_1, S1_ARMED, MQP_PENDING, 0 },
+        { G_ZONE_IN_ALARM, 3, MQP_TRIGGERED, AT_FLUSH },
+        { G_STATUS_1, S1_AUDIBLE_ALARM, MQP_TRIGGERED, AT_FLUSH },
+        { G_STATUS_1, S1_ARMED, MQP_TRIGGERED, 0 },
+        { G_DISARM_AFTER_ALARM_WITH_USER_CODE, 1, MQP_DISARMED, AT_CLEAR_BYPASS | AT_MEMORY | AT_FLUSH },
+        { G_STATUS_2, S2_ALARM_IN_MEMORY, MQP_DISARMED, AT_MEMORY },
+    };
+
+    area_setup(0);
+    replay("alarm cycle", STEPS(steps));
+    TEST_CHECK(area_record()->alarm == RS_OK, "alarm cycle: alarm %c left", area_record()->alarm);
+    TEST_CHECK(area_record()->memory == RS_AREA_ZONE_IN_MEMORY, "alarm cycle: no alarm in memory");
+}
+
+static void test_alarm_cancel(void)
+{
+    static const area_step_t steps[] = {
+        { G_ARMING_WITH_KEYSWITCH, 1, MQP_ARMED_AWAY, 0 },
+        { G_ZONE_IN_ALARM, 2, MQP_TRIGGERED, AT_FLUSH },
+        { G_ALARM_CANCELLED_WITH_MASTER, 1, MQP_DISARMED, AT_CLEAR_BYPASS | AT_MEMORY | AT_FLUSH },
+    };
+
+    area_setup(0);
+    replay("alarm cancel", STEPS(steps));
+    TEST_CHECK(area_record()->status == RS_AREA_DISARMED, "alarm cancel: status %c", area_record()->status);
+}
+
+static void test_exit_delay_cancel(void)
+{
+    static const area_step_t steps[] = {
+        { G_STATUS_2, S2_EXIT_DELAY, MQP_ARMING, 0 },
+        { G_DISARM_WITH_USER_CODE, 1, MQP_DISARMED, AT_CLEAR_BYPASS },
+        // No entry delay for a disarmed area
+        { G_STATUS_2, S2_ENTRY_DELAY, MQP_DISARMED, 0 },
+    };
+
+    area_setup(0);
+    replay("exit delay cancel", STEPS(steps));
+    TEST_CHECK(area_record()->memory == RS_OK, "exit delay cancel: alarm in memory");
+}
+
+static void test_bypass_clear(void)
+{
+    static const area_step_t steps[] = {
+        { G_STATUS_2, S2_EXIT_DELAY, MQP_ARMING, 0 },
+        { G_ARMING_WITH_MASTER, 1, MQP_ARMED_CUSTOM_BYPASS, 0 },
+        { G_SPECIAL_DISARM, 1, MQP_DISARMED, AT_CLEAR_BYPASS },
+        // The bypasses are gone on the next arming
+        { G_SPECIAL_ARMING, 4, MQP_ARMED_HOME, 0 },
+        { G_ZONE_BYPASSED, 3, MQP_ARMED_CUSTOM_BYPASS, 0 },
+    };
+
+    area_setup(2);
+    replay("bypass clear", STEPS(steps));
+    TEST_CHECK(area_bypassed() == 1, "bypass clear: %d zones bypassed", area_bypassed());
+}
+
+/*
+ * The panel reports the arming before the exit delay it starts.
+ */
+static void test_exit_delay_after_arming(void)
+{
+    static const area_step_t away[] = {
+        { G_ARMING_WITH_USER_CODE, 1, MQP_ARMED_AWAY, 0 },
+        { G_STATUS_2, S2_EXIT_DELAY, MQP_ARMING, 0 },
+        { G_STATUS_1, S1_ARMED, MQP_ARMED_AWAY, 0 },
+    };
+    static const area_step_t stay[] = {
+        { G_SPECIAL_ARMING, 4, MQP_ARMED_HOME, 0 },
+        { G_STATUS_2, S2_EXIT_DELAY, MQP_ARMING, 0 },
+        { G_STATUS_1, S1_STAY_ARMED, MQP_ARMED_HOME, 0 },
+    };
+    static const area_step_t bypassed[] = {
+        { G_ARMING_WITH_MASTER, 1, MQP_ARMED_CUSTOM_BYPASS, 0 },
+        { G_STATUS_2, S2_EXIT_DELAY, MQP_ARMING, 0 },
+        { G_STATUS_1, S1_ARMED, MQP_ARMED_CUSTOM_BYPASS, 0 },
+    };
+
+    area_setup(0);
+    replay("exit delay after arming", STEPS(away));
+    TEST_CHECK(area_record()->status == RS_AREA_ARMED, "exit delay after arming: status %c", area_record()->status);
+
+    area_setup(0);
+    replay("exit delay after stay arming", STEPS(stay));
+
+    area_setup(1);
+    replay("exit delay after bypassed arming", STEPS(bypassed));
+}
+
+static void test_arming_kinds(void)
+{
+    static const area_step_t stay[] = {
+        { G_SPECIAL_ARMING, 4, MQP_ARMED_HOME, 0 },
+        { G_STATUS_1, S1_STAY_ARMED, MQP_ARMED_HOME, 0 },
+        { G_DISARM_WITH_KEYSWITCH, 1, MQP_DISARMED, AT_CLEAR_BYPASS },
+    };
+    static const area_step_t force[] = {
+        { G_STATUS_1, S1_FORCE_ARMED, MQP_ARMED_AWAY, 0 },
+        { G_DISARM_WITH_MASTER, 1, MQP_DISARMED, AT_CLEAR_BYPASS },
+    };
+    static const area_step_t instant[] = {
+        { G_STATUS_1, S1_INSTANT_ARMED, MQP_ARMED_AWAY, 0 },
+        { G_STATUS_2, S2_ENTRY_DELAY, MQP_PENDING, AT_FLUSH },
+    };
+
+    area_setup(0);
+    replay("stay arming", STEPS(stay));
+
+    area_setup(0);
+    replay("force arming", STEPS(force));
+
+    area_setup(0);
+    replay("instant arming", STEPS(instant));
+    TEST_CHECK(area_record()->status == RS_AREA_INSTANT_ARMED, "instant arming: status %c", area_record()->status);
+}
+
+static void test_alarm_kinds(void)
+{
+    static const area_step_t fire[] = {
+        { G_ZONE_FIRE_ALARM, 1, MQP_TRIGGERED, AT_FLUSH },
+        { G_STATUS_1, S1_FIRE_ALARM, MQP_TRIGGERED, AT_FLUSH },
+    };
+    static const area_step_t strobe[] = {
+        { G_STATUS_1, S1_ARMED, MQP_ARMED_AWAY, 0 },
+        { G_STATUS_1, S1_STROBE_ALARM, MQP_TRIGGERED, AT_FLUSH },
+    };
+    static const area_step_t silent[] = {
+        { G_STATUS_1, S1_STAY_ARMED, MQP_ARMED_HOME, 0 },
+        { G_STATUS_1, S1_SILENT_ALARM, MQP_TRIGGERED, AT_FLUSH },
+    };
+
+    area_setup(0);
+    replay("fire alarm", STEPS(fire));
+    TEST_CHECK(area_record()->alarm == RS_AREA_IN_ALARM, "fire alarm: alarm %c", area_record()->alarm);
+
+    area_setup(0);
+    replay("strobe alarm", STEPS(strobe));
+    TEST_CHECK(area_record()->alarm == RS_AREA_IN_ALARM, "strobe alarm: alarm %c", area_record()->alarm);
+
+    area_setup(0);
+    replay("silent alarm", STEPS(silent));
+}
+
+static void test_bypass_kinds(void)
+{
+    static const area_step_t shutdown[] = {
+        { G_STATUS_1, S1_ARMED, MQP_ARMED_AWAY, 0 },
+        { G_ZONE_SHUTDOWN, 4, MQP_ARMED_CUSTOM_BYPASS, 0 },
+    };
+    static const area_step_t bypassed[] = {
+        { G_SPECIAL_ARMING, 4, MQP_ARMED_HOME, 0 },
+        // The panel tells of bypassed zones before their records do
+        { G_STATUS_2, S2_ZONES_BYPASSED, MQP_ARMED_CUSTOM_BYPASS, 0 },
+    };
+
+    area_setup(0);
+    replay("zone shutdown", STEPS(shutdown));
+    TEST_CHECK(area_bypassed() == 1, "zone shutdown: %d zones bypassed", area_bypassed());
+
+    area_setup(0);
+    replay("zones bypassed", STEPS(bypassed));
+}
+
+static void test_status_2(void)
+{
+    static const area_step_t trouble[] = {
+        { G_STATUS_2, S2_SYSTEM_IN_TROUBLE, MQP_DISARMED, AT_TROUBLE },
+        { G_STATUS_1, S1_ARMED, MQP_ARMED_AWAY, 0 },
+        { G_STATUS_2, S2_SYSTEM_IN_TROUBLE, MQP_ARMED_AWAY, AT_TROUBLE },
+        // Not in the table, nothing changes
+        { G_STATUS_2, S2_READY, MQP_ARMED_AWAY, 0 },
+        { G_STATUS_2, S2_KEYPAD_LOCKOUT, MQP_ARMED_AWAY, 0 },
+    };
+
+    area_setup(0);
+    replay("trouble", STEPS(trouble));
+    TEST_CHECK(area_record()->trouble == RS_AREA_TROUBLE, "trouble: trouble %c", area_record()->trouble);
+}
+
+/*
+ * An awaited command keeps the MQTT state it set, the record follows the events.
+ */
+static void test_command_hold(void)
+{
+    area_setup(1);
+    area_record()->mqtt_state = MQP_ARMING;
+
+    const para_area_transition_t *t = para_area_apply(&state, TEST_AREA, G_ARMING_WITH_USER_CODE, 1, 1);
+
+    TEST_CHECK(t && area_record()->mqtt_state == MQP_ARMING, "command hold: arming left");
+    TEST_CHECK(area_record()->status == RS_AREA_ARMED, "command hold: status %c", area_record()->status);
+
+    area_record()->mqtt_state = MQP_DISARMING;
+    t = para_area_apply(&state, TEST_AREA, G_DISARM_WITH_USER_CODE, 1, 1);
+
+    TEST_CHECK(t && area_record()->mqtt_state == MQP_DISARMING, "command hold: disarming left");
+    TEST_CHECK(area_record()->status == RS_AREA_DISARMED && area_bypassed() == 0,
+        "command hold: disarm not applied to the record");
+}
+
+/*
+ * Polled records give the state the events would.
+ */
+static void test_derive(void)
+{
+    para_area_state_t area = {
+        .status = RS_AREA_ARMED,
+        .alarm = RS_OK,
+        .mqtt_state = MQP_PENDING,
+    };
+
+    TEST_CHECK(para_area_derive(&area, 0) == MQP_PENDING, "derive: armed record ends the entry delay");
+
+    area.alarm = RS_AREA_IN_ALARM;
+    TEST_CHECK(para_area_derive(&area, 0) == MQP_TRIGGERED, "derive: alarm is not triggered");
+
+    area.alarm = RS_OK;
+    area.mqtt_state = MQP_DISARMED;
+    TEST_CHECK(para_area_derive(&area, 1) == MQP_ARMED_CUSTOM_BYPASS, "derive: bypass not seen");
+
+    area.status = RS_AREA_STAY_ARMED;
+    TEST_CHECK(para_area_derive(&area, 0) == MQP_ARMED_HOME, "derive: stay armed is not home");
+
+    area.status = RS_AREA_EXIT_DELAY;
+    TEST_CHECK(para_area_derive(&area, 0) == MQP_ARMING, "derive: exit delay is not arming");
+
+    area.status = RS_AREA_DISARMED;
+    area.mqtt_state = MQP_TRIGGERED;
+    TEST_CHECK(para_area_derive(&area, 0) == MQP_DISARMED, "derive: disarmed record keeps the alarm");
+
+    TEST_CHECK(para_area_armed(MQP_ARMED_HOME, 2) == MQP_ARMED_CUSTOM_BYPASS
+        && para_area_armed(MQP_ARMED_AWAY, 0) == MQP_ARMED_AWAY
+        && para_area_armed(MQP_DISARMED, 2) == MQP_DISARMED,
+        "armed: bypasses applied wrong");
+}
+
+/*
+ * Every event in every state: the applied row is the one of the table and
+ * its changes are all made, events without a row leave the area alone.
+ */
+static void test_every_event(void)
+{
+    area_setup(0);
+
+    for (int st = MQP_DISARMED; st <= MQP_DISARMING; st++) {
+        for (int g = 0; g < G_GROUPS_LEN; g++) {
+            for (int n = 0; n <= 255; n++) {
+                // Two zones bypassed, so the bypass clearing shows
+                para_state_zone_set(&state, 1, ZF_BYPASSED, RS_ZONE_BYPASSED);
+                para_state_zone_set(&state, 2, ZF_BYPASSED, RS_ZONE_BYPASSED);
+                area_record()->mqtt_state = st;
+
+                para_area_state_t before = *area_record();
+                const para_area_transition_t *t = para_area_apply(&state, TEST_AREA, g, n, 0);
+                const para_area_state_t *after = area_record();
+
+                TEST_CHECK(t == para_area_transition(st, g, n), "every event: state %d G%03dN%03d row", st, g, n);
+
+                if (!t) {
+                    TEST_CHECK(memcmp(&before, after, sizeof(before)) == 0 && area_bypassed() == 2,
+                        "every event: state %d G%03dN%03d changed the area", st, g, n);
+                    continue;
+                }
+
+                int to = t->to == AS_KEEP ? st : (int) para_area_armed(t->to, area_bypassed());
+
+                TEST_CHECK(after->mqtt_state == to
+                    && after->status == (t->status ? t->status : before.status)
+                    && after->alarm == (t->alarm ? t->alarm : before.alarm)
+                    && after->memory == (t->effects & AT_MEMORY ? RS_AREA_ZONE_IN_MEMORY : before.memory)
+                    && after->trouble == (t->effects & AT_TROUBLE ? RS_AREA_TROUBLE : before.trouble)
+                    && area_bypassed() == (t->effects & AT_CLEAR_BYPASS ? 0 : 2),
+                    "every event: state %d G%03dN%03d applied wrong", st, g, n);
+
+                if (g >= G_DISARM_WITH_MASTER && g <= G_SPECIAL_DISARM) {
+                    TEST_CHECK(after->mqtt_state == MQP_DISARMED, "every event: state %d G%03d does not disarm", st, g);
+                }
+
+                if (g == G_ZONE_IN_ALARM || g == G_ZONE_FIRE_ALARM || (g == G_STATUS_1 && n >= S1_STROBE_ALARM)) {
+                    TEST_CHECK(after->mqtt_state == MQP_TRIGGERED && (t->effects & AT_FLUSH),
+                        "every event: state %d G%03dN%03d does not trigger", st, g, n);
+                }
+
+                if (g == G_STATUS_1 && n <= S1_INSTANT_ARMED && (st == MQP_PENDING || st == MQP_TRIGGERED)) {
+                    TEST_CHECK(after->mqtt_state == st, "every event: armed status %d ends state %d", n, st);
+                }
+
+                if (g == G_STATUS_2 && n == S2_ENTRY_DELAY) {
+                    TEST_CHECK(AS(st) & AS_ARMED, "every event: entry delay in state %d", st);
+                }
+
+                if (g == G_STATUS_2 && n == S2_EXIT_DELAY) {
+                    TEST_CHECK(after->mqtt_state == MQP_ARMING, "every event: exit delay in state %d", st);
+                }
+            }
+        }
+
+        // Disarmed, arming or armed areas start the exit delay
+        if (st == MQP_DISARMED || st == MQP_ARMING || (AS(st) & AS_ARMED)) {
+            TEST_CHECK(para_area_transition(st, G_STATUS_2, S2_EXIT_DELAY) != NULL,
+                "every event: no exit delay in state %d", st);
+        }
+    }
+}
+
+void test_area(void)
+{
+    test_alarm_cycle();
+    test_alarm_cancel();
+    test_exit_delay_cancel();
+    test_bypass_clear();
+    test_exit_delay_after_arming();
+    test_arming_kinds();
+    test_alarm_kinds();
+    test_bypass_kinds();
+    test_status_2();
+    test_command_hold();
+    test_derive();
+    test_every_event();
+}
@@ -0,0 +1,289 @@
+/*
+ * The source of the MQTT daemon interacting with Paradox EVO control panel
+ * via their's PRT3 module.
+ *
+ * test_zones.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Darau, blė
+ *
+ *  This file is a part of personal use utilities developed to be used
+ *  on various Linux devices.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+// Lines go through the manager's own handlers, not a copy of them.
+#include "../para_mgr.c"
+
+#include "paraevo_test.h"
+
+#define ZONES_PER_AREA (MAX_ZONES / MAX_AREAS)
+
+static int zone_area(int zone_num)
+{
+    return (zone_num - 1) / ZONES_PER_AREA + 1;
+}
+
+/*
+ * Every zone gets values of its own, so a zone landing in the wrong slot shows.
+ */
+static void zone_fill(para_state_t *state, int zone_num)
+{
+    char label[LABEL_LENGTH];
+
+    para_state_zone_set(state, zone_num, ZF_STATUS, zone_num % 2 ? RS_ZONE_OPEN : RS_ZONE_CLOSED);
+    para_state_zone_set(state, zone_num, ZF_ALARM, zone_num % 3 ? RS_OK : RS_ZONE_IN_ALARM);
+    para_state_zone_set(state, zone_num, ZF_BYPASSED, zone_num % 5 ? RS_OK : RS_ZONE_BYPASSED);
+    para_state_zone_set(state, zone_num, ZF_BATTERY, zone_num % 7 ? RS_OK : RS_ZONE_LOW_BAT);
+    para_state_zone_set(state, zone_num, ZF_MQTT_STATE, zone_num % 4);
+
+    snprintf(label, sizeof(label), "Zone %d", zone_num);
+    para_state_zone_label(state, zone_num, label, strlen(label));
+}
+
+static int zone_check(const para_zone_state_t *zone, const char *name, int zone_num)
+{
+    char label[LABEL_LENGTH];
+
+    snprintf(label, sizeof(label), "Zone %d", zone_num);
+
+    return zone->status == (zone_num % 2 ? RS_ZONE_OPEN : RS_ZONE_CLOSED)
+        && zone->alarm == (zone_num % 3 ? RS_OK : RS_ZONE_IN_ALARM)
+        && zone->bypassed == (zone_num % 5 ? RS_OK : RS_ZONE_BYPASSED)
+        && zone->battery == (zone_num % 7 ? RS_OK : RS_ZONE_LOW_BAT)
+        && zone->mqtt_state == zone_num % 4
+        && strcmp(name, label) == 0;
+}
+
+/*
+ * All the zones are added backwards, so no slot matches the zone number.
+ */
+static void state_setup(para_state_t *state)
+{
+    para_state_init(state);
+
+    for (int a = 1; a <= MAX_AREAS; a++) {
+        para_state_add_area(state, a);
+    }
+
+    for (int z = MAX_ZONES; z >= 1; z--) {
+        para_state_add_zone(state, zone_area(z), z);
+    }
+}
+
+static void test_state(para_state_t *state)
+{
+    TEST_CHECK(state->zone_count == MAX_ZONES, "state: %d slots", state->zone_count);
+    TEST_CHECK(!para_state_has_zone(state, 0), "state: zone 0 monitored");
+    TEST_CHECK(!para_state_has_zone(state, MAX_ZONES + 1), "state: zone %d monitored", MAX_ZONES + 1);
+
+    int expected = 0;
+
+    for (int z = 0; (z = para_state_next_zone(state->zones_monitored, z)); ) {
+        TEST_CHECK(z == ++expected, "state: zone %d iterated, expected %d", z, expected);
+    }
+    TEST_CHECK(expected == MAX_ZONES, "state: %d zones iterated", expected);
+
+    for (int z = 1; z <= MAX_ZONES; z++) {
+        int slot = para_state_zone_idx(state, z);
+
+        TEST_CHECK(para_state_has_zone(state, z), "state: zone %d not monitored", z);
+        TEST_CHECK(slot == MAX_ZONES - z, "state: zone %d in slot %d", z, slot);
+        TEST_CHECK(state->slot_zone[slot] == z, "state: slot %d holds zone %d, expected %d",
+            slot, state->slot_zone[slot], z);
+        TEST_CHECK(bits_test(state->area_zones[zone_area(z) - 1], z - 1),
+            "state: zone %d not in area %d", z, zone_area(z));
+
+        zone_fill(state, z);
+        TEST_CHECK(zone_check(para_state_zone(state, z), para_state_zone_name(state, z), z),
+            "state: zone %d does not read back", z);
+    }
+
+    for (int a = 1; a <= MAX_AREAS; a++) {
+        TEST_CHECK(para_state_area_count(state, a, ZB_OPEN) == ZONES_PER_AREA / 2,
+            "state: area %d has %d open zones", a, para_state_area_count(state, a, ZB_OPEN));
+    }
+}
+
+/*
+ * Reports are built the way para_mgr send_zone_report does and applied
+ * the way the MQTT manager does.
+ */
+static void test_report(para_state_t *state)
+{
+    int expected = 0;
+
+    for (int z; (z = para_state_pop_dirty_zone(state)); ) {
+        uint8_t buf[PARA_REPORT_MAX_LEN];
+        para_zone_state_t *zone = para_state_zone(state, z);
+        para_report_t report;
+        para_zone_state_t received = { 0 };
+        char name[LABEL_LENGTH] = "";
+
+        TEST_CHECK(z == ++expected, "report: zone %d dirty, expected %d", z, expected);
+
+        size_t len = para_report_encode(buf, PR_ZONE, 0, z, zone->area,
+            para_state_take_zone_fields(state, z),
+            zone->fields, ZF_COUNT, para_state_zone_name(state, z));
+
+        if (para_report_decode(buf, len, &report) != 0) {
+            TEST_CHECK(0, "report: zone %d does not decode", z);
+            continue;
+        }
+
+        TEST_CHECK(report.kind == PR_ZONE && report.num == z && report.area == zone_area(z),
+            "report: zone %d came as %d of area %d", z, report.num, report.area);
+
+        para_report_apply(&report, received.fields, ZF_COUNT, name);
+        TEST_CHECK(zone_check(&received, name, z), "report: zone %d does not apply", z);
+    }
+    TEST_CHECK(expected == MAX_ZONES, "report: %d zones dirty", expected);
+}
+
+static void test_snapshot(para_state_t *state)
+{
+    char path[64];
+    para_snapshot_t snap;
+
+    snprintf(path, sizeof(path), "/tmp/paraevo-test-%d.snap", (int) getpid());
+
+    if (para_snapshot_open(&snap, path, state) != 0) {
+        TEST_CHECK(0, "snapshot: cannot open %s", path);
+        return;
+    }
+    para_snapshot_close(&snap, state);
+
+    para_state_t loaded;
+
+    state_setup(&loaded);
+
+    if (para_snapshot_open(&snap, path, &loaded) != 0) {
+        TEST_CHECK(0, "snapshot: cannot open %s again", path);
+        unlink(path);
+        return;
+    }
+
+    TEST_CHECK(para_snapshot_load(&snap, &loaded) == 1, "snapshot: not loaded");
+
+    for (int z = 1; z <= MAX_ZONES; z++) {
+        TEST_CHECK(zone_check(para_state_zone(&loaded, z), para_state_zone_name(&loaded, z), z),
+            "snapshot: zone %d does not load back", z);
+    }
+
+    para_snapshot_close(&snap, &loaded);
+    unlink(path);
+}
+
+static void mgr_line(para_panel_t *panel, const char *fmt, int zone_num, int area_num)
+{
+    char line[PARA_SERIAL_INPUT_LEN + 1];
+    int size = snprintf(line, sizeof(line), fmt, zone_num, area_num);
+
+    para_process_prt3_line(panel, line, size);
+}
+
+static int mgr_open_zones(para_panel_t *panel)
+{
+    int open = 0;
+
+    for (int a = 1; a <= MAX_AREAS; a++) {
+        open += para_state_area_count(&panel->state, a, ZB_OPEN);
+    }
+
+    return open;
+}
+
+/*
+ * Zone events and RZ responses are fed to the manager as the panel sends
+ * them, zones are added backwards there too.
+ */
+static void test_manager(void)
+{
+    para_panel_t *panel = &panels[0];
+    static para_state_t before;
+
+    para_mgr_init();
+
+    for (int a = 1; a <= MAX_AREAS; a++) {
+        para_mgr_set_area(0, a);
+    }
+
+    for (int z = MAX_ZONES; z >= 1; z--) {
+        para_mgr_set_zone(0, zone_area(z), z);
+    }
+
+    for (int z = 1; z <= MAX_ZONES; z++) {
+        mgr_line(panel, "G001N%03dA%03d", z, zone_area(z));
+        TEST_CHECK(para_state_zone(&panel->state, z)->status == RS_ZONE_OPEN,
+            "manager: zone %d not open after G001", z);
+        TEST_CHECK(mgr_open_zones(panel) == 1, "manager: %d zones open after G001 of zone %d",
+            mgr_open_zones(panel), z);
+        TEST_CHECK(bits_test(panel->state.zones_dirty, z - 1), "manager: zone %d not dirty", z);
+
+        mgr_line(panel, "G000N%03dA%03d", z, zone_area(z));
+        TEST_CHECK(para_state_zone(&panel->state, z)->status == RS_ZONE_CLOSED,
+            "manager: zone %d not closed after G000", z);
+        TEST_CHECK(mgr_open_zones(panel) == 0, "manager: %d zones open after G000 of zone %d",
+            mgr_open_zones(panel), z);
+    }
+
+    for (int z = 1; z <= MAX_ZONES; z++) {
+        char rz[16];
+
+        snprintf(rz, sizeof(rz), "RZ%%03d%c%c%cO%c",
+            z % 2 ? RS_ZONE_OPEN : RS_ZONE_CLOSED,
+            z % 3 ? RS_OK : RS_ZONE_IN_ALARM,
+            z % 11 ? RS_OK : RS_ZONE_FIRE,
+            z % 7 ? RS_OK : RS_ZONE_LOW_BAT);
+        mgr_line(panel, rz, z, 0);
+    }
+
+    for (int z = 1; z <= MAX_ZONES; z++) {
+        para_zone_state_t *zone = para_state_zone(&panel->state, z);
+
+        TEST_CHECK(bits_test(panel->state.zones_known, z - 1), "manager: zone %d not known after RZ", z);
+        TEST_CHECK(zone->status == (z % 2 ? RS_ZONE_OPEN : RS_ZONE_CLOSED)
+            && zone->alarm == (z % 3 ? RS_OK : RS_ZONE_IN_ALARM)
+            && zone->fire == (z % 11 ? RS_OK : RS_ZONE_FIRE)
+            && zone->battery == (z % 7 ? RS_OK : RS_ZONE_LOW_BAT),
+            "manager: zone %d does not match its RZ", z);
+    }
+
+    // The panel reports zones which are not monitored, they change nothing.
+    memcpy(&before, &panel->state, sizeof(before));
+
+    for (int z = 0; z <= MAX_ZONES + 1; z += MAX_ZONES + 1) {
+        mgr_line(panel, "G000N%03dA%03d", z, 1);
+        mgr_line(panel, "G001N%03dA%03d", z, 1);
+        mgr_line(panel, "RZ%03dCOOOO", z, 0);
+        mgr_line(panel, "RZ%03dOAFSL", z, 0);
+    }
+
+    TEST_CHECK(memcmp(&before, &panel->state, sizeof(before)) == 0,
+        "manager: zones 0 and %d changed the state", MAX_ZONES + 1);
+
+    para_mgr_clean();
+}
+
+void test_zones(void)
+{
+    static para_state_t state;
+
+    state_setup(&state);
+    test_state(&state);
+    test_report(&state);
+    test_snapshot(&state);
+    test_manager();
+}
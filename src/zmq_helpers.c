@@ -20,8 +20,10 @@
  *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
  *  GNU General Public License for more details.
  */
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "endpoints.h"
 #include "zmq_helpers.h"
 
 int z_start_endpoint(void *context, void **socket, const int type, const char *endpoint)
@@ -37,6 +39,15 @@ int z_connect_endpoint(void *context, void **socket, const int type, const char
     return zmq_connect(*socket, endpoint);
 }
 
+/*
+ * Name of the panel's own endpoint, buffer must fit EPT_NAME_LEN.
+ */
+const char *z_panel_endpoint(char *buffer, const char *pattern, int panel)
+{
+    snprintf(buffer, EPT_NAME_LEN, pattern, panel);
+    return buffer;
+}
+
 void z_drop_message(void *socket)
 {
     zmq_msg_t message;
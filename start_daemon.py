@@ -23,11 +23,49 @@ if "verbose" in config and config["verbose"] == True:
 if "daemon" in config and config["daemon"] == True:
     args += " -D"
 
-if "device" in config:
-    args += " -d " + config["device"]
+def panel_args(panel):
+    args = ""
+
+    if "device" in panel:
+        args += " -d " + panel["device"]
+    else:
+        print("Device not present in config!")
+        exit(-1)
+
+    if "topic" in panel:
+        args += " --panel_topic=" + panel["topic"]
+
+    if "record_file" in panel:
+        args += " --record=" + panel["record_file"]
+
+    if "snapshot_file" in panel:
+        args += " --snapshot=" + panel["snapshot_file"]
+
+    if "areas" in panel:
+        for area in panel["areas"]:
+            if "num" in area:
+                args += " -a " + str(area["num"])
+            else:
+                print("Area config does not have \"num\"!")
+                exit(-1)
+
+            if "zones" in area:
+                args += " -z " + ",".join([str(zone) for zone in area["zones"]])
+            else:
+                print("Aarea config dose not have zones!")
+                exit(-1)
+    else:
+        print("No area config!")
+        exit(-1)
+
+    return args
+
+# Either a single panel at the top level, or a list of them
+if "panels" in config:
+    for panel in config["panels"]:
+        args += panel_args(panel)
 else:
-    print("Device not present in config!")
-    exit(-1)
+    args += panel_args(config)
 
 if "mqtt" in config:
     if "server" in config["mqtt"]:
@@ -47,25 +85,39 @@ if "mqtt" in config:
     if "retain" in config["mqtt"] and config["mqtt"]["retain"] == True:
         args += " -r"
 
-else:
-    print("No MQTT settings in config!")
-    exit(-1)
+    if "republish" in config["mqtt"] and config["mqtt"]["republish"] == True:
+        args += " --republish"
+
+    if "queue" in config["mqtt"]:
+        queue = config["mqtt"]["queue"]
+
+        if "count" in queue:
+            args += " --queue_count=" + str(queue["count"])
+
+        if "bytes" in queue:
+            args += " --queue_bytes=" + str(queue["bytes"])
+
+        if "drain_rate" in queue:
+            args += " --drain_rate=" + str(queue["drain_rate"])
+
+    if "publish" in config["mqtt"]:
+        for topic_class, profile in config["mqtt"]["publish"].items():
+            settings = []
+
+            if "qos" in profile:
+                settings.append("qos" + str(profile["qos"]))
+
+            if "retain" in profile:
+                settings.append("retain" if profile["retain"] == True else "noretain")
+
+            if "enabled" in profile:
+                settings.append("on" if profile["enabled"] == True else "off")
+
+            if settings:
+                args += " --publish=" + topic_class + ":" + ",".join(settings)
 
-if "areas" in config:
-    for area in config["areas"]:
-        if "num" in area:
-            args += " -a " + str(area["num"])
-        else:
-            print("Area config does not have \"num\"!")
-            exit(-1)
-        
-        if "zones" in area:
-            args += " -z " + ",".join([str(zone) for zone in area["zones"]])
-        else:
-            print("Aarea config dose not have zones!")
-            exit(-1)
 else:
-    print("No area config!")
+    print("No MQTT settings in config!")
     exit(-1)
 
 if "user_code" in config and config["user_code"] != "":
@@ -74,6 +126,19 @@ if "user_code" in config and config["user_code"] != "":
 if "status_period" in config:
     args += " -S " + str(config["status_period"])
 
+if "prt3" in config:
+    if "window" in config["prt3"]:
+        args += " --prt3_window=" + str(config["prt3"]["window"])
+
+    if "timeout" in config["prt3"]:
+        args += " --prt3_timeout=" + str(config["prt3"]["timeout"])
+
+if "coalesce" in config:
+    args += " --coalesce=" + str(config["coalesce"])
+
+if "history" in config:
+    args += " --history=" + str(config["history"])
+
 if "log_file" in config:
     args += " >> " + config["log_file"] + " 2>&1"
 